@@ -0,0 +1,78 @@
+#include <zmq.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "broadcast.h"
+
+/*
+Буфер, созданный zmq_msg_init_data, ZeroMQ не копирует: копии (zmq_msg_copy) ссылаются
+на него и считают ссылки, буфер освобождается release_buffer после отправки последней.
+Маленькие тексты (до 33 байт) ZeroMQ всё равно хранит внутри zmq_msg_t - там копия дешевле
+счётчика, и разницы нет
+*/
+
+static void release_buffer(void *data, void *hint) {
+    (void)hint;
+    free(data);
+}
+
+size_t broadcast_send(void *router, const user_registry *reg, int sender_idx,
+                      const char *text, size_t size, const char *own_text, size_t own_size) {
+    char *buffer = malloc(size ? size : 1);
+    if (buffer == NULL) {
+        perror("malloc");
+        return 0;
+    }
+    memcpy(buffer, text, size);
+
+    zmq_msg_t body;
+    if (zmq_msg_init_data(&body, buffer, size, release_buffer, NULL) != 0) {
+        free(buffer);
+        return 0;
+    }
+
+    size_t sent = 0;
+    for (size_t i = 0; i < reg->online_count; i++) {
+        int idx = reg->online[i];
+        const user_t *user = &reg->users[idx];
+
+        if (zmq_send(router, user->zmq_id, user->zmq_id_size, ZMQ_SNDMORE) < 0) {
+            continue;
+        }
+        if (idx == sender_idx) {
+            zmq_send(router, own_text, own_size, 0);
+        } else {
+            zmq_msg_t part;
+            zmq_msg_init(&part);
+            zmq_msg_copy(&part, &body);
+            if (zmq_msg_send(&part, router, 0) < 0) {
+                zmq_msg_close(&part);
+            }
+        }
+        sent++;
+    }
+
+    // последняя ссылка уйдёт вместе с последней отправленной копией
+    zmq_msg_close(&body);
+    return sent;
+}
+
+size_t broadcast_send_copy(void *router, const user_registry *reg, int sender_idx,
+                           const char *text, size_t size, const char *own_text, size_t own_size) {
+    size_t sent = 0;
+    for (size_t i = 0; i < reg->online_count; i++) {
+        int idx = reg->online[i];
+        const user_t *user = &reg->users[idx];
+
+        if (zmq_send(router, user->zmq_id, user->zmq_id_size, ZMQ_SNDMORE) < 0) {
+            continue;
+        }
+        if (idx == sender_idx) {
+            zmq_send(router, own_text, own_size, 0);
+        } else {
+            zmq_send(router, text, size, 0);
+        }
+        sent++;
+    }
+    return sent;
+}
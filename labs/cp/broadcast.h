@@ -0,0 +1,20 @@
+#ifndef BROADCAST_H
+#define BROADCAST_H
+
+#include <stddef.h>
+#include "user_registry.h"
+
+/*
+Рассылка всем пользователям в сети: текст для остальных собирается в одно сообщение
+ZeroMQ один раз, каждому получателю уходит его копия через zmq_msg_copy - копируется
+только счётчик ссылок, не текст. Отправитель (sender_idx) получает own_text.
+Возвращает число получателей
+*/
+size_t broadcast_send(void *router, const user_registry *reg, int sender_idx,
+                      const char *text, size_t size, const char *own_text, size_t own_size);
+
+// то же самое с копированием текста на каждого получателя (прежний способ, для сравнения)
+size_t broadcast_send_copy(void *router, const user_registry *reg, int sender_idx,
+                           const char *text, size_t size, const char *own_text, size_t own_size);
+
+#endif
@@ -0,0 +1,99 @@
+#include <zmq.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "user_registry.h"
+#include "broadcast.h"
+#include "delayed_queue.h"
+
+/*
+Пропускная способность /m @all в зависимости от числа пользователей: рассылка с общим
+буфером (broadcast_send) против копии текста на каждого получателя (broadcast_send_copy).
+Получатели - DEALER-сокеты в том же процессе (inproc), после каждой рассылки они
+вычитываются; время вычитывания в замер не входит
+*/
+
+#define PAYLOAD_SIZE 1000
+#define DELIVERIES_PER_RUN 400000       // рассылок на замер - столько, чтобы доставок было около этого
+
+static const int user_counts[] = {10, 100, 1000, 4000};
+
+
+static void drain(void **dealers, int count) {
+    char buffer[PAYLOAD_SIZE + 64];
+    for (int i = 0; i < count; i++) {
+        while (zmq_recv(dealers[i], buffer, sizeof(buffer), ZMQ_DONTWAIT) >= 0) {
+        }
+    }
+}
+
+static double measure(void *router, void **dealers, const user_registry *reg, int users,
+                      int zero_copy, const char *text, size_t size) {
+    int rounds = DELIVERIES_PER_RUN / users;
+    uint64_t elapsed = 0;
+    size_t delivered = 0;
+
+    for (int r = 0; r < rounds; r++) {
+        uint64_t start = monotonic_ns();
+        if (zero_copy) {
+            delivered += broadcast_send(router, reg, -1, text, size, NULL, 0);
+        } else {
+            delivered += broadcast_send_copy(router, reg, -1, text, size, NULL, 0);
+        }
+        elapsed += monotonic_ns() - start;
+        drain(dealers, users);
+    }
+    return (double)delivered / ((double)elapsed / 1e9);
+}
+
+int main(void) {
+    char text[PAYLOAD_SIZE];
+    memset(text, 'x', sizeof(text));
+
+    printf("Broadcast of %d bytes: deliveries per second\n\n", PAYLOAD_SIZE);
+    printf("%8s %14s %14s %8s\n", "users", "copy", "zero-copy", "speedup");
+
+    for (size_t t = 0; t < sizeof(user_counts) / sizeof(user_counts[0]); t++) {
+        int users = user_counts[t];
+        void *ctx = zmq_ctx_new();
+        zmq_ctx_set(ctx, ZMQ_MAX_SOCKETS, users + 16);
+        void *router = zmq_socket(ctx, ZMQ_ROUTER);
+        zmq_bind(router, "inproc://broadcast");
+
+        user_registry reg;
+        registry_init(&reg);
+        void **dealers = malloc((size_t)users * sizeof(void *));
+
+        for (int i = 0; i < users; i++) {
+            char name[USERNAME_SIZE];
+            snprintf(name, sizeof(name), "user%05d", i);
+            dealers[i] = zmq_socket(ctx, ZMQ_DEALER);
+            zmq_setsockopt(dealers[i], ZMQ_ROUTING_ID, name, strlen(name));
+            zmq_connect(dealers[i], "inproc://broadcast");
+            zmq_send(dealers[i], "JOIN", 4, 0);
+
+            int idx = registry_add(&reg, name);
+            registry_set_id(&reg, idx, name, strlen(name));
+            registry_set_online(&reg, idx, 1);
+        }
+        // роутер узнаёт получателей по их первым сообщениям
+        char buffer[USERNAME_SIZE];
+        for (int i = 0; i < users; i++) {
+            zmq_recv(router, buffer, sizeof(buffer), 0);
+            zmq_recv(router, buffer, sizeof(buffer), 0);
+        }
+
+        double copy = measure(router, dealers, &reg, users, 0, text, sizeof(text));
+        double shared = measure(router, dealers, &reg, users, 1, text, sizeof(text));
+        printf("%8d %14.0f %14.0f %7.2fx\n", users, copy, shared, shared / copy);
+
+        for (int i = 0; i < users; i++) {
+            zmq_close(dealers[i]);
+        }
+        free(dealers);
+        registry_free(&reg);
+        zmq_close(router);
+        zmq_ctx_destroy(ctx);
+    }
+    return 0;
+}
@@ -0,0 +1,130 @@
+#include <arpa/inet.h>
+#include <string.h>
+#include "chat_protocol.h"
+
+
+static int equals(const char *data, size_t size, const char *literal) {
+    size_t length = strlen(literal);
+    return size == length && memcmp(data, literal, length) == 0;
+}
+
+static int has_prefix(const char *data, size_t size, const char *literal) {
+    size_t length = strlen(literal);
+    return size >= length && memcmp(data, literal, length) == 0;
+}
+
+// адресат и текст: общие проверки обоих видов
+static int check_addressed(chat_command *cmd) {
+    if (cmd->target_size == 0 || cmd->payload_size == 0 || cmd->target_size > UINT8_MAX) {
+        return 0;
+    }
+    if (cmd->opcode == CHAT_OP_BROADCAST) {
+        return 1;
+    }
+    // "all" - только рассылка
+    if (equals(cmd->target, cmd->target_size, "all")) {
+        return 0;
+    }
+    return cmd->opcode != CHAT_OP_DELAYED || cmd->delay > 0;
+}
+
+int chat_is_binary(const void *data, size_t size) {
+    return size >= sizeof(chat_header) && *(const uint8_t *)data == CHAT_MAGIC;
+}
+
+int chat_parse_text(const void *data, size_t size, chat_command *cmd) {
+    const char *text = data;
+    memset(cmd, 0, sizeof(*cmd));
+
+    if (equals(text, size, "JOIN")) {
+        cmd->opcode = CHAT_OP_JOIN;
+        return 1;
+    }
+    if (equals(text, size, "/exit")) {
+        cmd->opcode = CHAT_OP_EXIT;
+        return 1;
+    }
+    if (equals(text, size, "PING")) {
+        cmd->opcode = CHAT_OP_PING;
+        return 1;
+    }
+    if (size == 0 || text[0] != '/') {
+        return 0;
+    }
+
+    // "/команда @адресат текст"
+    const char *end = text + size;
+    const char *space1 = memchr(text, ' ', size);
+    if (!space1 || space1 + 1 == end || space1[1] != '@') {
+        return 0;
+    }
+    const char *target = space1 + 2;
+    const char *space2 = memchr(target, ' ', (size_t)(end - target));
+    if (!space2) {
+        return 0;
+    }
+    cmd->target = target;
+    cmd->target_size = (size_t)(space2 - target);
+    cmd->payload = space2 + 1;
+    cmd->payload_size = (size_t)(end - cmd->payload);
+
+    size_t command_size = (size_t)(space1 - text);
+    if (equals(text, command_size, "/m")) {
+        cmd->opcode = equals(cmd->target, cmd->target_size, "all") ? CHAT_OP_BROADCAST : CHAT_OP_DIRECT;
+    } else if (has_prefix(text, command_size, "/dm_")) {
+        // как atoi: цифры до первого нецифрового символа
+        uint32_t delay = 0;
+        for (const char *p = text + 4; p < space1 && *p >= '0' && *p <= '9' && delay < 100000000u; p++) {
+            delay = delay * 10 + (uint32_t)(*p - '0');
+        }
+        cmd->opcode = CHAT_OP_DELAYED;
+        cmd->delay = delay;
+    } else {
+        return 0;
+    }
+    return check_addressed(cmd);
+}
+
+int chat_parse_binary(const void *header, size_t header_size,
+                      const void *payload, size_t payload_size, chat_command *cmd) {
+    chat_header h;
+    memset(cmd, 0, sizeof(*cmd));
+    if (!chat_is_binary(header, header_size)) {
+        return 0;
+    }
+    memcpy(&h, header, sizeof(h));
+    if (sizeof(h) + h.target_size != header_size) {
+        return 0;
+    }
+
+    cmd->opcode = (chat_opcode)h.opcode;
+    if (cmd->opcode == CHAT_OP_JOIN || cmd->opcode == CHAT_OP_EXIT || cmd->opcode == CHAT_OP_PING) {
+        return 1;
+    }
+    if (cmd->opcode < CHAT_OP_DIRECT || cmd->opcode > CHAT_OP_DELAYED || payload == NULL) {
+        return 0;
+    }
+    cmd->target = (const char *)header + sizeof(h);
+    cmd->target_size = h.target_size;
+    cmd->payload = payload;
+    cmd->payload_size = payload_size;
+    cmd->delay = ntohl(h.delay);
+    if (cmd->opcode == CHAT_OP_BROADCAST) {
+        cmd->target = "all";
+        cmd->target_size = 3;
+    }
+    return check_addressed(cmd);
+}
+
+size_t chat_encode_header(void *buf, size_t size, chat_opcode opcode, const char *target, uint32_t delay) {
+    size_t target_size = target ? strlen(target) : 0;
+    if (target_size > UINT8_MAX || sizeof(chat_header) + target_size > size) {
+        return 0;
+    }
+    chat_header h = {CHAT_MAGIC, (uint8_t)opcode, (uint8_t)target_size, 0, htonl(delay)};
+    memcpy(buf, &h, sizeof(h));
+    if (target_size > 0) {
+        memcpy((char *)buf + sizeof(h), target, target_size);
+    }
+    return sizeof(h) + target_size;
+}
@@ -0,0 +1,60 @@
+#ifndef CHAT_PROTOCOL_H
+#define CHAT_PROTOCOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+Команды клиента, два вида (сервер принимает оба):
+    текстовый (CLI client.c), один кадр: "JOIN", "/exit", "PING", "/m @имя текст",
+        "/m @all текст", "/dm_N @имя текст"
+    двоичный: [заголовок][текст] - кадр заголовка chat_header, сразу за ним в том же кадре
+        имя адресата (оно же его routing id), и кадр текста; у JOIN, EXIT и PING кадр текста
+        не нужен
+PING - пульс клиента: кто молчит дольше CHAT_IDLE_TIMEOUT, считается ушедшим
+Разбор не копирует: chat_command указывает прямо в данные кадров (zmq_msg_data)
+*/
+
+// первый байт двоичного заголовка: в UTF-8 не встречается, текстовую команду с ним не спутать
+#define CHAT_MAGIC 0xFE
+
+typedef enum {
+    CHAT_OP_JOIN = 1,
+    CHAT_OP_EXIT,
+    CHAT_OP_DIRECT,                 // /m @имя
+    CHAT_OP_BROADCAST,              // /m @all
+    CHAT_OP_DELAYED,                // /dm_N @имя
+    CHAT_OP_PING
+} chat_opcode;
+
+// как часто клиенты шлют PING, секунды
+#define CHAT_HEARTBEAT_INTERVAL 10
+
+typedef struct {
+    uint8_t magic;
+    uint8_t opcode;
+    uint8_t target_size;            // байт имени адресата после заголовка
+    uint8_t reserved;
+    uint32_t delay;                 // задержка CHAT_OP_DELAYED, секунды; сетевой порядок байт
+} chat_header;
+
+typedef struct {
+    chat_opcode opcode;
+    const char *target;             // без завершающего нуля
+    size_t target_size;
+    const char *payload;            // без завершающего нуля
+    size_t payload_size;
+    uint32_t delay;
+} chat_command;
+
+int chat_is_binary(const void *data, size_t size);
+
+// 1 - команда разобрана, 0 - не команда (такое сообщение сервер молча пропускает)
+int chat_parse_text(const void *data, size_t size, chat_command *cmd);
+int chat_parse_binary(const void *header, size_t header_size,
+                      const void *payload, size_t payload_size, chat_command *cmd);
+
+// кадр заголовка для двоичной команды в buf; возвращает его размер (0 - имя не помещается)
+size_t chat_encode_header(void *buf, size_t size, chat_opcode opcode, const char *target, uint32_t delay);
+
+#endif
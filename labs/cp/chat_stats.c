@@ -0,0 +1,54 @@
+#include <zmq.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+/*
+Метрики работающего сервера: запрос в его REP-сокет (server_stats.c) и вывод ответа.
+С периодом - повторять запрос, частоты и процентили тогда считаются за этот период
+*/
+
+#define REPORT_SIZE 16384
+#define REPLY_TIMEOUT_MS 2000
+
+
+int main(int argc, char **argv) {
+    const char *endpoint = (argc > 1) ? argv[1] : "tcp://localhost:5556";
+    int period = (argc > 2) ? atoi(argv[2]) : 0;
+    if (argc > 3 || (argc > 2 && period <= 0)) {
+        fprintf(stderr, "Usage: %s [endpoint] [period, s]\n", argv[0]);
+        return 1;
+    }
+
+    void *ctx = zmq_ctx_new();
+    void *req = zmq_socket(ctx, ZMQ_REQ);
+    int timeout = REPLY_TIMEOUT_MS;
+    int linger = 0;
+    zmq_setsockopt(req, ZMQ_RCVTIMEO, &timeout, sizeof(timeout));
+    zmq_setsockopt(req, ZMQ_LINGER, &linger, sizeof(linger));
+    zmq_connect(req, endpoint);
+
+    static char report[REPORT_SIZE + 1];
+    int status = 0;
+    while (1) {
+        zmq_send(req, "stats", 5, 0);
+        int size = zmq_recv(req, report, REPORT_SIZE, 0);
+        if (size < 0) {
+            fprintf(stderr, "%s: %s\n", endpoint, zmq_strerror(zmq_errno()));
+            status = 1;
+            break;
+        }
+        report[(size < REPORT_SIZE) ? size : REPORT_SIZE] = '\0';
+        fputs(report, stdout);
+        if (period == 0) {
+            break;
+        }
+        printf("\n");
+        fflush(stdout);
+        sleep((unsigned)period);
+    }
+
+    zmq_close(req);
+    zmq_ctx_destroy(ctx);
+    return status;
+}
@@ -0,0 +1,712 @@
+#include <zmq.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "chat_worker.h"
+#include "broadcast.h"
+#include "event_log.h"
+#include "chat_protocol.h"
+
+/*
+Обработчик шарда: разбор команд, форматирование, журнал и рассылка - всё, кроме ввода-вывода
+клиентских сокетов (это фронтенд в server.c).
+Команда клиента приходит в шард отправителя. Если адресат в другом шарде, готовый текст
+пересылается туда (D), рассылка всем - каждому шарду (B), отложенное сообщение ставится
+в очередь шарда адресата (S): доставкой, почтовым ящиком и журналом сообщения владеет
+шард получателя
+*/
+
+#define MAX_MSG_LEN 1024
+#define TIME_LEN 16
+#define MAX_FRAMES 6
+
+
+void format_time(time_t t, char *buf, size_t size) {
+    struct tm tm;
+    localtime_r(&t, &tm);
+    snprintf(buf, size,
+             "%02d:%02d:%02d",
+             tm.tm_hour,
+             tm.tm_min,
+             tm.tm_sec);
+}
+
+int worker_shard(const void *key, size_t size, int count) {
+    // старшие биты хэша: младшие выбирают ячейку в индексах реестра внутри шарда
+    return (int)(((uint64_t)registry_hash(key, size) * (uint64_t)count) >> 32);
+}
+
+static int name_shard(const chat_worker *w, const char *name) {
+    return worker_shard(name, strlen(name), w->count);
+}
+
+static void send_frames(void *socket, const void *const *data, const size_t *sizes, int count) {
+    for (int i = 0; i < count; i++) {
+        zmq_send(socket, data[i], sizes[i], (i + 1 < count) ? ZMQ_SNDMORE : 0);
+    }
+}
+
+static void send_to_user(chat_worker *w, const user_t *user, const char *text) {
+    zmq_send(w->outbound, user->zmq_id, user->zmq_id_size, ZMQ_SNDMORE);
+    zmq_send(w->outbound, text, strlen(text), 0);
+}
+
+// кадр как строка (с обрезкой до размера буфера)
+static void frame_string(zmq_msg_t *frame, char *buf, size_t size) {
+    size_t length = zmq_msg_size(frame);
+    if (length >= size) {
+        length = size - 1;
+    }
+    memcpy(buf, zmq_msg_data(frame), length);
+    buf[length] = '\0';
+}
+
+// ---- доставка своим пользователям ----
+
+static void deliver_text(chat_worker *w, const char *target, const char *text) {
+    int r_idx = registry_find(&w->reg, target);
+    if (r_idx >= 0 && w->reg.users[r_idx].online) {
+        send_to_user(w, &w->reg.users[r_idx], text);
+    }
+}
+
+static void send_delayed(chat_worker *w, const user_t *user, const delayed_msg_t *d) {
+    char ts[TIME_LEN];
+    evlog_timestamp(ts, sizeof(ts));
+    evlog(EVLOG_INFO, "%s (DELAYED DELIVERED) %s -> %s: %s", ts, d->sender, d->receiver, d->payload);
+
+    char out[MAX_MSG_LEN];
+    snprintf(out, sizeof(out), "%s (delayed) %s -> %s: %s", ts, d->sender, d->receiver, d->payload);
+    send_to_user(w, user, out);
+}
+
+// origin - сообщение уже в журнале этого шарда (NULL - новое, ещё нигде не записано)
+static void forward_schedule(chat_worker *w, int shard, uint64_t deliver_wall,
+                             const char *sender, const char *receiver, const char *payload,
+                             const worker_handoff *origin) {
+    char type = WORKER_SCHEDULE;
+    const void *data[] = {&type, &deliver_wall, sender, receiver, payload, origin};
+    size_t sizes[] = {1, sizeof(deliver_wall), strlen(sender), strlen(receiver), strlen(payload),
+                      sizeof(worker_handoff)};
+    send_frames(w->peers[shard], data, sizes, origin ? 6 : 5);
+}
+
+static void schedule_local(chat_worker *w, uint64_t deliver_wall,
+                           const char *sender, const char *receiver, const char *payload) {
+    uint64_t now_wall = realtime_ns();
+    uint64_t left = (deliver_wall > now_wall) ? deliver_wall - now_wall : 0;
+    delayed_msg_t *d = delayed_push(&w->delayed, monotonic_ns() + left, sender, receiver, payload);
+    d->deliver_wall = deliver_wall;
+    log_append_schedule(&w->log, d);
+}
+
+/*
+Доставка всех отложенных сообщений, срок которых наступил. Если адресат не в сети,
+сообщение ждёт в его почтовом ящике до JOIN (и остаётся в журнале). Сообщение чужого
+шарда (восстановлено из журнала при другом числе обработчиков) передаётся владельцу,
+но DONE пишется только по его A - когда SCHEDULE уже в журнале владельца: сбой между
+двумя fdatasync даёт повторную доставку, а не потерю
+*/
+static void deliver_due(chat_worker *w) {
+    delayed_msg_t *d;
+    while ((d = delayed_pop_due(&w->delayed, monotonic_ns())) != NULL) {
+        int shard = name_shard(w, d->receiver);
+        if (shard != w->index) {
+            if (d->id == 0) {
+                // журнала нет - хранить до подтверждения нечего
+                forward_schedule(w, shard, d->deliver_wall, d->sender, d->receiver, d->payload, NULL);
+                delayed_msg_free(d);
+                continue;
+            }
+            worker_handoff origin = {d->id, w->index};
+            forward_schedule(w, shard, d->deliver_wall, d->sender, d->receiver, d->payload, &origin);
+            d->next = w->handoff;
+            w->handoff = d;
+            continue;
+        }
+
+        int r_idx = registry_find(&w->reg, d->receiver);
+        if (r_idx >= 0 && w->reg.users[r_idx].online) {
+            send_delayed(w, &w->reg.users[r_idx], d);
+            log_append_done(&w->log, d->id);
+            delayed_msg_free(d);
+            continue;
+        }
+
+        if (r_idx < 0) {
+            r_idx = registry_add(&w->reg, d->receiver);
+        }
+        user_t *user = &w->reg.users[r_idx];
+        d->next = NULL;
+        if (user->mailbox_tail) {
+            user->mailbox_tail->next = d;
+        } else {
+            user->mailbox = d;
+        }
+        user->mailbox_tail = d;
+        w->stored++;
+
+        char ts[TIME_LEN];
+        evlog_timestamp(ts, sizeof(ts));
+        evlog(EVLOG_INFO, "%s (DELAYED STORED) %s -> %s: %s (receiver offline)", ts, d->sender, d->receiver, d->payload);
+    }
+}
+
+// store-and-forward: всё, что накопилось, пока пользователь был не в сети
+static void deliver_mailbox(chat_worker *w, int idx) {
+    user_t *user = &w->reg.users[idx];
+    delayed_msg_t *d = user->mailbox;
+    user->mailbox = NULL;
+    user->mailbox_tail = NULL;
+
+    while (d != NULL) {
+        delayed_msg_t *next = d->next;
+        w->stored--;
+        send_delayed(w, user, d);
+        log_append_done(&w->log, d->id);
+        delayed_msg_free(d);
+        d = next;
+    }
+}
+
+// ---- передача сообщений между журналами шардов ----
+
+// принятый S с origin: подтвердить, когда его SCHEDULE будет на диске
+static void queue_ack(chat_worker *w, const worker_handoff *origin) {
+    if (w->ack_count == w->ack_capacity) {
+        w->ack_capacity = w->ack_capacity ? w->ack_capacity * 2 : 16;
+        w->acks = realloc(w->acks, w->ack_capacity * sizeof(worker_handoff));
+        if (w->acks == NULL) {
+            perror("realloc");
+            exit(1);
+        }
+    }
+    w->acks[w->ack_count++] = *origin;
+}
+
+// вызывается, когда в журнале не осталось несброшенных записей
+static void send_acks(chat_worker *w) {
+    for (size_t i = 0; i < w->ack_count; i++) {
+        char type = WORKER_ACK;
+        const void *data[] = {&type, &w->acks[i].id};
+        size_t sizes[] = {1, sizeof(w->acks[i].id)};
+        send_frames(w->peers[w->acks[i].shard], data, sizes, 2);
+    }
+    w->ack_count = 0;
+}
+
+// A от владельца: сообщение в его журнале, своя запись больше не нужна
+static void handoff_done(chat_worker *w, uint64_t id) {
+    // список короткий и бывает непустым только после смены числа обработчиков
+    for (delayed_msg_t **p = &w->handoff; *p != NULL; p = &(*p)->next) {
+        if ((*p)->id == id) {
+            delayed_msg_t *d = *p;
+            *p = d->next;
+            log_append_done(&w->log, d->id);
+            delayed_msg_free(d);
+            return;
+        }
+    }
+}
+
+// сжатие журнала: живые сообщения - это куча, почтовые ящики и неподтверждённые передачи
+static void compact_log(chat_worker *w) {
+    log_compact_begin(&w->log);
+    for (size_t i = 0; i < w->delayed.count; i++) {
+        log_compact_add(&w->log, w->delayed.heap[i].msg);
+    }
+    for (const delayed_msg_t *d = w->handoff; d != NULL; d = d->next) {
+        log_compact_add(&w->log, d);
+    }
+    for (size_t i = 0; i < w->reg.count; i++) {
+        for (const delayed_msg_t *d = w->reg.users[i].mailbox; d != NULL; d = d->next) {
+            log_compact_add(&w->log, d);
+        }
+    }
+    log_compact_finish(&w->log);
+}
+
+// ---- вход и уход клиента ----
+
+// how - "joined" (JOIN) или "rejoined" (команда клиента, которого сервер счёл ушедшим)
+static void set_online(chat_worker *w, int idx, zmq_msg_t *id, const char *how) {
+    registry_set_online(&w->reg, idx, 1);
+    registry_set_id(&w->reg, idx, zmq_msg_data(id), zmq_msg_size(id));
+    w->reg.users[idx].last_seen = monotonic_ns();
+    stats_set(&w->stats->online, w->reg.online_count);
+
+    char ts[TIME_LEN];
+    evlog_timestamp(ts, sizeof(ts));
+    evlog(EVLOG_INFO, "%s client %s: %s", ts, how, w->reg.users[idx].name);
+    deliver_mailbox(w, idx);
+}
+
+// пользователь не в сети: рассылки ему больше не идут, отложенные копятся в почтовом ящике
+static void set_offline(chat_worker *w, int idx) {
+    registry_set_online(&w->reg, idx, 0);
+    registry_clear_id(&w->reg, idx);
+    stats_set(&w->stats->online, w->reg.online_count);
+}
+
+/*
+Клиенты, от которых дольше idle_timeout не было ни одной команды (клиент шлёт PING раз
+в CHAT_HEARTBEAT_INTERVAL): процесс упал или сеть пропала, а /exit так и не пришёл.
+Список online просматривается с конца - set_offline ставит на место ушедшего последнего
+*/
+static void evict_idle(chat_worker *w, uint64_t now) {
+    for (size_t i = w->reg.online_count; i-- > 0;) {
+        int idx = w->reg.online[i];
+        user_t *user = &w->reg.users[idx];
+        if (now - user->last_seen < w->idle_timeout) {
+            continue;
+        }
+        char ts[TIME_LEN];
+        evlog_timestamp(ts, sizeof(ts));
+        evlog(EVLOG_WARN, "%s client timed out: %s (no commands for %llu s)", ts, user->name,
+              (unsigned long long)((now - user->last_seen) / 1000000000ull));
+        set_offline(w, idx);
+        stats_add(&w->stats->evicted_idle, 1);
+    }
+}
+
+// ---- команды клиента ----
+
+// текст команды для snprintf("%.*s"): ограничен так же, как исходящее сообщение
+static int text_length(size_t size) {
+    return (int)((size < MAX_MSG_LEN) ? size : MAX_MSG_LEN);
+}
+
+static void handle_direct(chat_worker *w, const char *sender, const char *target,
+                          const char *payload, int payload_len, const char *ts) {
+    evlog(EVLOG_INFO, "%s %s -> %s: %.*s", ts, sender, target, payload_len, payload);
+
+    char out[MAX_MSG_LEN];
+    if (strcmp(target, sender) == 0) {
+        snprintf(out, sizeof(out), "%s Me: %.*s", ts, payload_len, payload);
+    } else {
+        snprintf(out, sizeof(out), "%s %s -> %s: %.*s", ts, sender, target, payload_len, payload);
+    }
+
+    int shard = name_shard(w, target);
+    if (shard == w->index) {
+        deliver_text(w, target, out);
+    } else {
+        char type = WORKER_DELIVER;
+        const void *data[] = {&type, target, out};
+        size_t sizes[] = {1, strlen(target), strlen(out)};
+        send_frames(w->peers[shard], data, sizes, 3);
+    }
+}
+
+static void handle_broadcast(chat_worker *w, const char *sender,
+                             const char *payload, int payload_len, const char *ts) {
+    evlog(EVLOG_INFO, "%s %s -> all: %.*s", ts, sender, payload_len, payload);
+    char out_other[MAX_MSG_LEN];
+    char out_me[MAX_MSG_LEN];
+
+    snprintf(out_other, sizeof(out_other), "%s %s -> all: %.*s", ts, sender, payload_len, payload);
+    snprintf(out_me, sizeof(out_me), "%s Me: %.*s", ts, payload_len, payload);
+
+    // остальные шарды рассылают своим пользователям параллельно с этим
+    char type = WORKER_BROADCAST;
+    const void *data[] = {&type, sender, out_other, out_me};
+    size_t sizes[] = {1, strlen(sender), strlen(out_other), strlen(out_me)};
+    for (int i = 0; i < w->count; i++) {
+        if (i != w->index) {
+            send_frames(w->peers[i], data, sizes, 4);
+        }
+    }
+    broadcast_send(w->outbound, &w->reg, registry_find(&w->reg, sender),
+                   out_other, strlen(out_other), out_me, strlen(out_me));
+}
+
+static void handle_delayed(chat_worker *w, const char *sender, const char *target,
+                           const char *payload, int payload_len, uint32_t delay, const char *ts) {
+    // отложенное сообщение хранится в очереди и журнале - текст копируется туда в любом случае
+    char text[MAX_MSG_LEN];
+    snprintf(text, sizeof(text), "%.*s", payload_len, payload);
+
+    time_t eta_wall = time(NULL) + delay;
+    char eta[TIME_LEN];
+    format_time(eta_wall, eta, sizeof(eta));
+
+    evlog(EVLOG_INFO, "%s (DELAYED) %s -> %s: %s (ETA %s)", ts, sender, target, text, eta);
+
+    uint64_t deliver_wall = realtime_ns() + (uint64_t)delay * 1000000000ull;
+    int shard = name_shard(w, target);
+    if (shard == w->index) {
+        schedule_local(w, deliver_wall, sender, target, text);
+    } else {
+        forward_schedule(w, shard, deliver_wall, sender, target, text, NULL);
+    }
+}
+
+/*
+Команда клиента: frames - кадры после routing id, текстовая команда или двоичная
+(chat_protocol.h). Текст команды разбирается прямо в кадре, без копирования в буфер.
+Возвращает команду (для статистики), 0 - не команда
+*/
+static chat_opcode handle_client(chat_worker *w, zmq_msg_t *id, zmq_msg_t *frames, int count) {
+    chat_command cmd;
+    void *data = zmq_msg_data(&frames[0]);
+    size_t size = zmq_msg_size(&frames[0]);
+    int parsed;
+    if (chat_is_binary(data, size)) {
+        parsed = chat_parse_binary(data, size, (count > 1) ? zmq_msg_data(&frames[1]) : NULL,
+                                   (count > 1) ? zmq_msg_size(&frames[1]) : 0, &cmd);
+    } else {
+        parsed = chat_parse_text(data, size, &cmd);
+    }
+    if (!parsed) {
+        return 0;
+    }
+
+    char sender[USERNAME_SIZE];
+    frame_string(id, sender, sizeof(sender));
+
+    // routing id есть в реестре только у пользователей в сети
+    int self = registry_find_id(&w->reg, zmq_msg_data(id), zmq_msg_size(id));
+    if (self >= 0) {
+        // любая команда, не только PING, - признак живого клиента
+        w->reg.users[self].last_seen = monotonic_ns();
+    } else if (cmd.opcode != CHAT_OP_JOIN && cmd.opcode != CHAT_OP_EXIT) {
+        /*
+        Сервер отключил клиента (молчал дольше CHAT_IDLE_TIMEOUT или не успевал читать),
+        а клиент об этом не знает и JOIN повторно не пришлёт: его команда (хотя бы PING
+        раз в CHAT_HEARTBEAT_INTERVAL) - неявный JOIN
+        */
+        self = registry_find(&w->reg, sender);
+        if (self >= 0) {
+            set_online(w, self, id, "rejoined");
+        }
+    }
+    if (cmd.opcode == CHAT_OP_PING) {
+        return cmd.opcode;
+    }
+
+    char ts[TIME_LEN];
+    evlog_timestamp(ts, sizeof(ts));
+
+    if (cmd.opcode == CHAT_OP_JOIN) {
+        int idx = registry_find(&w->reg, sender);
+        if (idx >= 0 && w->reg.users[idx].online) {
+            return cmd.opcode;
+        }
+
+        if (idx < 0) {
+            idx = registry_add(&w->reg, sender);
+        }
+        set_online(w, idx, id, "joined");
+        return cmd.opcode;
+    }
+    if (cmd.opcode == CHAT_OP_EXIT) {
+        if (self >= 0) {
+            set_offline(w, self);
+        }
+        evlog(EVLOG_INFO, "%s client disconnected: %s", ts, sender);
+        return cmd.opcode;
+    }
+
+    // имя адресата - ключ реестра и шарда, ему нужна строка (не длиннее 255 байт)
+    char target[USERNAME_SIZE];
+    memcpy(target, cmd.target, cmd.target_size);
+    target[cmd.target_size] = '\0';
+    int payload_len = text_length(cmd.payload_size);
+
+    if (cmd.opcode == CHAT_OP_BROADCAST) {
+        handle_broadcast(w, sender, cmd.payload, payload_len, ts);
+    } else if (cmd.opcode == CHAT_OP_DIRECT) {
+        handle_direct(w, sender, target, cmd.payload, payload_len, ts);
+    } else {
+        handle_delayed(w, sender, target, cmd.payload, payload_len, cmd.delay, ts);
+    }
+    return cmd.opcode;
+}
+
+// ---- внутренние сообщения ----
+
+static int recv_frames(void *socket, zmq_msg_t *frames, int max) {
+    int count = 0;
+    int more = 1;
+    while (more) {
+        zmq_msg_t frame;
+        zmq_msg_init(&frame);
+        if (zmq_msg_recv(&frame, socket, 0) < 0) {
+            zmq_msg_close(&frame);
+            break;
+        }
+        more = zmq_msg_more(&frame);
+        if (count < max) {
+            frames[count++] = frame;
+        } else {
+            zmq_msg_close(&frame);
+        }
+    }
+    return count;
+}
+
+static void handle_inbox(chat_worker *w) {
+    zmq_msg_t frames[MAX_FRAMES];
+    int count = recv_frames(w->inbox, frames, MAX_FRAMES);
+    if (count < 1 || zmq_msg_size(&frames[0]) != 1) {
+        goto done;
+    }
+
+    char type = *(char *)zmq_msg_data(&frames[0]);
+    if (type != WORKER_CLIENT) {
+        stats_add(&w->stats->forwarded, 1);
+    }
+    if (type == WORKER_CLIENT && count >= 3) {
+        uint64_t start = monotonic_ns();
+        chat_opcode opcode = handle_client(w, &frames[1], &frames[2], count - 2);
+        if (opcode != 0) {
+            stats_record_command(w->stats, opcode, monotonic_ns() - start);
+        }
+    } else if (type == WORKER_DELIVER && count >= 3) {
+        char target[USERNAME_SIZE];
+        char text[MAX_MSG_LEN];
+        frame_string(&frames[1], target, sizeof(target));
+        frame_string(&frames[2], text, sizeof(text));
+        deliver_text(w, target, text);
+    } else if (type == WORKER_BROADCAST && count >= 4) {
+        char sender[USERNAME_SIZE];
+        frame_string(&frames[1], sender, sizeof(sender));
+        broadcast_send(w->outbound, &w->reg, registry_find(&w->reg, sender),
+                       zmq_msg_data(&frames[2]), zmq_msg_size(&frames[2]),
+                       zmq_msg_data(&frames[3]), zmq_msg_size(&frames[3]));
+    } else if (type == WORKER_SCHEDULE && count >= 5 && zmq_msg_size(&frames[1]) == sizeof(uint64_t)) {
+        uint64_t deliver_wall;
+        char sender[USERNAME_SIZE];
+        char receiver[USERNAME_SIZE];
+        char payload[MAX_MSG_LEN];
+        memcpy(&deliver_wall, zmq_msg_data(&frames[1]), sizeof(deliver_wall));
+        frame_string(&frames[2], sender, sizeof(sender));
+        frame_string(&frames[3], receiver, sizeof(receiver));
+        frame_string(&frames[4], payload, sizeof(payload));
+        schedule_local(w, deliver_wall, sender, receiver, payload);
+        if (count >= 6 && zmq_msg_size(&frames[5]) == sizeof(worker_handoff)) {
+            worker_handoff origin;
+            memcpy(&origin, zmq_msg_data(&frames[5]), sizeof(origin));
+            if (origin.shard >= 0 && origin.shard < w->count && origin.shard != w->index) {
+                queue_ack(w, &origin);
+            }
+        }
+    } else if (type == WORKER_ACK && count >= 2 && zmq_msg_size(&frames[1]) == sizeof(uint64_t)) {
+        uint64_t id;
+        memcpy(&id, zmq_msg_data(&frames[1]), sizeof(id));
+        handoff_done(w, id);
+    } else if (type == WORKER_EVICT && count >= 2) {
+        int idx = registry_find_id(&w->reg, zmq_msg_data(&frames[1]), zmq_msg_size(&frames[1]));
+        if (idx >= 0 && w->reg.users[idx].online) {
+            char ts[TIME_LEN];
+            evlog_timestamp(ts, sizeof(ts));
+            evlog(EVLOG_WARN, "%s client evicted: %s (outbound queue full)", ts, w->reg.users[idx].name);
+            set_offline(w, idx);
+            stats_add(&w->stats->evicted_slow, 1);
+        }
+    }
+
+done:
+    for (int i = 0; i < count; i++) {
+        zmq_msg_close(&frames[i]);
+    }
+}
+
+static void publish_queue_stats(chat_worker *w) {
+    stats_set(&w->stats->delayed_queued, w->delayed.count);
+    stats_set(&w->stats->delayed_stored, w->stored);
+    stats_set(&w->stats->next_deadline, w->delayed.count ? w->delayed.heap[0].deliver_at : 0);
+}
+
+static void *worker_loop(void *arg) {
+    chat_worker *w = arg;
+    zmq_pollitem_t items[] = {
+        {w->inbox, 0, ZMQ_POLLIN, 0}
+    };
+
+    while (1) {
+        deliver_due(w);
+
+        // group commit: пока входящие идут потоком, записи копятся; на первой паузе -
+        // один fdatasync на всю пачку
+        if (log_pending(&w->log) && (log_group_full(&w->log) || zmq_poll(items, 1, 0) == 0)) {
+            log_commit(&w->log);
+        }
+        if (log_should_compact(&w->log)) {
+            compact_log(w);
+        }
+        // принятые передачи подтверждаются, только когда их SCHEDULE сброшен на диск
+        if (w->ack_count > 0 && !log_pending(&w->log)) {
+            send_acks(w);
+        }
+
+        // проверка молчащих - раз в четверть таймаута и только пока кто-то в сети:
+        // пустой шард спит до ближайшего отложенного сообщения, как раньше
+        uint64_t now = monotonic_ns();
+        long timeout = delayed_timeout_ms(&w->delayed, now);
+        if (w->idle_timeout > 0 && w->reg.online_count > 0) {
+            if (now >= w->next_sweep) {
+                evict_idle(w, now);
+                w->next_sweep = now + w->idle_timeout / 4;
+            }
+            long sweep = (long)((w->next_sweep - now + 999999) / 1000000);
+            if (timeout < 0 || sweep < timeout) {
+                timeout = sweep;
+            }
+        }
+
+        publish_queue_stats(w);
+        if (zmq_poll(items, 1, timeout) < 0) {
+            break;
+        }
+        if (items[0].revents & ZMQ_POLLIN) {
+            handle_inbox(w);
+        }
+    }
+    return NULL;
+}
+
+// восстановление из журнала: срок переводится из CLOCK_REALTIME обратно в CLOCK_MONOTONIC
+typedef struct {
+    delayed_queue *delayed;
+    uint64_t now_mono;
+    uint64_t now_wall;
+} replay_context;
+
+static void replay_delayed(void *context, uint64_t id, uint64_t deliver_wall,
+                           const char *sender, const char *receiver, const char *payload) {
+    replay_context *rc = context;
+    uint64_t left = (deliver_wall > rc->now_wall) ? deliver_wall - rc->now_wall : 0;
+    delayed_msg_t *d = delayed_push(rc->delayed, rc->now_mono + left, sender, receiver, payload);
+    d->id = id;
+    d->deliver_wall = deliver_wall;
+}
+
+/*
+Журналы, оставшиеся от запуска с другим числом обработчиков (CHAT_LOG.<n> вне нового
+диапазона или CHAT_LOG без номера): их живые сообщения переписываются в журналы шардов
+адресатов, и только после сброса этих журналов на диск старый файл удаляется
+*/
+static void adopt_message(void *context, uint64_t id, uint64_t deliver_wall,
+                          const char *sender, const char *receiver, const char *payload) {
+    chat_worker *workers = context;
+    (void)id;
+    chat_worker *owner = &workers[worker_shard(receiver, strlen(receiver), workers[0].count)];
+    schedule_local(owner, deliver_wall, sender, receiver, payload);
+}
+
+static void adopt_log(chat_worker *workers, const char *path) {
+    if (access(path, F_OK) != 0) {
+        return;
+    }
+    message_log stray;
+    if (!log_open(&stray, path, adopt_message, workers)) {
+        return;
+    }
+    for (int i = 0; i < workers[0].count; i++) {
+        log_commit(&workers[i].log);
+    }
+    evlog(EVLOG_INFO, "Adopted %llu delayed messages from %s", (unsigned long long)stray.live, path);
+    log_close(&stray);
+    unlink(path);
+}
+
+static void adopt_stray_logs(chat_worker *workers, const char *base) {
+    char path[4096];
+    int count = workers[0].count;
+    if (count > 1) {
+        adopt_log(workers, base);
+    }
+    for (int j = (count == 1) ? 0 : count; j < CHAT_MAX_WORKERS; j++) {
+        snprintf(path, sizeof(path), "%s.%d", base, j);
+        adopt_log(workers, path);
+    }
+}
+
+static void *internal_socket(void *ctx, int type) {
+    void *socket = zmq_socket(ctx, type);
+    if (socket == NULL) {
+        fprintf(stderr, "zmq_socket: %s\n", zmq_strerror(zmq_errno()));
+        exit(1);
+    }
+    // внутренние очереди не ограничены: фронтенд не должен блокироваться на обработчике
+    int hwm = 0;
+    zmq_setsockopt(socket, ZMQ_SNDHWM, &hwm, sizeof(hwm));
+    zmq_setsockopt(socket, ZMQ_RCVHWM, &hwm, sizeof(hwm));
+    return socket;
+}
+
+/*
+Все сокеты создаются и связываются здесь, до запуска потоков; дальше каждым сокетом
+пользуется только его поток (pthread_create - барьер памяти, как требует ZeroMQ).
+Журнал шарда: CHAT_LOG (или chat.log) для одного обработчика, CHAT_LOG.<номер> для нескольких
+*/
+chat_worker *workers_start(void *ctx, int count) {
+    chat_worker *workers = calloc((size_t)count, sizeof(chat_worker));
+    if (workers == NULL) {
+        perror("calloc");
+        exit(1);
+    }
+
+    const char *idle = getenv(CHAT_IDLE_TIMEOUT_ENV);
+    long idle_timeout = idle ? atol(idle) : CHAT_IDLE_TIMEOUT_DEFAULT;
+
+    char endpoint[64];
+    for (int i = 0; i < count; i++) {
+        workers[i].index = i;
+        workers[i].count = count;
+        workers[i].idle_timeout = (idle_timeout > 0) ? (uint64_t)idle_timeout * 1000000000ull : 0;
+        workers[i].inbox = internal_socket(ctx, ZMQ_PULL);
+        snprintf(endpoint, sizeof(endpoint), WORKER_ENDPOINT_FORMAT, i);
+        if (zmq_bind(workers[i].inbox, endpoint) != 0) {
+            fprintf(stderr, "%s: %s\n", endpoint, zmq_strerror(zmq_errno()));
+            exit(1);
+        }
+    }
+
+    const char *base = getenv("CHAT_LOG") ? getenv("CHAT_LOG") : LOG_PATH_DEFAULT;
+    for (int i = 0; i < count; i++) {
+        chat_worker *w = &workers[i];
+        w->outbound = internal_socket(ctx, ZMQ_PUSH);
+        zmq_connect(w->outbound, OUTBOUND_ENDPOINT);
+        for (int j = 0; j < count; j++) {
+            if (j == i) {
+                continue;
+            }
+            w->peers[j] = internal_socket(ctx, ZMQ_PUSH);
+            snprintf(endpoint, sizeof(endpoint), WORKER_ENDPOINT_FORMAT, j);
+            zmq_connect(w->peers[j], endpoint);
+        }
+
+        registry_init(&w->reg);
+        delayed_init(&w->delayed);
+        w->stats = calloc(1, sizeof(worker_stats));
+        if (w->stats == NULL) {
+            perror("calloc");
+            exit(1);
+        }
+
+        char path[4096];
+        if (count == 1) {
+            snprintf(path, sizeof(path), "%s", base);
+        } else {
+            snprintf(path, sizeof(path), "%s.%d", base, i);
+        }
+        replay_context rc = {&w->delayed, monotonic_ns(), realtime_ns()};
+        if (log_open(&w->log, path, replay_delayed, &rc)) {
+            evlog(EVLOG_INFO, "Restored %zu delayed messages from %s", w->delayed.count, w->log.path);
+        }
+    }
+
+    adopt_stray_logs(workers, base);
+
+    for (int i = 0; i < count; i++) {
+        if (pthread_create(&workers[i].thread, NULL, worker_loop, &workers[i]) != 0) {
+            perror("pthread_create");
+            exit(1);
+        }
+    }
+    return workers;
+}
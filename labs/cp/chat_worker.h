@@ -0,0 +1,77 @@
+#ifndef CHAT_WORKER_H
+#define CHAT_WORKER_H
+
+#include <pthread.h>
+#include <stdint.h>
+#include "user_registry.h"
+#include "delayed_queue.h"
+#include "message_log.h"
+#include "server_stats.h"
+
+#define CHAT_MAX_WORKERS 64
+// потоки-обработчики по умолчанию (переопределяется аргументом сервера или CHAT_WORKERS)
+#define CHAT_WORKERS_ENV "CHAT_WORKERS"
+// через сколько секунд без команд (в том числе PING) клиент считается ушедшим; 0 - никогда
+#define CHAT_IDLE_TIMEOUT_ENV "CHAT_IDLE_TIMEOUT"
+#define CHAT_IDLE_TIMEOUT_DEFAULT 30
+
+// куда обработчики отдают исходящие [routing id][текст], фронтенд пересылает их в ROUTER
+#define OUTBOUND_ENDPOINT "inproc://chat-outbound"
+#define WORKER_ENDPOINT_FORMAT "inproc://chat-worker-%d"
+
+/*
+Внутренние сообщения обработчику (первый кадр - тип):
+    C [routing id][команда...]            - сообщение клиента (от фронтенда), chat_protocol.h
+    D [адресат][текст]                    - доставить готовый текст своему пользователю
+    B [отправитель][текст][текст себе]    - рассылка всем пользователям своего шарда
+    S [срок CLOCK_REALTIME][отправитель][адресат][текст] - отложенное сообщение адресату шарда
+    S [срок][отправитель][адресат][текст][worker_handoff] - то же, сообщение из журнала
+                                          другого шарда: после сброса своего журнала - A
+    A [id]                                - передача подтверждена: отправитель S пишет DONE
+    E [routing id]                        - отключить клиента: его очередь во фронтенде переполнена
+*/
+#define WORKER_CLIENT 'C'
+#define WORKER_DELIVER 'D'
+#define WORKER_BROADCAST 'B'
+#define WORKER_SCHEDULE 'S'
+#define WORKER_EVICT 'E'
+#define WORKER_ACK 'A'
+
+// откуда пришло отложенное сообщение: шард и id в его журнале
+typedef struct {
+    uint64_t id;
+    int32_t shard;
+} worker_handoff;
+
+/*
+Обработчик - шард пользователей: свои реестр, очередь отложенных сообщений и журнал.
+Пользователь принадлежит шарду по хэшу имени (routing id клиента совпадает с именем,
+поэтому фронтенд выбирает шард по routing id, не разбирая сообщение)
+*/
+typedef struct {
+    int index;
+    int count;
+    void *inbox;                    // PULL: от фронтенда и других обработчиков
+    void *outbound;                 // PUSH: к фронтенду
+    void *peers[CHAT_MAX_WORKERS];  // PUSH: во входящие других обработчиков (свой - NULL)
+    user_registry reg;
+    delayed_queue delayed;
+    message_log log;
+    size_t stored;                  // сообщений в почтовых ящиках
+    delayed_msg_t *handoff;         // переданы владельцу, ждут A (живы в своём журнале)
+    worker_handoff *acks;           // принятые S, A на которые - после log_commit
+    size_t ack_count;
+    size_t ack_capacity;
+    uint64_t idle_timeout;          // нс, 0 - не отключать молчащих
+    uint64_t next_sweep;            // CLOCK_MONOTONIC следующей проверки молчащих
+    worker_stats *stats;
+    pthread_t thread;
+} chat_worker;
+
+// номер шарда для имени / routing id
+int worker_shard(const void *key, size_t size, int count);
+
+// сокеты, журналы (с восстановлением) и потоки count обработчиков
+chat_worker *workers_start(void *ctx, int count);
+
+#endif
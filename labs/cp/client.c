@@ -1,9 +1,18 @@
 #include <zmq.h>
 #include <stdio.h>
 #include <string.h>
+#include <time.h>
 #include <unistd.h>
+#include "chat_protocol.h"
 
 #define MAX_MSG_LEN 1024
+#define HEARTBEAT_MS (CHAT_HEARTBEAT_INTERVAL * 1000)
+
+static long long monotonic_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
 
 int main(int argc, char **argv) {
     if (argc != 2) {
@@ -23,9 +32,20 @@ int main(int argc, char **argv) {
         { NULL,   STDIN_FILENO, ZMQ_POLLIN, 0 }
     };
 
+    /*
+    Пульс: если клиент ничего не отправлял CHAT_HEARTBEAT_INTERVAL, уходит PING, иначе сервер
+    сочтёт его ушедшим. Отсчёт - от последней отправки, а не от последнего события:
+    входящие сообщения не мешают пульсу того, кто только читает
+    */
+    long long next_ping = monotonic_ms() + HEARTBEAT_MS;
     char buffer[MAX_MSG_LEN];
     while (1) {
-        zmq_poll(items, 2, -1);
+        long long now = monotonic_ms();
+        if (now >= next_ping) {
+            zmq_send(dealer, "PING", 4, 0);
+            next_ping = now + HEARTBEAT_MS;
+        }
+        zmq_poll(items, 2, (long)(next_ping - now));
 
         if (items[0].revents & ZMQ_POLLIN) {
             int size = zmq_recv(dealer, buffer, sizeof(buffer) - 1, 0);
@@ -44,6 +64,7 @@ int main(int argc, char **argv) {
                 continue;
             }
             zmq_send(dealer, buffer, strlen(buffer), 0);
+            next_ping = monotonic_ms() + HEARTBEAT_MS;
             if (strcmp(buffer, "/exit") == 0) {
                 break;
             }
@@ -0,0 +1,141 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "delayed_queue.h"
+
+/*
+Планировщик отложенных сообщений - двоичная min-куча по сроку доставки.
+Вставка и извлечение - O(log n), ближайший срок - O(1): сервер не просматривает все
+сообщения после каждого poll, а спит ровно до ближайшего срока
+*/
+
+#define QUEUE_INITIAL_CAPACITY 64
+
+
+uint64_t monotonic_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+uint64_t realtime_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+void delayed_init(delayed_queue *queue) {
+    memset(queue, 0, sizeof(*queue));
+}
+
+void delayed_msg_free(delayed_msg_t *msg) {
+    free(msg);
+}
+
+void delayed_free(delayed_queue *queue) {
+    for (size_t i = 0; i < queue->count; i++) {
+        delayed_msg_free(queue->heap[i].msg);
+    }
+    free(queue->heap);
+    memset(queue, 0, sizeof(*queue));
+}
+
+static int node_less(const delayed_node *a, const delayed_node *b) {
+    return a->deliver_at < b->deliver_at || (a->deliver_at == b->deliver_at && a->seq < b->seq);
+}
+
+static void sift_up(delayed_node *heap, size_t i) {
+    delayed_node node = heap[i];
+    while (i > 0) {
+        size_t parent = (i - 1) / 2;
+        if (!node_less(&node, &heap[parent])) {
+            break;
+        }
+        heap[i] = heap[parent];
+        i = parent;
+    }
+    heap[i] = node;
+}
+
+static void sift_down(delayed_node *heap, size_t count, size_t i) {
+    delayed_node node = heap[i];
+    for (;;) {
+        size_t child = 2 * i + 1;
+        if (child >= count) {
+            break;
+        }
+        if (child + 1 < count && node_less(&heap[child + 1], &heap[child])) {
+            child++;
+        }
+        if (!node_less(&heap[child], &node)) {
+            break;
+        }
+        heap[i] = heap[child];
+        i = child;
+    }
+    heap[i] = node;
+}
+
+delayed_msg_t *delayed_push(delayed_queue *queue, uint64_t deliver_at,
+                            const char *sender, const char *receiver, const char *payload) {
+    size_t sender_len = strlen(sender) + 1;
+    size_t receiver_len = strlen(receiver) + 1;
+    size_t payload_len = strlen(payload) + 1;
+
+    delayed_msg_t *msg = malloc(sizeof(delayed_msg_t) + sender_len + receiver_len + payload_len);
+    if (msg == NULL) {
+        perror("malloc");
+        exit(1);
+    }
+    msg->sender = (char *)(msg + 1);
+    msg->receiver = msg->sender + sender_len;
+    msg->payload = msg->receiver + receiver_len;
+    memcpy(msg->sender, sender, sender_len);
+    memcpy(msg->receiver, receiver, receiver_len);
+    memcpy(msg->payload, payload, payload_len);
+    msg->deliver_at = deliver_at;
+    msg->seq = queue->next_seq++;
+    msg->id = 0;
+    msg->deliver_wall = 0;
+    msg->next = NULL;
+
+    if (queue->count == queue->capacity) {
+        size_t capacity = queue->capacity ? queue->capacity * 2 : QUEUE_INITIAL_CAPACITY;
+        delayed_node *heap = realloc(queue->heap, capacity * sizeof(delayed_node));
+        if (heap == NULL) {
+            perror("realloc");
+            exit(1);
+        }
+        queue->heap = heap;
+        queue->capacity = capacity;
+    }
+
+    queue->heap[queue->count] = (delayed_node){deliver_at, msg->seq, msg};
+    sift_up(queue->heap, queue->count++);
+    return msg;
+}
+
+delayed_msg_t *delayed_pop_due(delayed_queue *queue, uint64_t now) {
+    if (queue->count == 0 || queue->heap[0].deliver_at > now) {
+        return NULL;
+    }
+    delayed_msg_t *msg = queue->heap[0].msg;
+    queue->heap[0] = queue->heap[--queue->count];
+    if (queue->count > 0) {
+        sift_down(queue->heap, queue->count, 0);
+    }
+    return msg;
+}
+
+long delayed_timeout_ms(const delayed_queue *queue, uint64_t now) {
+    if (queue->count == 0) {
+        return -1;
+    }
+    uint64_t deadline = queue->heap[0].deliver_at;
+    if (deadline <= now) {
+        return 0;
+    }
+    // вверх до миллисекунды: проснуться раньше срока - лишний пустой цикл
+    return (long)((deadline - now + 999999) / 1000000);
+}
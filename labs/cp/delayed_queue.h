@@ -0,0 +1,53 @@
+#ifndef DELAYED_QUEUE_H
+#define DELAYED_QUEUE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+Отложенное сообщение (/dm_N). Строки лежат в одном блоке с самой структурой,
+поэтому память - ровно под текст, а не под три буфера максимального размера
+*/
+typedef struct delayed_msg {
+    uint64_t deliver_at;            // CLOCK_MONOTONIC, нс
+    uint64_t seq;                   // порядок постановки: при равных сроках - FIFO
+    uint64_t id;                    // номер в журнале (message_log)
+    uint64_t deliver_wall;          // тот же срок по CLOCK_REALTIME - переживает перезапуск
+    struct delayed_msg *next;       // очередь в почтовом ящике получателя, пока он не в сети
+    char *sender;
+    char *receiver;
+    char *payload;
+} delayed_msg_t;
+
+// элемент кучи: ключ хранится рядом с указателем, сравнение не трогает само сообщение
+typedef struct {
+    uint64_t deliver_at;
+    uint64_t seq;
+    delayed_msg_t *msg;
+} delayed_node;
+
+// двоичная куча по (deliver_at, seq); растёт удвоением, без ограничения числа сообщений
+typedef struct {
+    delayed_node *heap;
+    size_t count;
+    size_t capacity;
+    uint64_t next_seq;
+} delayed_queue;
+
+uint64_t monotonic_ns(void);
+uint64_t realtime_ns(void);
+
+void delayed_init(delayed_queue *queue);
+void delayed_free(delayed_queue *queue);
+
+delayed_msg_t *delayed_push(delayed_queue *queue, uint64_t deliver_at,
+                            const char *sender, const char *receiver, const char *payload);
+
+// самое раннее сообщение, если его срок наступил к now (иначе NULL); освобождать delayed_msg_free
+delayed_msg_t *delayed_pop_due(delayed_queue *queue, uint64_t now);
+void delayed_msg_free(delayed_msg_t *msg);
+
+// таймаут zmq_poll до ближайшего срока: -1 - очередь пуста, 0 - срок уже наступил
+long delayed_timeout_ms(const delayed_queue *queue, uint64_t now);
+
+#endif
@@ -0,0 +1,313 @@
+#include <errno.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/uio.h>
+#include <time.h>
+#include <unistd.h>
+#include "event_log.h"
+
+/*
+Ограниченная очередь многих писателей и одного читателя: у каждой ячейки свой номер seq.
+    seq == pos                  - ячейка свободна для строки номер pos
+    seq == pos + 1              - строка pos записана, её можно выводить
+    seq == pos + EVLOG_CAPACITY - выведена, ячейка свободна для следующего круга
+Писатель занимает номер CAS-ом head, читатель идёт по tail один. Когда выводить нечего,
+читатель спит на условной переменной; будят его только если он действительно спит, так что
+под нагрузкой писатели не делают системных вызовов
+*/
+
+#define EVLOG_MASK (EVLOG_CAPACITY - 1)
+// не чаще раза в секунду - строка об отброшенных строках
+#define DROP_REPORT_NS 1000000000ull
+
+typedef struct {
+    _Atomic uint64_t seq;
+    uint32_t length;
+    char text[EVLOG_LINE_SIZE];
+} evlog_slot;
+
+static struct {
+    evlog_slot *slots;
+    _Atomic uint64_t head;
+    uint64_t tail;                  // только поток записи
+    _Atomic uint64_t written;
+    _Atomic uint64_t dropped;
+    _Atomic int level;
+    _Atomic int sleeping;
+    _Atomic int stopping;
+    int fd;
+    pthread_t thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t wake;
+} logger = {
+    .level = EVLOG_INFO,
+    .fd = STDOUT_FILENO,
+    .mutex = PTHREAD_MUTEX_INITIALIZER,
+    .wake = PTHREAD_COND_INITIALIZER
+};
+
+
+void evlog_timestamp(char *buf, size_t size) {
+    static __thread time_t cached_second = -1;
+    static __thread char cached[16];
+
+    time_t now = time(NULL);
+    if (now != cached_second) {
+        struct tm tm;
+        localtime_r(&now, &tm);
+        snprintf(cached, sizeof(cached), "[%02d:%02d:%02d]", tm.tm_hour, tm.tm_min, tm.tm_sec);
+        cached_second = now;
+    }
+    snprintf(buf, size, "%s", cached);
+}
+
+static uint64_t clock_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+// строка в буфер с обрезкой и переводом строки; возвращает длину
+static uint32_t format_line(char *buf, const char *format, va_list args) {
+    int length = vsnprintf(buf, EVLOG_LINE_SIZE, format, args);
+    if (length < 0) {
+        length = 0;
+    }
+    if (length >= EVLOG_LINE_SIZE - 1) {
+        length = EVLOG_LINE_SIZE - 4;
+        memcpy(buf + length - 3, "...", 3);
+    }
+    buf[length] = '\n';
+    return (uint32_t)length + 1;
+}
+
+// записать всё, дописывая после частичной записи; ошибка - строки считаются отброшенными
+static void write_all(struct iovec *iov, int count, uint64_t lines) {
+    while (count > 0) {
+        ssize_t n = writev(logger.fd, iov, count);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            atomic_fetch_add_explicit(&logger.dropped, lines, memory_order_relaxed);
+            return;
+        }
+        while (count > 0 && (size_t)n >= iov->iov_len) {
+            n -= (ssize_t)iov->iov_len;
+            iov++;
+            count--;
+        }
+        if (count > 0) {
+            iov->iov_base = (char *)iov->iov_base + n;
+            iov->iov_len -= (size_t)n;
+        }
+    }
+    atomic_fetch_add_explicit(&logger.written, lines, memory_order_relaxed);
+}
+
+static int slot_ready(uint64_t pos) {
+    return atomic_load(&logger.slots[pos & EVLOG_MASK].seq) == pos + 1;
+}
+
+// вывести готовые строки пачками; 0 - выводить было нечего
+static int drain(void) {
+    int any = 0;
+    struct iovec iov[EVLOG_BATCH];
+
+    while (1) {
+        int count = 0;
+        while (count < EVLOG_BATCH && slot_ready(logger.tail + (uint64_t)count)) {
+            evlog_slot *slot = &logger.slots[(logger.tail + (uint64_t)count) & EVLOG_MASK];
+            iov[count].iov_base = slot->text;
+            iov[count].iov_len = slot->length;
+            count++;
+        }
+        if (count == 0) {
+            return any;
+        }
+
+        write_all(iov, count, (uint64_t)count);
+        for (int i = 0; i < count; i++) {
+            uint64_t pos = logger.tail + (uint64_t)i;
+            atomic_store_explicit(&logger.slots[pos & EVLOG_MASK].seq, pos + EVLOG_CAPACITY,
+                                  memory_order_release);
+        }
+        logger.tail += (uint64_t)count;
+        any = 1;
+    }
+}
+
+static void report_dropped(uint64_t *reported) {
+    uint64_t dropped = atomic_load_explicit(&logger.dropped, memory_order_relaxed);
+    if (dropped == *reported) {
+        return;
+    }
+    char line[96];
+    int length = snprintf(line, sizeof(line), "(event log: %llu lines dropped, buffer full)\n",
+                          (unsigned long long)(dropped - *reported));
+    if (write(logger.fd, line, (size_t)length) < 0) {
+        return;
+    }
+    *reported = dropped;
+}
+
+static void *writer_thread(void *arg) {
+    (void)arg;
+    uint64_t reported = 0;
+    uint64_t last_report = clock_ns();
+
+    while (1) {
+        int any = drain();
+
+        uint64_t now = clock_ns();
+        if (now - last_report >= DROP_REPORT_NS) {
+            report_dropped(&reported);
+            last_report = now;
+        }
+        if (any) {
+            continue;
+        }
+
+        pthread_mutex_lock(&logger.mutex);
+        atomic_store(&logger.sleeping, 1);
+        if (!slot_ready(logger.tail) && !atomic_load(&logger.stopping)) {
+            struct timespec until;
+            clock_gettime(CLOCK_REALTIME, &until);
+            until.tv_sec += 1;
+            pthread_cond_timedwait(&logger.wake, &logger.mutex, &until);
+        }
+        atomic_store(&logger.sleeping, 0);
+        int stopping = atomic_load(&logger.stopping);
+        pthread_mutex_unlock(&logger.mutex);
+
+        if (stopping && !slot_ready(logger.tail)) {
+            break;
+        }
+    }
+    report_dropped(&reported);
+    return NULL;
+}
+
+static evlog_level parse_level(const char *value) {
+    static const char *names[] = {"error", "warn", "info", "debug"};
+    for (int i = 0; i <= EVLOG_DEBUG; i++) {
+        if (strcasecmp(value, names[i]) == 0) {
+            return (evlog_level)i;
+        }
+    }
+    int level = atoi(value);
+    if (level < EVLOG_ERROR) {
+        return EVLOG_ERROR;
+    }
+    return (level > EVLOG_DEBUG) ? EVLOG_DEBUG : (evlog_level)level;
+}
+
+void evlog_start(int fd) {
+    const char *value = getenv(EVLOG_LEVEL_ENV);
+    if (value) {
+        evlog_set_level(parse_level(value));
+    }
+
+    logger.slots = malloc(EVLOG_CAPACITY * sizeof(evlog_slot));
+    if (!logger.slots) {
+        perror("malloc");
+        exit(1);
+    }
+    for (uint64_t i = 0; i < EVLOG_CAPACITY; i++) {
+        atomic_init(&logger.slots[i].seq, i);
+    }
+    logger.fd = fd;
+    logger.tail = 0;
+    atomic_store(&logger.head, 0);
+    atomic_store(&logger.stopping, 0);
+
+    if (pthread_create(&logger.thread, NULL, writer_thread, NULL) != 0) {
+        perror("pthread_create");
+        exit(1);
+    }
+}
+
+void evlog_stop(void) {
+    if (!logger.slots) {
+        return;
+    }
+    pthread_mutex_lock(&logger.mutex);
+    atomic_store(&logger.stopping, 1);
+    pthread_cond_signal(&logger.wake);
+    pthread_mutex_unlock(&logger.mutex);
+    pthread_join(logger.thread, NULL);
+
+    free(logger.slots);
+    logger.slots = NULL;
+}
+
+void evlog_set_level(evlog_level level) {
+    atomic_store_explicit(&logger.level, (int)level, memory_order_relaxed);
+}
+
+int evlog_enabled(evlog_level level) {
+    return (int)level <= atomic_load_explicit(&logger.level, memory_order_relaxed);
+}
+
+void evlog(evlog_level level, const char *format, ...) {
+    if (!evlog_enabled(level)) {
+        return;
+    }
+    va_list args;
+    va_start(args, format);
+
+    if (!logger.slots) {
+        char line[EVLOG_LINE_SIZE];
+        uint32_t length = format_line(line, format, args);
+        va_end(args);
+        if (write(logger.fd, line, length) < 0) {
+            atomic_fetch_add_explicit(&logger.dropped, 1, memory_order_relaxed);
+        }
+        return;
+    }
+
+    uint64_t pos = atomic_load_explicit(&logger.head, memory_order_relaxed);
+    evlog_slot *slot;
+    while (1) {
+        slot = &logger.slots[pos & EVLOG_MASK];
+        uint64_t seq = atomic_load_explicit(&slot->seq, memory_order_acquire);
+        if (seq == pos) {
+            if (atomic_compare_exchange_weak_explicit(&logger.head, &pos, pos + 1,
+                                                      memory_order_relaxed, memory_order_relaxed)) {
+                break;
+            }
+        } else if (seq < pos) {
+            // буфер полон: поток записи отстал (медленный терминал или канал)
+            va_end(args);
+            atomic_fetch_add_explicit(&logger.dropped, 1, memory_order_relaxed);
+            return;
+        } else {
+            pos = atomic_load_explicit(&logger.head, memory_order_relaxed);
+        }
+    }
+
+    slot->length = format_line(slot->text, format, args);
+    va_end(args);
+
+    // публикация и проверка sleeping - seq_cst: либо поток записи увидит строку,
+    // либо писатель увидит, что тот спит, и разбудит его
+    atomic_store(&slot->seq, pos + 1);
+    if (atomic_load(&logger.sleeping)) {
+        pthread_mutex_lock(&logger.mutex);
+        pthread_cond_signal(&logger.wake);
+        pthread_mutex_unlock(&logger.mutex);
+    }
+}
+
+uint64_t evlog_written(void) {
+    return atomic_load_explicit(&logger.written, memory_order_relaxed);
+}
+
+uint64_t evlog_dropped(void) {
+    return atomic_load_explicit(&logger.dropped, memory_order_relaxed);
+}
@@ -0,0 +1,47 @@
+#ifndef EVENT_LOG_H
+#define EVENT_LOG_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+Журнал событий сервера (то, что раньше печаталось printf в stdout).
+Строка форматируется в вызывающем потоке и кладётся в кольцевой буфер без блокировок,
+в файл её пишет фоновый поток - пачками, одним writev. Поток обработчика не ждёт
+терминал или канал: если буфер полон, строка отбрасывается и учитывается в счётчике.
+Не путать с message_log - журналом отложенных сообщений на диске
+*/
+
+typedef enum {
+    EVLOG_ERROR,
+    EVLOG_WARN,
+    EVLOG_INFO,
+    EVLOG_DEBUG
+} evlog_level;
+
+// уровень: error | warn | info | debug (или число 0-3), по умолчанию info
+#define EVLOG_LEVEL_ENV "CHAT_LOG_LEVEL"
+
+#define EVLOG_CAPACITY 4096             // строк в буфере, степень двойки
+#define EVLOG_LINE_SIZE 512             // длиннее - обрезаются
+#define EVLOG_BATCH 64                  // строк на один writev
+
+// запустить фоновую запись в fd; уровень - из CHAT_LOG_LEVEL
+void evlog_start(int fd);
+
+// дописать всё, что в буфере, и остановить поток
+void evlog_stop(void);
+
+void evlog_set_level(evlog_level level);
+int evlog_enabled(evlog_level level);
+
+// строка журнала (перевод строки добавляется); до evlog_start пишется сразу
+void evlog(evlog_level level, const char *format, ...) __attribute__((format(printf, 2, 3)));
+
+uint64_t evlog_written(void);
+uint64_t evlog_dropped(void);
+
+// "[ЧЧ:ММ:СС]": localtime_r вызывается раз в секунду в каждом потоке, а не на каждое сообщение
+void evlog_timestamp(char *buf, size_t size);
+
+#endif
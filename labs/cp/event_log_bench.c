@@ -0,0 +1,135 @@
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "event_log.h"
+#include "delayed_queue.h"
+
+/*
+Сколько стоит строка журнала потоку, который обрабатывает сообщения, когда вывод медленный.
+Журнал пишется в канал, который читатель вычитывает с ограниченной скоростью (как терминал
+или перегруженный сборщик логов). Сравниваются прежний путь - localtime + snprintf + printf
+в построчно буферизованный FILE - и event_log. Меряется время вызовов в потоках-писателях:
+среднее и самая долгая остановка; сколько строк event_log отбросил
+*/
+
+#define LINES 100000
+#define READ_CHUNK 16384                // читатель: столько байт...
+#define READ_PAUSE_NS 1000000           // ...раз в миллисекунду (около 16 МБ/с)
+
+static const int thread_counts[] = {1, 4};
+
+typedef struct {
+    int sync;
+    int lines;
+    FILE *out;
+    uint64_t elapsed;
+    uint64_t longest;
+} writer_args;
+
+
+static void *slow_reader(void *arg) {
+    int fd = *(int *)arg;
+    char buffer[READ_CHUNK];
+    struct timespec pause = {0, READ_PAUSE_NS};
+    while (read(fd, buffer, sizeof(buffer)) > 0) {
+        nanosleep(&pause, NULL);
+    }
+    return NULL;
+}
+
+// прежний current_time + printf
+static void sync_line(FILE *out, int i) {
+    time_t t = time(NULL);
+    struct tm tm;
+    localtime_r(&t, &tm);
+    char ts[16];
+    snprintf(ts, sizeof(ts), "[%02d:%02d:%02d]", tm.tm_hour, tm.tm_min, tm.tm_sec);
+    fprintf(out, "%s user%05d -> user%05d: message number %d\n", ts, i % 1000, (i * 7) % 1000, i);
+}
+
+static void async_line(int i) {
+    char ts[16];
+    evlog_timestamp(ts, sizeof(ts));
+    evlog(EVLOG_INFO, "%s user%05d -> user%05d: message number %d", ts, i % 1000, (i * 7) % 1000, i);
+}
+
+static void *writer(void *arg) {
+    writer_args *a = arg;
+    for (int i = 0; i < a->lines; i++) {
+        uint64_t start = monotonic_ns();
+        if (a->sync) {
+            sync_line(a->out, i);
+        } else {
+            async_line(i);
+        }
+        uint64_t spent = monotonic_ns() - start;
+        a->elapsed += spent;
+        if (spent > a->longest) {
+            a->longest = spent;
+        }
+    }
+    return NULL;
+}
+
+static void run(int sync, int threads) {
+    int fds[2];
+    if (pipe(fds) != 0) {
+        perror("pipe");
+        exit(1);
+    }
+    pthread_t reader;
+    pthread_create(&reader, NULL, slow_reader, &fds[0]);
+
+    FILE *out = NULL;
+    uint64_t dropped = evlog_dropped();
+    if (sync) {
+        out = fdopen(fds[1], "w");
+        setvbuf(out, NULL, _IOLBF, 0);
+    } else {
+        evlog_start(fds[1]);
+    }
+
+    pthread_t tids[8];
+    writer_args args[8];
+    for (int t = 0; t < threads; t++) {
+        args[t] = (writer_args){sync, LINES / threads, out, 0, 0};
+        pthread_create(&tids[t], NULL, writer, &args[t]);
+    }
+    uint64_t elapsed = 0;
+    uint64_t longest = 0;
+    for (int t = 0; t < threads; t++) {
+        pthread_join(tids[t], NULL);
+        elapsed += args[t].elapsed;
+        if (args[t].longest > longest) {
+            longest = args[t].longest;
+        }
+    }
+
+    if (sync) {
+        fclose(out);
+    } else {
+        evlog_stop();
+        close(fds[1]);
+    }
+    pthread_join(reader, NULL);
+    close(fds[0]);
+
+    printf("%8s %8d %12.0f %12.2f %10llu\n", sync ? "printf" : "evlog", threads,
+           (double)elapsed / LINES, (double)longest / 1e6,
+           (unsigned long long)(evlog_dropped() - dropped));
+}
+
+int main(void) {
+    printf("Event log: %d lines into a pipe drained at ~%.0f MB/s, cost in the calling threads\n\n",
+           LINES, (double)READ_CHUNK * (1e9 / READ_PAUSE_NS) / 1e6);
+    printf("%8s %8s %12s %12s %10s\n", "path", "threads", "ns/line", "max stall,ms", "dropped");
+
+    for (size_t t = 0; t < sizeof(thread_counts) / sizeof(thread_counts[0]); t++) {
+        run(1, thread_counts[t]);
+        run(0, thread_counts[t]);
+    }
+    return 0;
+}
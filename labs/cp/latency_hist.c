@@ -0,0 +1,68 @@
+#include <string.h>
+#include "latency_hist.h"
+
+
+int hist_bucket(uint64_t value) {
+    if (value < HIST_SUB_COUNT) {
+        return (int)value;
+    }
+    int shift = 63 - __builtin_clzll(value) - HIST_SUB_BITS;
+    return ((shift + 1) << HIST_SUB_BITS) + (int)((value >> shift) - HIST_SUB_COUNT);
+}
+
+uint64_t hist_bucket_top(int bucket) {
+    if (bucket < HIST_SUB_COUNT) {
+        return (uint64_t)bucket;
+    }
+    int shift = (bucket >> HIST_SUB_BITS) - 1;
+    uint64_t sub = (uint64_t)(bucket & (HIST_SUB_COUNT - 1)) + HIST_SUB_COUNT;
+    return ((sub + 1) << shift) - 1;
+}
+
+void hist_init(latency_hist *hist) {
+    memset(hist, 0, sizeof(*hist));
+    hist->min = UINT64_MAX;
+}
+
+void hist_record(latency_hist *hist, uint64_t value) {
+    hist->counts[hist_bucket(value)]++;
+    hist->total++;
+    if (value < hist->min) {
+        hist->min = value;
+    }
+    if (value > hist->max) {
+        hist->max = value;
+    }
+}
+
+void hist_merge(latency_hist *into, const latency_hist *from) {
+    for (int i = 0; i < HIST_BUCKETS; i++) {
+        into->counts[i] += from->counts[i];
+    }
+    into->total += from->total;
+    if (from->min < into->min) {
+        into->min = from->min;
+    }
+    if (from->max > into->max) {
+        into->max = from->max;
+    }
+}
+
+uint64_t hist_percentile(const latency_hist *hist, double percentile) {
+    if (hist->total == 0) {
+        return 0;
+    }
+    uint64_t rank = (uint64_t)(percentile / 100.0 * (double)hist->total + 0.5);
+    if (rank < 1) {
+        rank = 1;
+    }
+    uint64_t seen = 0;
+    for (int i = 0; i < HIST_BUCKETS; i++) {
+        seen += hist->counts[i];
+        if (seen >= rank) {
+            uint64_t top = hist_bucket_top(i);
+            return (top > hist->max) ? hist->max : top;
+        }
+    }
+    return hist->max;
+}
@@ -0,0 +1,33 @@
+#ifndef LATENCY_HIST_H
+#define LATENCY_HIST_H
+
+#include <stdint.h>
+
+/*
+Гистограмма задержек в духе HdrHistogram: логарифмические диапазоны (степени двойки),
+каждый поделён на 2^HIST_SUB_BITS равных частей. Относительная ошибка значения - не больше
+1/128 на всём диапазоне uint64, запись - сдвиг и инкремент, без поиска и выделения памяти
+*/
+#define HIST_SUB_BITS 7
+#define HIST_SUB_COUNT (1 << HIST_SUB_BITS)
+#define HIST_BUCKETS ((64 - HIST_SUB_BITS + 1) * HIST_SUB_COUNT)
+
+typedef struct {
+    uint64_t counts[HIST_BUCKETS];
+    uint64_t total;
+    uint64_t min;
+    uint64_t max;
+} latency_hist;
+
+void hist_init(latency_hist *hist);
+void hist_record(latency_hist *hist, uint64_t value);
+void hist_merge(latency_hist *into, const latency_hist *from);
+
+// ячейка значения и наибольшее значение в ячейке (для своих счётчиков, как в server_stats)
+int hist_bucket(uint64_t value);
+uint64_t hist_bucket_top(int bucket);
+
+// значение, не меньше которого percentile процентов записей (верхняя граница ячейки)
+uint64_t hist_percentile(const latency_hist *hist, double percentile);
+
+#endif
@@ -0,0 +1,419 @@
+#define _GNU_SOURCE
+#include <zmq.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "chat_protocol.h"
+#include "latency_hist.h"
+#include "delayed_queue.h"
+
+/*
+Генератор нагрузки для server.c: много пользователей (DEALER с routing id = имя) в нескольких
+потоках, заданная смесь личных сообщений, рассылок и отложенных сообщений с заданной суммарной
+частотой. В начало текста каждого сообщения записывается вид и время отправки - получатель
+считает задержку доставки, у отложенных - опоздание относительно срока.
+Время отправки - запланированное, а не фактическое: если генератор или сервер отстал,
+ожидание в очереди попадает в задержку (поправка на coordinated omission, как в wrk2/HdrHistogram).
+Пользователи и сервер - на одной машине: часы CLOCK_MONOTONIC общие
+*/
+
+#define MAX_THREADS 64
+#define MAX_MSG_LEN 1024
+#define NAME_FORMAT "load%05d"
+#define JOIN_RETRY_MS 1000              // JOIN без подтверждения отправляется снова
+#define JOIN_TIMEOUT_MS 30000           // столько ждём, пока сервер подтвердит всех
+#define DRAIN_EXTRA_MS 2000             // после отправки ждём доставки (и ещё срок отложенных)
+
+// метка в начале текста: "LG" вид, 16 hex-цифр времени отправки
+#define MARK_SIZE 19
+// личное сообщение самому себе, подтверждающее JOIN (record_delivery его не считает)
+#define JOIN_PROBE "LGj"
+
+enum { KIND_DIRECT, KIND_BROADCAST, KIND_DELAYED, KIND_COUNT };
+static const char kind_marks[KIND_COUNT] = {'d', 'b', 's'};
+static const char *kind_names[KIND_COUNT] = {"direct", "broadcast", "delayed"};
+
+static struct {
+    int threads;
+    int users;
+    double rate;                    // сообщений в секунду, всего
+    int duration;                   // секунд отправки
+    int mix[KIND_COUNT];            // веса видов
+    int payload;                    // байт текста, вместе с меткой
+    int delay;                      // секунд у отложенных
+    int binary;
+    const char *endpoint;
+} opt = {4, 1000, 2000, 10, {95, 1, 4}, 64, 1, 1, "tcp://localhost:5555"};
+
+typedef struct {
+    int index;
+    int first_user;
+    int users;
+    void *ctx;
+    void **sockets;
+    uint32_t random;
+    uint64_t sent[KIND_COUNT];
+    uint64_t received[KIND_COUNT];
+    latency_hist hist[KIND_COUNT];
+    pthread_t thread;
+} load_thread;
+
+static pthread_barrier_t joined;
+
+
+static uint32_t next_random(uint32_t *state) {
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return x;
+}
+
+static void send_command(void *socket, chat_opcode opcode, const char *target,
+                         const char *payload, size_t size) {
+    if (opt.binary) {
+        char header[sizeof(chat_header) + 256];
+        size_t header_size = chat_encode_header(header, sizeof(header), opcode, target,
+                                                (uint32_t)opt.delay);
+        int more = (opcode != CHAT_OP_JOIN && opcode != CHAT_OP_EXIT && opcode != CHAT_OP_PING);
+        zmq_send(socket, header, header_size, more ? ZMQ_SNDMORE : 0);
+        if (more) {
+            zmq_send(socket, payload, size, 0);
+        }
+        return;
+    }
+
+    char text[MAX_MSG_LEN + 300];
+    int length;
+    switch (opcode) {
+    case CHAT_OP_JOIN:
+        length = snprintf(text, sizeof(text), "JOIN");
+        break;
+    case CHAT_OP_EXIT:
+        length = snprintf(text, sizeof(text), "/exit");
+        break;
+    case CHAT_OP_PING:
+        length = snprintf(text, sizeof(text), "PING");
+        break;
+    case CHAT_OP_DELAYED:
+        length = snprintf(text, sizeof(text), "/dm_%d @%s %.*s", opt.delay, target, (int)size, payload);
+        break;
+    default:
+        // в двоичном заголовке рассылке адресат не нужен, в тексте это "/m @all"
+        length = snprintf(text, sizeof(text), "/m @%s %.*s",
+                          (opcode == CHAT_OP_BROADCAST) ? "all" : target, (int)size, payload);
+        break;
+    }
+    zmq_send(socket, text, (size_t)length, 0);
+}
+
+static void send_one(load_thread *t, uint64_t scheduled) {
+    uint32_t pick = next_random(&t->random) % (uint32_t)(opt.mix[0] + opt.mix[1] + opt.mix[2]);
+    int kind = KIND_DIRECT;
+    while (pick >= (uint32_t)opt.mix[kind]) {
+        pick -= (uint32_t)opt.mix[kind];
+        kind++;
+    }
+
+    char payload[MAX_MSG_LEN];
+    snprintf(payload, sizeof(payload), "LG%c%016llx", kind_marks[kind], (unsigned long long)scheduled);
+    memset(payload + MARK_SIZE, 'x', (size_t)opt.payload - MARK_SIZE);
+
+    char target[32];
+    snprintf(target, sizeof(target), NAME_FORMAT, (int)(next_random(&t->random) % (uint32_t)opt.users));
+    void *socket = t->sockets[next_random(&t->random) % (uint32_t)t->users];
+
+    static const chat_opcode opcodes[KIND_COUNT] = {CHAT_OP_DIRECT, CHAT_OP_BROADCAST, CHAT_OP_DELAYED};
+    send_command(socket, opcodes[kind], kind == KIND_BROADCAST ? "" : target, payload, (size_t)opt.payload);
+    t->sent[kind]++;
+}
+
+// задержка по метке в тексте доставленного сообщения
+static void record_delivery(load_thread *t, const char *text, size_t size, uint64_t now) {
+    const char *mark = memmem(text, size, "LG", 2);
+    if (mark == NULL || (size_t)(text + size - mark) < MARK_SIZE) {
+        return;
+    }
+    int kind = 0;
+    while (kind < KIND_COUNT && kind_marks[kind] != mark[2]) {
+        kind++;
+    }
+    if (kind == KIND_COUNT) {
+        return;
+    }
+    uint64_t sent = 0;
+    for (int i = 3; i < MARK_SIZE; i++) {
+        char c = mark[i];
+        sent = (sent << 4) | (uint64_t)((c <= '9') ? c - '0' : c - 'a' + 10);
+    }
+
+    uint64_t expected = sent + ((kind == KIND_DELAYED) ? (uint64_t)opt.delay * 1000000000ull : 0);
+    t->received[kind]++;
+    hist_record(&t->hist[kind], (now > expected) ? now - expected : 0);
+}
+
+/*
+Подтверждение JOIN: каждый пользователь пишет себе личное сообщение и ждёт эха. Команды одного
+пользователя сервер обрабатывает по порядку, а личное сообщение доставляет только тому, кто
+online, - эхо значит, что JOIN принят. Без подтверждения JOIN и проба повторяются каждые
+JOIN_RETRY_MS (повторный JOIN уже вошедшего сервер игнорирует). Так к началу замера сервер
+знает всех и недоставка не путается с запоздавшим JOIN
+*/
+static void confirm_joins(load_thread *t, zmq_pollitem_t *items) {
+    char *confirmed = calloc((size_t)t->users, 1);
+    if (confirmed == NULL) {
+        perror("calloc");
+        exit(1);
+    }
+    int pending = t->users;
+    uint64_t deadline = monotonic_ns() + JOIN_TIMEOUT_MS * 1000000ull;
+    uint64_t next_retry = 0;
+    char buffer[MAX_MSG_LEN + 300];
+
+    while (pending > 0) {
+        uint64_t now = monotonic_ns();
+        if (now >= deadline) {
+            fprintf(stderr, "loadgen: %d of %d users got no JOIN confirmation in %d s (server at %s?)\n",
+                    pending, t->users, JOIN_TIMEOUT_MS / 1000, opt.endpoint);
+            exit(1);
+        }
+        if (now >= next_retry) {
+            for (int i = 0; i < t->users; i++) {
+                if (confirmed[i]) {
+                    continue;
+                }
+                char name[32];
+                snprintf(name, sizeof(name), NAME_FORMAT, t->first_user + i);
+                send_command(t->sockets[i], CHAT_OP_JOIN, NULL, NULL, 0);
+                send_command(t->sockets[i], CHAT_OP_DIRECT, name, JOIN_PROBE, strlen(JOIN_PROBE));
+            }
+            next_retry = now + JOIN_RETRY_MS * 1000000ull;
+        }
+
+        long timeout = (long)((next_retry - now + 999999) / 1000000);
+        if (zmq_poll(items, t->users, timeout) < 0) {
+            break;
+        }
+        for (int i = 0; i < t->users; i++) {
+            if (!(items[i].revents & ZMQ_POLLIN)) {
+                continue;
+            }
+            int size;
+            while ((size = zmq_recv(t->sockets[i], buffer, sizeof(buffer), ZMQ_DONTWAIT)) >= 0) {
+                size_t length = ((size_t)size < sizeof(buffer)) ? (size_t)size : sizeof(buffer);
+                if (!confirmed[i] && memmem(buffer, length, JOIN_PROBE, strlen(JOIN_PROBE)) != NULL) {
+                    confirmed[i] = 1;
+                    pending--;
+                }
+            }
+        }
+    }
+    free(confirmed);
+}
+
+static void *load_loop(void *arg) {
+    load_thread *t = arg;
+    zmq_pollitem_t *items = calloc((size_t)t->users, sizeof(zmq_pollitem_t));
+    if (items == NULL) {
+        perror("calloc");
+        exit(1);
+    }
+
+    for (int i = 0; i < t->users; i++) {
+        char name[32];
+        snprintf(name, sizeof(name), NAME_FORMAT, t->first_user + i);
+        void *socket = zmq_socket(t->ctx, ZMQ_DEALER);
+        if (socket == NULL) {
+            fprintf(stderr, "zmq_socket: %s (ulimit -n?)\n", zmq_strerror(zmq_errno()));
+            exit(1);
+        }
+        int linger = 1000;
+        zmq_setsockopt(socket, ZMQ_LINGER, &linger, sizeof(linger));
+        zmq_setsockopt(socket, ZMQ_ROUTING_ID, name, strlen(name));
+        zmq_connect(socket, opt.endpoint);
+        t->sockets[i] = socket;
+        items[i] = (zmq_pollitem_t){socket, 0, ZMQ_POLLIN, 0};
+    }
+
+    // отсчёт начинается, только когда сервер подтвердил JOIN всех пользователей всех потоков
+    confirm_joins(t, items);
+    pthread_barrier_wait(&joined);
+
+    uint64_t interval = (uint64_t)(1e9 * opt.threads / opt.rate);
+    uint64_t start = monotonic_ns();
+    uint64_t stop_sending = start + (uint64_t)opt.duration * 1000000000ull;
+    uint64_t stop = stop_sending + (uint64_t)opt.delay * 1000000000ull + DRAIN_EXTRA_MS * 1000000ull;
+    // потоки начинают со сдвигом, чтобы не отправлять синхронно
+    uint64_t next_send = start + interval * (uint64_t)t->index / (uint64_t)opt.threads;
+    // пульс, как у client.c: иначе редко пишущих пользователей сервер отключит как молчащих
+    uint64_t heartbeat = (uint64_t)CHAT_HEARTBEAT_INTERVAL * 1000000000ull;
+    uint64_t next_ping = start + heartbeat;
+    char buffer[MAX_MSG_LEN + 300];
+
+    while (1) {
+        uint64_t now = monotonic_ns();
+        if (now >= stop) {
+            break;
+        }
+        while (next_send <= now && next_send < stop_sending) {
+            send_one(t, next_send);
+            next_send += interval;
+        }
+        if (now >= next_ping) {
+            for (int i = 0; i < t->users; i++) {
+                send_command(t->sockets[i], CHAT_OP_PING, NULL, NULL, 0);
+            }
+            next_ping = now + heartbeat;
+        }
+
+        uint64_t wake = (next_send < stop_sending) ? next_send : stop;
+        if (next_ping < wake) {
+            wake = next_ping;
+        }
+        long timeout = (long)((wake - now + 999999) / 1000000);
+        if (zmq_poll(items, t->users, (timeout > 0) ? timeout : 1) < 0) {
+            break;
+        }
+        now = monotonic_ns();
+        for (int i = 0; i < t->users; i++) {
+            if (!(items[i].revents & ZMQ_POLLIN)) {
+                continue;
+            }
+            int size;
+            while ((size = zmq_recv(t->sockets[i], buffer, sizeof(buffer), ZMQ_DONTWAIT)) >= 0) {
+                record_delivery(t, buffer, ((size_t)size < sizeof(buffer)) ? (size_t)size : sizeof(buffer), now);
+            }
+        }
+    }
+
+    for (int i = 0; i < t->users; i++) {
+        send_command(t->sockets[i], CHAT_OP_EXIT, NULL, NULL, 0);
+        zmq_close(t->sockets[i]);
+    }
+    free(items);
+    return NULL;
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr, "Usage: %s [-t threads] [-u users] [-r msg/s] [-d seconds] [-m direct:broadcast:delayed]\n"
+                    "          [-s payload bytes] [-D delay seconds] [-p binary|text] [-e endpoint]\n", prog);
+    fprintf(stderr, "По умолчанию: -t 4 -u 1000 -r 2000 -d 10 -m 95:1:4 -s 64 -D 1 -p binary "
+                    "-e tcp://localhost:5555\n");
+    fprintf(stderr, "Каждому пользователю нужно около двух дескрипторов: ulimit -n\n");
+}
+
+static int parse_options(int argc, char **argv) {
+    int c;
+    while ((c = getopt(argc, argv, "t:u:r:d:m:s:D:p:e:h")) != -1) {
+        switch (c) {
+        case 't': opt.threads = atoi(optarg); break;
+        case 'u': opt.users = atoi(optarg); break;
+        case 'r': opt.rate = atof(optarg); break;
+        case 'd': opt.duration = atoi(optarg); break;
+        case 's': opt.payload = atoi(optarg); break;
+        case 'D': opt.delay = atoi(optarg); break;
+        case 'e': opt.endpoint = optarg; break;
+        case 'p':
+            if (strcmp(optarg, "binary") != 0 && strcmp(optarg, "text") != 0) {
+                return 0;
+            }
+            opt.binary = (strcmp(optarg, "binary") == 0);
+            break;
+        case 'm':
+            if (sscanf(optarg, "%d:%d:%d", &opt.mix[0], &opt.mix[1], &opt.mix[2]) != 3) {
+                return 0;
+            }
+            break;
+        default:
+            return 0;
+        }
+    }
+    return opt.threads >= 1 && opt.threads <= MAX_THREADS && opt.users >= opt.threads &&
+           opt.rate > 0 && opt.duration > 0 && opt.delay > 0 &&
+           opt.payload >= MARK_SIZE && opt.payload <= MAX_MSG_LEN &&
+           opt.mix[0] >= 0 && opt.mix[1] >= 0 && opt.mix[2] >= 0 &&
+           opt.mix[0] + opt.mix[1] + opt.mix[2] > 0;
+}
+
+int main(int argc, char **argv) {
+    if (!parse_options(argc, argv)) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    void *ctx = zmq_ctx_new();
+    zmq_ctx_set(ctx, ZMQ_IO_THREADS, opt.threads);
+    zmq_ctx_set(ctx, ZMQ_MAX_SOCKETS, opt.users + 16);
+
+    load_thread *threads = calloc((size_t)opt.threads, sizeof(load_thread));
+    if (threads == NULL) {
+        perror("calloc");
+        return 1;
+    }
+    pthread_barrier_init(&joined, NULL, (unsigned)opt.threads);
+
+    for (int i = 0; i < opt.threads; i++) {
+        load_thread *t = &threads[i];
+        t->index = i;
+        t->first_user = opt.users * i / opt.threads;
+        t->users = opt.users * (i + 1) / opt.threads - t->first_user;
+        t->ctx = ctx;
+        t->random = 2463534242u + (uint32_t)i * 7919u;
+        t->sockets = calloc((size_t)t->users, sizeof(void *));
+        if (t->sockets == NULL) {
+            perror("calloc");
+            return 1;
+        }
+        for (int k = 0; k < KIND_COUNT; k++) {
+            hist_init(&t->hist[k]);
+        }
+        if (pthread_create(&t->thread, NULL, load_loop, t) != 0) {
+            perror("pthread_create");
+            return 1;
+        }
+    }
+
+    latency_hist total[KIND_COUNT];
+    uint64_t sent[KIND_COUNT] = {0};
+    uint64_t received[KIND_COUNT] = {0};
+    for (int k = 0; k < KIND_COUNT; k++) {
+        hist_init(&total[k]);
+    }
+    for (int i = 0; i < opt.threads; i++) {
+        pthread_join(threads[i].thread, NULL);
+        for (int k = 0; k < KIND_COUNT; k++) {
+            sent[k] += threads[i].sent[k];
+            received[k] += threads[i].received[k];
+            hist_merge(&total[k], &threads[i].hist[k]);
+        }
+        free(threads[i].sockets);
+    }
+
+    printf("Load: %d users in %d threads, %.0f msg/s for %d s, mix %d:%d:%d, %d-byte payload, %s protocol\n\n",
+           opt.users, opt.threads, opt.rate, opt.duration, opt.mix[0], opt.mix[1], opt.mix[2],
+           opt.payload, opt.binary ? "binary" : "text");
+    printf("%-10s %10s %12s %10s %10s %10s %10s %10s\n",
+           "kind", "sent", "delivered", "p50,us", "p90,us", "p99,us", "p99.9,us", "max,us");
+    uint64_t delivered = 0;
+    uint64_t sent_total = 0;
+    for (int k = 0; k < KIND_COUNT; k++) {
+        printf("%-10s %10llu %12llu %10.0f %10.0f %10.0f %10.0f %10.0f\n", kind_names[k],
+               (unsigned long long)sent[k], (unsigned long long)received[k],
+               hist_percentile(&total[k], 50) / 1e3, hist_percentile(&total[k], 90) / 1e3,
+               hist_percentile(&total[k], 99) / 1e3, hist_percentile(&total[k], 99.9) / 1e3,
+               total[k].max / 1e3);
+        delivered += received[k];
+        sent_total += sent[k];
+    }
+    printf("\nSent %.0f msg/s, delivered %.0f msg/s (delayed: lateness past the deadline)\n",
+           (double)sent_total / opt.duration, (double)delivered / opt.duration);
+
+    pthread_barrier_destroy(&joined);
+    free(threads);
+    zmq_ctx_destroy(ctx);
+    return 0;
+}
@@ -0,0 +1,85 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include "message_log.h"
+
+/*
+Цена долговечности журнала отложенных сообщений: мкс на сообщение при fdatasync
+после каждой записи и при group commit (один fdatasync на группу из N сообщений).
+Затем сжатие: половина сообщений доставлена, журнал переписывается из живых.
+Аргумент - путь к файлу журнала (по умолчанию в текущем каталоге: /tmp часто в памяти)
+*/
+
+#define MESSAGES 4096
+
+static const int group_sizes[] = {1, 8, 64, 512};
+
+
+static void no_replay(void *context, uint64_t id, uint64_t deliver_wall,
+                      const char *sender, const char *receiver, const char *payload) {
+    (void)id; (void)deliver_wall; (void)sender; (void)receiver; (void)payload;
+    (*(size_t *)context)++;
+}
+
+int main(int argc, char *argv[]) {
+    const char *path = (argc > 1) ? argv[1] : "log_bench.log";
+    delayed_queue queue;
+    delayed_init(&queue);
+
+    printf("Message log: %d delayed messages, durability cost per message\n\n", MESSAGES);
+    printf("%8s %12s %10s\n", "group", "us/message", "commits");
+
+    for (size_t g = 0; g < sizeof(group_sizes) / sizeof(group_sizes[0]); g++) {
+        unlink(path);
+        size_t restored = 0;
+        message_log log;
+        if (!log_open(&log, path, no_replay, &restored)) {
+            return 1;
+        }
+
+        uint64_t start = monotonic_ns();
+        for (int i = 0; i < MESSAGES; i++) {
+            delayed_msg_t *msg = delayed_push(&queue, (uint64_t)i, "alice", "bob", "see you in an hour");
+            msg->deliver_wall = realtime_ns() + 3600ull * 1000000000ull;
+            log_append_schedule(&log, msg);
+            if ((i + 1) % group_sizes[g] == 0) {
+                log_commit(&log);
+            }
+        }
+        log_commit(&log);
+        uint64_t elapsed = monotonic_ns() - start;
+        printf("%8d %12.2f %10llu\n", group_sizes[g], (double)elapsed / 1000.0 / MESSAGES,
+               (unsigned long long)log.commits);
+
+        // последняя группа: доставлена половина, журнал сжимается и открывается заново
+        if (g + 1 == sizeof(group_sizes) / sizeof(group_sizes[0])) {
+            for (size_t i = 0; i < queue.count; i += 2) {
+                log_append_done(&log, queue.heap[i].msg->id);
+            }
+            log_commit(&log);
+            off_t before = lseek(log.fd, 0, SEEK_END);
+
+            start = monotonic_ns();
+            log_compact_begin(&log);
+            for (size_t i = 1; i < queue.count; i += 2) {
+                log_compact_add(&log, queue.heap[i].msg);
+            }
+            log_compact_finish(&log);
+            elapsed = monotonic_ns() - start;
+            off_t after = lseek(log.fd, 0, SEEK_END);
+            log_close(&log);
+
+            log_open(&log, path, no_replay, &restored);
+            printf("\nCompaction: %lld -> %lld bytes in %.1f ms, %zu messages restored\n",
+                   (long long)before, (long long)after, (double)elapsed / 1e6, restored);
+        }
+        log_close(&log);
+        delayed_free(&queue);
+        delayed_init(&queue);
+    }
+
+    unlink(path);
+    return 0;
+}
@@ -0,0 +1,348 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <libgen.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "message_log.h"
+
+/*
+Формат записи (все поля в порядке байт машины):
+    log_header, затем строки sender, receiver, payload без завершающих нулей.
+size - длина всей записи, checksum - FNV-1a по байтам после поля checksum.
+При восстановлении чтение останавливается на первой записи с неверной длиной или
+контрольной суммой - это хвост, не дописанный до сбоя; он отрезается
+
+Долговечность: запись считается сохранённой после log_commit. Сервер сбрасывает группу,
+когда входящие кончились или набралось LOG_GROUP_BYTES, - один fdatasync на пачку
+сообщений вместо одного на каждое. DONE, не успевшая на диск, значит повторную доставку
+после сбоя (не потерю)
+*/
+
+#define LOG_INITIAL_BUFFER (64 * 1024)
+
+enum {
+    LOG_SCHEDULE = 1,
+    LOG_DONE = 2
+};
+
+typedef struct {
+    uint32_t size;
+    uint32_t checksum;
+    uint32_t type;
+    uint32_t sender_len;
+    uint32_t receiver_len;
+    uint32_t payload_len;
+    uint64_t id;
+    uint64_t deliver_wall;
+} log_header;
+
+
+static uint32_t checksum(const void *data, size_t size) {
+    const unsigned char *p = data;
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < size; i++) {
+        h ^= p[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static void reserve(message_log *log, size_t extra) {
+    if (log->length + extra <= log->capacity) {
+        return;
+    }
+    size_t capacity = log->capacity ? log->capacity : LOG_INITIAL_BUFFER;
+    while (capacity < log->length + extra) {
+        capacity *= 2;
+    }
+    char *buffer = realloc(log->buffer, capacity);
+    if (buffer == NULL) {
+        perror("realloc");
+        exit(1);
+    }
+    log->buffer = buffer;
+    log->capacity = capacity;
+}
+
+static void append_record(message_log *log, uint32_t type, uint64_t id, uint64_t deliver_wall,
+                          const char *sender, const char *receiver, const char *payload) {
+    log_header header = {0, 0, type, 0, 0, 0, id, deliver_wall};
+    header.sender_len = sender ? (uint32_t)strlen(sender) : 0;
+    header.receiver_len = receiver ? (uint32_t)strlen(receiver) : 0;
+    header.payload_len = payload ? (uint32_t)strlen(payload) : 0;
+    header.size = (uint32_t)sizeof(header) + header.sender_len + header.receiver_len + header.payload_len;
+
+    reserve(log, header.size);
+    char *record = log->buffer + log->length;
+    char *p = record + sizeof(header);
+    memcpy(p, sender, header.sender_len);
+    p += header.sender_len;
+    memcpy(p, receiver, header.receiver_len);
+    p += header.receiver_len;
+    memcpy(p, payload, header.payload_len);
+
+    memcpy(record, &header, sizeof(header));
+    header.checksum = checksum(record + 2 * sizeof(uint32_t), header.size - 2 * sizeof(uint32_t));
+    memcpy(record, &header, sizeof(header));
+
+    log->length += header.size;
+    log->records++;
+}
+
+// после rename и создания файла: запись в каталоге тоже должна дойти до диска
+static void sync_parent_dir(const char *path) {
+    char copy[4096];
+    snprintf(copy, sizeof(copy), "%s", path);
+    int dir = open(dirname(copy), O_RDONLY | O_DIRECTORY);
+    if (dir != -1) {
+        fsync(dir);
+        close(dir);
+    }
+}
+
+static int compare_ids(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a;
+    uint64_t y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+static int valid_record(const char *data, size_t remaining, log_header *header) {
+    if (remaining < sizeof(log_header)) {
+        return 0;
+    }
+    memcpy(header, data, sizeof(*header));
+    uint64_t strings = (uint64_t)header->sender_len + header->receiver_len + header->payload_len;
+    return header->size <= remaining && header->size == sizeof(log_header) + strings &&
+           (header->type == LOG_SCHEDULE || header->type == LOG_DONE) &&
+           header->checksum == checksum(data + 2 * sizeof(uint32_t), header->size - 2 * sizeof(uint32_t));
+}
+
+/*
+Восстановление в два прохода: сначала собираются id всех DONE, затем каждое SCHEDULE
+без парной DONE отдаётся replay. Возвращает длину целой части журнала
+*/
+static size_t replay_file(message_log *log, const char *data, size_t size,
+                          log_replay_fn replay, void *context) {
+    uint64_t *done = NULL;
+    size_t done_count = 0, done_capacity = 0;
+    size_t offset = 0;
+    log_header header;
+
+    while (valid_record(data + offset, size - offset, &header)) {
+        if (header.type == LOG_DONE) {
+            if (done_count == done_capacity) {
+                done_capacity = done_capacity ? done_capacity * 2 : 1024;
+                done = realloc(done, done_capacity * sizeof(uint64_t));
+                if (done == NULL) {
+                    perror("realloc");
+                    exit(1);
+                }
+            }
+            done[done_count++] = header.id;
+        }
+        if (header.id >= log->next_id) {
+            log->next_id = header.id + 1;
+        }
+        offset += header.size;
+        log->records++;
+    }
+    size_t valid = offset;
+    qsort(done, done_count, sizeof(uint64_t), compare_ids);
+
+    char sender[65536], receiver[65536], payload[65536];
+    for (offset = 0; offset < valid; offset += header.size) {
+        memcpy(&header, data + offset, sizeof(header));
+        if (header.type != LOG_SCHEDULE ||
+            (done_count > 0 && bsearch(&header.id, done, done_count, sizeof(uint64_t), compare_ids) != NULL)) {
+            continue;
+        }
+        if (header.sender_len >= sizeof(sender) || header.receiver_len >= sizeof(receiver) ||
+            header.payload_len >= sizeof(payload)) {
+            continue;
+        }
+        const char *p = data + offset + sizeof(header);
+        memcpy(sender, p, header.sender_len);
+        sender[header.sender_len] = '\0';
+        p += header.sender_len;
+        memcpy(receiver, p, header.receiver_len);
+        receiver[header.receiver_len] = '\0';
+        p += header.receiver_len;
+        memcpy(payload, p, header.payload_len);
+        payload[header.payload_len] = '\0';
+
+        replay(context, header.id, header.deliver_wall, sender, receiver, payload);
+        log->live++;
+    }
+
+    log->dead = log->records - log->live;
+    log->records = 0;
+    free(done);
+    return valid;
+}
+
+int log_open(message_log *log, const char *path, log_replay_fn replay, void *context) {
+    memset(log, 0, sizeof(*log));
+    log->fd = -1;
+    log->next_id = 1;
+    if (path == NULL) {
+        path = getenv("CHAT_LOG") ? getenv("CHAT_LOG") : LOG_PATH_DEFAULT;
+    }
+    snprintf(log->path, sizeof(log->path), "%s", path);
+
+    int fd = open(log->path, O_RDWR | O_CREAT, 0644);
+    if (fd == -1) {
+        perror(log->path);
+        return 0;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) == -1) {
+        perror("fstat");
+        close(fd);
+        return 0;
+    }
+
+    size_t valid = 0;
+    if (st.st_size > 0) {
+        void *data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED) {
+            perror("mmap");
+            close(fd);
+            return 0;
+        }
+        valid = replay_file(log, data, (size_t)st.st_size, replay, context);
+        munmap(data, (size_t)st.st_size);
+
+        if (valid < (size_t)st.st_size) {
+            fprintf(stderr, "%s: dropped %zu bytes of incomplete tail\n", log->path, (size_t)st.st_size - valid);
+            if (ftruncate(fd, (off_t)valid) == -1 || fdatasync(fd) == -1) {
+                perror("ftruncate");
+            }
+        }
+    }
+
+    if (lseek(fd, (off_t)valid, SEEK_SET) == -1) {
+        perror("lseek");
+        close(fd);
+        return 0;
+    }
+    sync_parent_dir(log->path);
+    log->fd = fd;
+    return 1;
+}
+
+void log_append_schedule(message_log *log, delayed_msg_t *msg) {
+    if (log->fd == -1) {
+        return;
+    }
+    msg->id = log->next_id++;
+    append_record(log, LOG_SCHEDULE, msg->id, msg->deliver_wall, msg->sender, msg->receiver, msg->payload);
+    log->live++;
+}
+
+void log_append_done(message_log *log, uint64_t id) {
+    if (log->fd == -1 || id == 0) {
+        return;
+    }
+    append_record(log, LOG_DONE, id, 0, NULL, NULL, NULL);
+    log->live--;
+    log->dead += 2;
+}
+
+int log_pending(const message_log *log) {
+    return log->length > 0;
+}
+
+int log_group_full(const message_log *log) {
+    return log->length >= LOG_GROUP_BYTES;
+}
+
+static int write_all(int fd, const char *data, size_t size) {
+    while (size > 0) {
+        ssize_t n = write(fd, data, size);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return 0;
+        }
+        data += n;
+        size -= (size_t)n;
+    }
+    return 1;
+}
+
+void log_commit(message_log *log) {
+    if (log->fd == -1 || log->length == 0) {
+        return;
+    }
+    if (!write_all(log->fd, log->buffer, log->length) || fdatasync(log->fd) == -1) {
+        perror(log->path);
+    }
+    log->length = 0;
+    log->commits++;
+}
+
+int log_should_compact(const message_log *log) {
+    return log->fd != -1 && log->dead >= LOG_COMPACT_MIN_DEAD && log->dead > log->live;
+}
+
+void log_compact_begin(message_log *log) {
+    log_commit(log);
+    log->live = 0;
+}
+
+void log_compact_add(message_log *log, const delayed_msg_t *msg) {
+    if (log->fd == -1) {
+        return;
+    }
+    append_record(log, LOG_SCHEDULE, msg->id, msg->deliver_wall, msg->sender, msg->receiver, msg->payload);
+    log->live++;
+}
+
+/*
+Новый журнал пишется во временный файл и заменяет старый через rename: при сбое посреди
+сжатия на диске остаётся либо старый журнал, либо новый целиком
+*/
+void log_compact_finish(message_log *log) {
+    if (log->fd == -1) {
+        return;
+    }
+    char tmp_path[4096 + 8];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", log->path);
+
+    int fd = open(tmp_path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd == -1 || !write_all(fd, log->buffer, log->length) || fdatasync(fd) == -1 ||
+        rename(tmp_path, log->path) == -1) {
+        perror("log compaction");
+        if (fd != -1) {
+            close(fd);
+            unlink(tmp_path);
+        }
+        // старый журнал цел и содержит те же живые сообщения; следующая попытка - через LOG_COMPACT_MIN_DEAD
+        log->length = 0;
+        log->dead = 0;
+        return;
+    }
+    sync_parent_dir(log->path);
+
+    close(log->fd);
+    log->fd = fd;
+    log->length = 0;
+    log->dead = 0;
+    log->commits++;
+}
+
+void log_close(message_log *log) {
+    log_commit(log);
+    if (log->fd != -1) {
+        close(log->fd);
+    }
+    free(log->buffer);
+    log->fd = -1;
+    log->buffer = NULL;
+}
@@ -0,0 +1,65 @@
+#ifndef MESSAGE_LOG_H
+#define MESSAGE_LOG_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "delayed_queue.h"
+
+// путь к журналу по умолчанию (переопределяется переменной окружения CHAT_LOG)
+#define LOG_PATH_DEFAULT "chat.log"
+// группа записей сбрасывается на диск, как только набралось столько байт, даже под нагрузкой
+#define LOG_GROUP_BYTES (256 * 1024)
+// сжатие: мёртвых записей не меньше стольких и больше, чем живых
+#define LOG_COMPACT_MIN_DEAD 4096
+
+/*
+Журнал отложенных сообщений: файл, в который только дописывают.
+    SCHEDULE - сообщение поставлено (id, срок по CLOCK_REALTIME, отправитель, адресат, текст)
+    DONE     - сообщение с id доставлено, больше не нужно
+Живые сообщения = SCHEDULE без DONE. Записи копятся в буфере и уходят на диск одним
+write + fdatasync на группу (group commit)
+*/
+typedef struct {
+    int fd;
+    char path[4096];
+    char *buffer;                   // записи, ещё не отданные на диск
+    size_t length;
+    size_t capacity;
+    uint64_t next_id;
+    uint64_t live;                  // живых сообщений
+    uint64_t dead;                  // записей, которые сжатие выбросит
+    uint64_t commits;               // число fdatasync
+    uint64_t records;               // всего записей с момента открытия
+} message_log;
+
+// вызывается при восстановлении для каждого живого сообщения, в порядке постановки
+typedef void (*log_replay_fn)(void *context, uint64_t id, uint64_t deliver_wall,
+                              const char *sender, const char *receiver, const char *payload);
+
+/*
+Открыть журнал (path NULL - CHAT_LOG или LOG_PATH_DEFAULT) и восстановить живые сообщения.
+Недописанный хвост после сбоя отрезается. 0 - журнал недоступен (сервер работает без него)
+*/
+int log_open(message_log *log, const char *path, log_replay_fn replay, void *context);
+void log_close(message_log *log);
+
+// записи в буфер; id сообщению назначает журнал
+void log_append_schedule(message_log *log, delayed_msg_t *msg);
+void log_append_done(message_log *log, uint64_t id);
+
+// есть ли что сбрасывать и пора ли сбрасывать, не дожидаясь паузы во входящих
+int log_pending(const message_log *log);
+int log_group_full(const message_log *log);
+// сбросить накопленное: write + fdatasync
+void log_commit(message_log *log);
+
+/*
+Сжатие: журнал переписывается заново только из живых сообщений. Вызывающий перечисляет
+их между log_compact_begin и log_compact_finish через log_compact_add
+*/
+int log_should_compact(const message_log *log);
+void log_compact_begin(message_log *log);
+void log_compact_add(message_log *log, const delayed_msg_t *msg);
+void log_compact_finish(message_log *log);
+
+#endif
@@ -0,0 +1,300 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include "outbound_queue.h"
+
+
+static void *checked_realloc(void *ptr, size_t size) {
+    void *p = realloc(ptr, size);
+    if (p == NULL) {
+        perror("realloc");
+        exit(1);
+    }
+    return p;
+}
+
+static void publish(outbound_queues *q) {
+    stats_set(&q->stats->queued, q->queued);
+    stats_set(&q->stats->spilled, q->spilled);
+}
+
+// 1 - отправлено (text забран), 0 - очередь клиента в ZeroMQ полна, -1 - клиента нет
+static int try_send(void *router, const void *id, size_t id_size, zmq_msg_t *text) {
+    if (zmq_send(router, id, id_size, ZMQ_SNDMORE | ZMQ_DONTWAIT) < 0) {
+        return (zmq_errno() == EAGAIN) ? 0 : -1;
+    }
+    // первый кадр принят - остальные кадры сообщения идут в тот же канал без ожидания
+    if (zmq_msg_send(text, router, 0) < 0) {
+        zmq_msg_close(text);
+    }
+    return 1;
+}
+
+static int peer_index(outbound_queues *q, const void *id, size_t id_size) {
+    int idx = registry_find_id(&q->peers, id, id_size);
+    if (idx >= 0) {
+        return idx;
+    }
+
+    char name[USERNAME_SIZE];
+    snprintf(name, sizeof(name), "%.*s", (int)id_size, (const char *)id);
+    idx = registry_add(&q->peers, name);
+    registry_set_id(&q->peers, idx, id, id_size);
+
+    if (q->peers.capacity > q->capacity) {
+        q->capacity = q->peers.capacity;
+        q->queues = checked_realloc(q->queues, q->capacity * sizeof(peer_queue));
+        q->pending = checked_realloc(q->pending, q->capacity * sizeof(int32_t));
+    }
+    memset(&q->queues[idx], 0, sizeof(peer_queue));
+    q->queues[idx].spill_fd = -1;
+    return idx;
+}
+
+static void mark_pending(outbound_queues *q, int idx) {
+    if (!q->queues[idx].pending) {
+        q->queues[idx].pending = 1;
+        q->pending[q->pending_count++] = idx;
+    }
+}
+
+static void push(outbound_queues *q, peer_queue *pq, zmq_msg_t *text) {
+    queued_msg *node = malloc(sizeof(queued_msg));
+    if (node == NULL) {
+        perror("malloc");
+        exit(1);
+    }
+    node->next = NULL;
+    zmq_msg_init(&node->text);
+    zmq_msg_move(&node->text, text);
+    zmq_msg_close(text);
+
+    if (pq->tail) {
+        pq->tail->next = node;
+    } else {
+        pq->head = node;
+    }
+    pq->tail = node;
+    pq->count++;
+    q->queued++;
+}
+
+// снять первое сообщение (после отправки его zmq_msg_t уже пуст)
+static void pop(outbound_queues *q, peer_queue *pq) {
+    queued_msg *node = pq->head;
+    pq->head = node->next;
+    if (pq->head == NULL) {
+        pq->tail = NULL;
+    }
+    zmq_msg_close(&node->text);
+    free(node);
+    pq->count--;
+    q->queued--;
+}
+
+// ---- spill: файл клиента, записи [размер uint32][текст] ----
+
+static void spill_path(const outbound_queues *q, int idx, char *path, size_t size) {
+    const user_t *peer = &q->peers.users[idx];
+    int length = snprintf(path, size, "%s/", q->spill_dir);
+    for (size_t i = 0; i < peer->zmq_id_size && (size_t)length + 3 < size; i++) {
+        length += snprintf(path + length, size - (size_t)length, "%02x", (unsigned char)peer->zmq_id[i]);
+    }
+}
+
+static void spill_close(outbound_queues *q, int idx) {
+    peer_queue *pq = &q->queues[idx];
+    if (pq->spill_fd >= 0) {
+        char path[4096];
+        spill_path(q, idx, path, sizeof(path));
+        close(pq->spill_fd);
+        unlink(path);
+    }
+    q->spilled -= pq->spilled;
+    pq->spill_fd = -1;
+    pq->spill_read = 0;
+    pq->spill_write = 0;
+    pq->spilled = 0;
+}
+
+static void spill_append(outbound_queues *q, int idx, zmq_msg_t *text) {
+    peer_queue *pq = &q->queues[idx];
+    if (pq->spill_fd < 0) {
+        char path[4096];
+        spill_path(q, idx, path, sizeof(path));
+        if (mkdir(q->spill_dir, 0700) != 0 && errno != EEXIST) {
+            perror(q->spill_dir);
+        }
+        pq->spill_fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0600);
+        if (pq->spill_fd < 0) {
+            perror(path);
+        }
+    }
+
+    uint32_t size = (uint32_t)zmq_msg_size(text);
+    struct iovec iov[2] = {
+        {&size, sizeof(size)},
+        {zmq_msg_data(text), size}
+    };
+    if (pq->spill_fd < 0 || pwritev(pq->spill_fd, iov, 2, pq->spill_write) != (ssize_t)(sizeof(size) + size)) {
+        stats_add(&q->stats->dropped_full, 1);
+    } else {
+        pq->spill_write += (off_t)(sizeof(size) + size);
+        pq->spilled++;
+        q->spilled++;
+    }
+    zmq_msg_close(text);
+}
+
+// дочитать из файла в память, пока очередь не заполнится
+static void spill_reload(outbound_queues *q, int idx) {
+    peer_queue *pq = &q->queues[idx];
+    while (pq->spilled > 0 && pq->count < q->limit) {
+        uint32_t size;
+        zmq_msg_t text;
+        if (pread(pq->spill_fd, &size, sizeof(size), pq->spill_read) != (ssize_t)sizeof(size) ||
+            zmq_msg_init_size(&text, size) != 0) {
+            break;
+        }
+        if (pread(pq->spill_fd, zmq_msg_data(&text), size, pq->spill_read + (off_t)sizeof(size)) != (ssize_t)size) {
+            zmq_msg_close(&text);
+            break;
+        }
+        pq->spill_read += (off_t)(sizeof(size) + size);
+        pq->spilled--;
+        q->spilled--;
+        push(q, pq, &text);
+    }
+    if (pq->spilled > 0 && pq->count == 0) {
+        // файл не читается - его записи потеряны
+        perror("spill read");
+        stats_add(&q->stats->dropped_full, pq->spilled);
+    }
+    if (pq->spilled == 0 || pq->count == 0) {
+        spill_close(q, idx);
+    }
+}
+
+// ---- очередь клиента ----
+
+static void clear_queue(outbound_queues *q, int idx) {
+    peer_queue *pq = &q->queues[idx];
+    while (pq->head) {
+        pop(q, pq);
+    }
+    spill_close(q, idx);
+}
+
+static int enqueue(outbound_queues *q, int idx, zmq_msg_t *text) {
+    peer_queue *pq = &q->queues[idx];
+    mark_pending(q, idx);
+
+    // пока в файле что-то есть, новое - за ним, иначе нарушится порядок
+    if (pq->spilled > 0) {
+        spill_append(q, idx, text);
+        return 0;
+    }
+    if (pq->count >= q->limit) {
+        switch (q->policy) {
+        case QUEUE_DROP_OLDEST:
+            pop(q, pq);
+            stats_add(&q->stats->dropped_full, 1);
+            break;
+        case QUEUE_DISCONNECT:
+            stats_add(&q->stats->dropped_full, pq->count + 1);
+            clear_queue(q, idx);
+            zmq_msg_close(text);
+            return 1;
+        case QUEUE_SPILL:
+            spill_append(q, idx, text);
+            return 0;
+        }
+    }
+    push(q, pq, text);
+    return 0;
+}
+
+void outq_init(outbound_queues *q, frontend_stats *stats) {
+    memset(q, 0, sizeof(*q));
+    registry_init(&q->peers);
+    q->stats = stats;
+
+    const char *limit = getenv(QUEUE_LIMIT_ENV);
+    q->limit = (limit && atol(limit) > 0) ? (size_t)atol(limit) : QUEUE_LIMIT_DEFAULT;
+
+    const char *policy = getenv(QUEUE_POLICY_ENV);
+    q->policy = QUEUE_DROP_OLDEST;
+    if (policy && strcmp(policy, "disconnect") == 0) {
+        q->policy = QUEUE_DISCONNECT;
+    } else if (policy && strcmp(policy, "spill") == 0) {
+        q->policy = QUEUE_SPILL;
+    } else if (policy && strcmp(policy, "drop-oldest") != 0) {
+        fprintf(stderr, "%s: unknown policy %s, using drop-oldest\n", QUEUE_POLICY_ENV, policy);
+    }
+    q->spill_dir = getenv(QUEUE_SPILL_DIR_ENV) ? getenv(QUEUE_SPILL_DIR_ENV) : QUEUE_SPILL_DIR_DEFAULT;
+}
+
+int outq_send(outbound_queues *q, void *router, const void *id, size_t id_size, zmq_msg_t *text) {
+    // пока никто не ждёт, поиск клиента в очередях не нужен
+    int idx = (q->pending_count > 0) ? registry_find_id(&q->peers, id, id_size) : -1;
+    if (idx < 0 || (q->queues[idx].count == 0 && q->queues[idx].spilled == 0)) {
+        int sent = try_send(router, id, id_size, text);
+        if (sent > 0) {
+            stats_add(&q->stats->outbound, 1);
+            return 0;
+        }
+        if (sent < 0) {
+            stats_add(&q->stats->dropped_unroutable, 1);
+            zmq_msg_close(text);
+            return 0;
+        }
+        idx = peer_index(q, id, id_size);
+    }
+
+    int disconnect = enqueue(q, idx, text);
+    publish(q);
+    return disconnect;
+}
+
+int outq_flush(outbound_queues *q, void *router) {
+    size_t kept = 0;
+    for (size_t i = 0; i < q->pending_count; i++) {
+        int idx = q->pending[i];
+        peer_queue *pq = &q->queues[idx];
+        const user_t *peer = &q->peers.users[idx];
+
+        while (1) {
+            if (pq->count == 0 && pq->spilled > 0) {
+                spill_reload(q, idx);
+            }
+            if (pq->count == 0) {
+                break;
+            }
+            int sent = try_send(router, peer->zmq_id, peer->zmq_id_size, &pq->head->text);
+            if (sent == 0) {
+                break;
+            }
+            if (sent < 0) {
+                stats_add(&q->stats->dropped_unroutable, pq->count + pq->spilled);
+                clear_queue(q, idx);
+                break;
+            }
+            stats_add(&q->stats->outbound, 1);
+            pop(q, pq);
+        }
+
+        if (pq->count > 0 || pq->spilled > 0) {
+            q->pending[kept++] = idx;
+        } else {
+            pq->pending = 0;
+        }
+    }
+    q->pending_count = kept;
+    publish(q);
+    return kept > 0;
+}
@@ -0,0 +1,77 @@
+#ifndef OUTBOUND_QUEUE_H
+#define OUTBOUND_QUEUE_H
+
+#include <zmq.h>
+#include <sys/types.h>
+#include "user_registry.h"
+#include "server_stats.h"
+
+/*
+Очереди исходящих сообщений медленных клиентов (во фронтенде). ROUTER работает
+с ZMQ_ROUTER_MANDATORY и ZMQ_DONTWAIT: если у клиента заполнен HWM, сообщение не
+выбрасывается молча, а ждёт в очереди этого клиента и отправляется повторно (через
+QUEUE_RETRY_MS, в порядке поступления). Очередь ограничена CHAT_QUEUE_LIMIT сообщений,
+при переполнении - политика CHAT_QUEUE_POLICY:
+    drop-oldest - выбросить самое старое (по умолчанию)
+    disconnect  - выбросить всю очередь и отключить клиента: рассылки ему не идут до его
+                  следующей команды (хотя бы PING), она - неявный JOIN
+    spill       - дописывать в файл клиента в CHAT_SPILL_DIR, читать обратно по мере отправки
+Текст в очереди - тот же zmq_msg_t, что пришёл от обработчика, без копирования
+*/
+
+#define QUEUE_LIMIT_ENV "CHAT_QUEUE_LIMIT"
+#define QUEUE_POLICY_ENV "CHAT_QUEUE_POLICY"
+#define QUEUE_SPILL_DIR_ENV "CHAT_SPILL_DIR"
+#define QUEUE_LIMIT_DEFAULT 1000
+#define QUEUE_SPILL_DIR_DEFAULT "chat.spill"
+#define QUEUE_RETRY_MS 5
+
+typedef enum {
+    QUEUE_DROP_OLDEST,
+    QUEUE_DISCONNECT,
+    QUEUE_SPILL
+} queue_policy;
+
+typedef struct queued_msg {
+    struct queued_msg *next;
+    zmq_msg_t text;
+} queued_msg;
+
+typedef struct {
+    queued_msg *head;
+    queued_msg *tail;
+    size_t count;
+    int pending;                    // в списке outbound_queues.pending
+    int spill_fd;                   // -1 - файла нет
+    off_t spill_read;
+    off_t spill_write;
+    size_t spilled;                 // записей в файле, ещё не прочитанных
+} peer_queue;
+
+typedef struct {
+    user_registry peers;            // по routing id: только клиенты, которым уже приходилось ждать
+    peer_queue *queues;             // параллельно peers.users
+    size_t capacity;
+    int32_t *pending;               // клиенты с непустой очередью
+    size_t pending_count;
+    size_t queued;
+    size_t spilled;
+    size_t limit;
+    queue_policy policy;
+    const char *spill_dir;
+    frontend_stats *stats;
+} outbound_queues;
+
+// настройки - из переменных окружения
+void outq_init(outbound_queues *q, frontend_stats *stats);
+
+/*
+Отправить [id][text] клиенту или поставить в его очередь; text забирается.
+1 - клиента нужно отключить (политика disconnect), его очередь уже выброшена
+*/
+int outq_send(outbound_queues *q, void *router, const void *id, size_t id_size, zmq_msg_t *text);
+
+// повторить отправку из очередей; 1 - ещё есть ждущие (следующая попытка через QUEUE_RETRY_MS)
+int outq_flush(outbound_queues *q, void *router);
+
+#endif
@@ -0,0 +1,122 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include "chat_protocol.h"
+
+/*
+Цена разбора команды клиента, нс: прежний путь (копия кадра в буфер 1024 байта, strchr /
+strcmp / atoi), текстовая команда, разобранная на месте (chat_parse_text), и двоичная -
+заголовок и кадр текста (chat_parse_binary). Без ZeroMQ: кадры - готовые буферы в памяти
+*/
+
+#define BUDGET_NS 200000000ull          // на одно измерение
+#define BATCH 1024                      // команд между проверками времени
+#define MAX_MSG_LEN 1024
+
+static const size_t payload_sizes[] = {16, 200, 1000};
+
+typedef struct {
+    char text[2048];
+    size_t text_size;
+    char header[64];
+    size_t header_size;
+    const char *payload;
+    size_t payload_size;
+} frames;
+
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+// прежний разбор из handle_client: 1 - команда с адресатом
+__attribute__((noinline)) static int legacy_parse(const void *data, size_t size, size_t *payload_size) {
+    char text[MAX_MSG_LEN];
+    if (size >= sizeof(text)) {
+        size = sizeof(text) - 1;
+    }
+    memcpy(text, data, size);
+    text[size] = '\0';
+
+    if (strcmp(text, "JOIN") == 0 || strcmp(text, "/exit") == 0 || text[0] != '/') {
+        return 0;
+    }
+    char *space1 = strchr(text, ' ');
+    if (!space1) {
+        return 0;
+    }
+    *space1 = '\0';
+    char *rest = space1 + 1;
+    char *space2 = strchr(rest, ' ');
+    if (!space2 || rest[0] != '@') {
+        return 0;
+    }
+    *space2 = '\0';
+    char *payload = space2 + 1;
+    if (strcmp(text, "/m") != 0 && (strncmp(text, "/dm_", 4) != 0 || atoi(text + 4) <= 0)) {
+        return 0;
+    }
+    *payload_size = strlen(payload);
+    return 1;
+}
+
+// нс на команду; parsed - сумма длин текста (чтобы разбор не выбросил оптимизатор)
+static double measure(const frames *f, int mode, uint64_t *parsed) {
+    uint64_t ops = 0;
+    uint64_t start = now_ns();
+    uint64_t elapsed = 0;
+    chat_command cmd;
+
+    while (elapsed < BUDGET_NS) {
+        for (int b = 0; b < BATCH; b++) {
+            size_t size = 0;
+            if (mode == 0) {
+                if (legacy_parse(f->text, f->text_size, &size)) {
+                    *parsed += size;
+                }
+            } else if (mode == 1) {
+                if (chat_parse_text(f->text, f->text_size, &cmd)) {
+                    *parsed += cmd.payload_size;
+                }
+            } else {
+                if (chat_parse_binary(f->header, f->header_size, f->payload, f->payload_size, &cmd)) {
+                    *parsed += cmd.payload_size;
+                }
+            }
+        }
+        ops += BATCH;
+        elapsed = now_ns() - start;
+    }
+    return (double)elapsed / (double)ops;
+}
+
+int main(void) {
+    printf("Command parse cost (/dm_5 @receiver00042 <payload>), ns\n\n");
+    printf("%10s %12s %12s %12s\n", "payload", "legacy", "text", "binary");
+
+    uint64_t parsed = 0;
+    for (size_t t = 0; t < sizeof(payload_sizes) / sizeof(payload_sizes[0]); t++) {
+        char *payload = malloc(payload_sizes[t]);
+        memset(payload, 'x', payload_sizes[t]);
+
+        frames f;
+        f.text_size = (size_t)snprintf(f.text, sizeof(f.text), "/dm_5 @receiver00042 %.*s",
+                                       (int)payload_sizes[t], payload);
+        f.header_size = chat_encode_header(f.header, sizeof(f.header), CHAT_OP_DELAYED, "receiver00042", 5);
+        f.payload = payload;
+        f.payload_size = payload_sizes[t];
+
+        double legacy_ns = measure(&f, 0, &parsed);
+        double text_ns = measure(&f, 1, &parsed);
+        double binary_ns = measure(&f, 2, &parsed);
+        printf("%10zu %12.1f %12.1f %12.1f\n", payload_sizes[t], legacy_ns, text_ns, binary_ns);
+        free(payload);
+    }
+
+    fprintf(stderr, "(%llu payload bytes parsed)\n", (unsigned long long)parsed);
+    return 0;
+}
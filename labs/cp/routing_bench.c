@@ -0,0 +1,113 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include "user_registry.h"
+
+/*
+Стоимость маршрутизации сообщения в зависимости от числа пользователей.
+Одна операция - то, что сервер делает на каждое личное сообщение: найти отправителя
+по routing id, найти адресата по имени и проверить, что он в сети.
+Сравниваются хэш-индексы реестра и прежний линейный поиск (strcmp по всему массиву).
+Без ZeroMQ: меряется только поиск, отправка в сокет от числа пользователей не зависит
+*/
+
+#define BUDGET_NS 200000000ull          // на одно измерение
+#define BATCH 1024                      // операций между проверками времени
+
+static const size_t user_counts[] = {32, 1000, 10000, 100000};
+
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static uint32_t next_random(uint32_t *state) {
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return x;
+}
+
+// прежний find_user и такой же поиск по routing id
+static int linear_find(const user_t *users, size_t count, const char *name) {
+    for (size_t i = 0; i < count; i++) {
+        if (strcmp(users[i].name, name) == 0) {
+            return (int)i;
+        }
+    }
+    return -1;
+}
+
+static int linear_find_id(const user_t *users, size_t count, const char *id, size_t size) {
+    for (size_t i = 0; i < count; i++) {
+        if (users[i].zmq_id_size == size && memcmp(users[i].zmq_id, id, size) == 0) {
+            return (int)i;
+        }
+    }
+    return -1;
+}
+
+// нс на операцию; delivered - сколько сообщений нашли адресата (чтобы поиск не выбросил оптимизатор)
+static double measure(const user_registry *reg, int linear, uint64_t *delivered) {
+    uint32_t state = 12345;
+    uint64_t ops = 0;
+    uint64_t start = now_ns();
+    uint64_t elapsed = 0;
+
+    while (elapsed < BUDGET_NS) {
+        for (int b = 0; b < BATCH; b++) {
+            const user_t *from = &reg->users[next_random(&state) % reg->count];
+            const char *target = reg->users[next_random(&state) % reg->count].name;
+            int s_idx, r_idx;
+            if (linear) {
+                s_idx = linear_find_id(reg->users, reg->count, from->zmq_id, from->zmq_id_size);
+                r_idx = linear_find(reg->users, reg->count, target);
+            } else {
+                s_idx = registry_find_id(reg, from->zmq_id, from->zmq_id_size);
+                r_idx = registry_find(reg, target);
+            }
+            if (s_idx >= 0 && r_idx >= 0 && reg->users[r_idx].online) {
+                (*delivered)++;
+            }
+        }
+        ops += BATCH;
+        elapsed = now_ns() - start;
+    }
+    return (double)elapsed / (double)ops;
+}
+
+int main(void) {
+    printf("Routing cost per direct message (sender by id + receiver by name), ns\n\n");
+    printf("%10s %12s %12s %12s\n", "users", "join, ns", "hash", "linear");
+
+    uint64_t delivered = 0;
+    for (size_t t = 0; t < sizeof(user_counts) / sizeof(user_counts[0]); t++) {
+        user_registry reg;
+        registry_init(&reg);
+
+        uint64_t start = now_ns();
+        for (size_t i = 0; i < user_counts[t]; i++) {
+            char name[USERNAME_SIZE];
+            snprintf(name, sizeof(name), "user%06zu", i);
+            int idx = registry_add(&reg, name);
+            registry_set_online(&reg, idx, 1);
+            // routing id в бенчмарке - как у клиента: совпадает с именем
+            registry_set_id(&reg, idx, name, strlen(name));
+        }
+        double join_ns = (double)(now_ns() - start) / (double)user_counts[t];
+
+        double hash_ns = measure(&reg, 0, &delivered);
+        double linear_ns = measure(&reg, 1, &delivered);
+        printf("%10zu %12.1f %12.1f %12.1f\n", user_counts[t], join_ns, hash_ns, linear_ns);
+        registry_free(&reg);
+    }
+
+    fprintf(stderr, "(%llu messages routed)\n", (unsigned long long)delivered);
+    return 0;
+}
@@ -0,0 +1,62 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "delayed_queue.h"
+
+/*
+Стоимость планировщика отложенных сообщений в зависимости от их числа:
+постановка N сообщений со случайными сроками и извлечение всех по порядку.
+Заодно проверяется порядок: сроки не убывают, при равных сроках - FIFO
+*/
+
+static const size_t message_counts[] = {1000, 100000, 1000000, 4000000};
+
+
+static uint32_t next_random(uint32_t *state) {
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return x;
+}
+
+int main(void) {
+    printf("Delayed queue: push / pop cost, ns per message\n\n");
+    printf("%10s %12s %12s %10s\n", "messages", "push", "pop", "order");
+
+    for (size_t t = 0; t < sizeof(message_counts) / sizeof(message_counts[0]); t++) {
+        size_t count = message_counts[t];
+        delayed_queue queue;
+        delayed_init(&queue);
+        uint32_t state = 2463534242u;
+
+        uint64_t start = monotonic_ns();
+        for (size_t i = 0; i < count; i++) {
+            // сроки от 1 до 3600 секунд, как у /dm_N
+            uint64_t deliver_at = (uint64_t)(next_random(&state) % 3600 + 1) * 1000000000ull;
+            delayed_push(&queue, deliver_at, "alice", "bob", "see you later");
+        }
+        uint64_t push_ns = monotonic_ns() - start;
+
+        int ordered = 1;
+        uint64_t last_at = 0, last_seq = 0;
+        start = monotonic_ns();
+        delayed_msg_t *msg;
+        while ((msg = delayed_pop_due(&queue, UINT64_MAX)) != NULL) {
+            if (msg->deliver_at < last_at || (msg->deliver_at == last_at && msg->seq < last_seq)) {
+                ordered = 0;
+            }
+            last_at = msg->deliver_at;
+            last_seq = msg->seq;
+            delayed_msg_free(msg);
+        }
+        uint64_t pop_ns = monotonic_ns() - start;
+
+        printf("%10zu %12.1f %12.1f %10s\n", count, (double)push_ns / (double)count,
+               (double)pop_ns / (double)count, ordered ? "ok" : "BROKEN");
+        delayed_free(&queue);
+    }
+    return 0;
+}
@@ -1,266 +1,189 @@
 #include <zmq.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
-#include <time.h>
-
-#define MAX_USERS 32
-#define MAX_DELAYED 128
-#define ZMQ_ID_LEN 256
-#define USERNAME_SIZE 256
-#define MAX_MSG_LEN 1024
-#define TIME_LEN 16
-
+#include <unistd.h>
+#include "chat_worker.h"
+#include "event_log.h"
+#include "outbound_queue.h"
+
+/*
+Фронтенд сервера: только ввод-вывод сокетов.
+    - ROUTER (клиенты) -> обработчик шарда отправителя: [C][routing id][кадры команды]
+    - исходящие обработчиков (PULL) -> ROUTER: [routing id][текст]; если клиент не успевает
+      читать, текст ждёт в его очереди (outbound_queue.c), переполнение - по CHAT_QUEUE_POLICY
+Кадры пересылаются как есть (zmq_msg_send), без копирования текста. Разбор команд,
+журнал и рассылки - в потоках-обработчиках (chat_worker.c), поэтому медленная рассылка
+одного шарда не задерживает остальных. Журнал событий в stdout пишет отдельный поток
+(event_log.c): медленный терминал или канал не останавливает доставку.
+Метрики (server_stats.c) отдаёт свой поток на порту 5556 (CHAT_STATS), смотреть - ./chat_stats
+*/
+
+// сколько сообщений фронтенд пересылает в одну сторону, прежде чем проверить другую
+#define FRONTEND_BATCH 256
+
+
+static int worker_count(int argc, char **argv) {
+    const char *value = (argc > 1) ? argv[1] : getenv(CHAT_WORKERS_ENV);
+    long count = value ? atol(value) : sysconf(_SC_NPROCESSORS_ONLN);
+    if (count < 1) {
+        count = 1;
+    }
+    return (count > CHAT_MAX_WORKERS) ? CHAT_MAX_WORKERS : (int)count;
+}
 
-typedef struct {
-    char name[USERNAME_SIZE];
-    int online;
-    char zmq_id[ZMQ_ID_LEN];
-    size_t zmq_id_size;
-} user_t;
+// переслать оставшиеся кадры сообщения (после первого) из from в to
+static void forward_rest(void *from, void *to, zmq_msg_t *first) {
+    int more = zmq_msg_more(first);
+    if (zmq_msg_send(first, to, more ? ZMQ_SNDMORE : 0) < 0) {
+        zmq_msg_close(first);
+    }
+    while (more) {
+        zmq_msg_t frame;
+        zmq_msg_init(&frame);
+        zmq_msg_recv(&frame, from, 0);
+        more = zmq_msg_more(&frame);
+        if (zmq_msg_send(&frame, to, more ? ZMQ_SNDMORE : 0) < 0) {
+            zmq_msg_close(&frame);
+        }
+    }
+}
 
-typedef struct {
-    struct timespec deliver_at;
-    char sender[USERNAME_SIZE];
-    char receiver[USERNAME_SIZE];
-    char payload[MAX_MSG_LEN];
-} delayed_msg_t;
+// отбросить оставшиеся кадры сообщения
+static void discard_rest(void *from, int more) {
+    while (more) {
+        zmq_msg_t frame;
+        zmq_msg_init(&frame);
+        zmq_msg_recv(&frame, from, 0);
+        more = zmq_msg_more(&frame);
+        zmq_msg_close(&frame);
+    }
+}
 
-void current_time(char *buf, size_t size) {
-    time_t t = time(NULL);
-    struct tm *tm = localtime(&t);
+// клиент -> шард; 0 - входящих больше нет
+static int forward_inbound(void *router, void **inboxes, int count, frontend_stats *stats) {
+    zmq_msg_t id;
+    zmq_msg_init(&id);
+    if (zmq_msg_recv(&id, router, ZMQ_DONTWAIT) < 0) {
+        zmq_msg_close(&id);
+        return 0;
+    }
 
-    snprintf(buf, size,
-             "[%02d:%02d:%02d]",
-             tm->tm_hour,
-             tm->tm_min,
-             tm->tm_sec);
+    void *inbox = inboxes[worker_shard(zmq_msg_data(&id), zmq_msg_size(&id), count)];
+    char type = WORKER_CLIENT;
+    zmq_send(inbox, &type, 1, ZMQ_SNDMORE);
+    forward_rest(router, inbox, &id);
+    stats_add(&stats->inbound, 1);
+    return 1;
 }
 
-void format_time(time_t t, char *buf, size_t size) {
-    struct tm *tm = localtime(&t);
-    snprintf(buf, size,
-             "%02d:%02d:%02d",
-             tm->tm_hour,
-             tm->tm_min,
-             tm->tm_sec);
+// отключить медленного клиента: шард помечает его ушедшим
+static void evict_client(void **inboxes, int count, zmq_msg_t *id) {
+    void *inbox = inboxes[worker_shard(zmq_msg_data(id), zmq_msg_size(id), count)];
+    char type = WORKER_EVICT;
+    zmq_send(inbox, &type, 1, ZMQ_SNDMORE);
+    zmq_send(inbox, zmq_msg_data(id), zmq_msg_size(id), 0);
 }
 
-timespec_ge(const struct timespec *a, const struct timespec *b) {
-    return (a->tv_sec > b->tv_sec) ||
-           (a->tv_sec == b->tv_sec &&
-            a->tv_nsec >= b->tv_nsec);
-}
+// обработчик -> клиент (или в очередь клиента, outbound_queue.c)
+static int forward_outbound(void *outbound, void *router, void **inboxes, int count,
+                            outbound_queues *queues) {
+    zmq_msg_t id;
+    zmq_msg_init(&id);
+    if (zmq_msg_recv(&id, outbound, ZMQ_DONTWAIT) < 0) {
+        zmq_msg_close(&id);
+        return 0;
+    }
+    zmq_msg_t text;
+    zmq_msg_init(&text);
+    if (!zmq_msg_more(&id) || zmq_msg_recv(&text, outbound, 0) < 0) {
+        zmq_msg_close(&text);
+        zmq_msg_close(&id);
+        return 1;
+    }
+    discard_rest(outbound, zmq_msg_more(&text));
 
-int find_user(user_t *users, int count, const char *name) {
-    for (int i = 0; i < count; i++) {
-        if (strcmp(users[i].name, name) == 0) {
-            return i;
-        }
+    if (outq_send(queues, router, zmq_msg_data(&id), zmq_msg_size(&id), &text)) {
+        evict_client(inboxes, count, &id);
     }
-    return -1;
+    zmq_msg_close(&id);
+    return 1;
 }
 
-int main() {
+int main(int argc, char **argv) {
+    int count = worker_count(argc, argv);
+    evlog_start(STDOUT_FILENO);
     void *ctx = zmq_ctx_new();
     void *router = zmq_socket(ctx, ZMQ_ROUTER);
+    int mandatory = 1;
+    zmq_setsockopt(router, ZMQ_ROUTER_MANDATORY, &mandatory, sizeof(mandatory));
 
     zmq_bind(router, "tcp://*:5555");
 
-    user_t users[MAX_USERS];
-    delayed_msg_t delayed[MAX_DELAYED];
-    int user_count = 0, delayed_count = 0;
-
-    while (1) {
-        zmq_pollitem_t items[] = {
-            {router, 0, ZMQ_POLLIN, 0}
-        };
-        zmq_poll(items, 1, 100);
-
-        if (items[0].revents & ZMQ_POLLIN) {
-            zmq_msg_t id;
-            zmq_msg_t msg;
-
-            zmq_msg_init(&id);
-            zmq_msg_init(&msg);
-
-            zmq_msg_recv(&id, router, 0);
-            zmq_msg_recv(&msg, router, 0);
-
-            char sender[USERNAME_SIZE];
-            char text[MAX_MSG_LEN];
-            memcpy(sender, zmq_msg_data(&id), zmq_msg_size(&id));
-            memcpy(text, zmq_msg_data(&msg), zmq_msg_size(&msg));
-            sender[zmq_msg_size(&id)] = '\0';
-            text[zmq_msg_size(&msg)] = '\0';
-
-            char ts[TIME_LEN];
-
-            if (strcmp(text, "JOIN") == 0) {
-                int idx = find_user(users, user_count, sender);
-                current_time(ts, sizeof(ts));
-                
-                if (idx >= 0 && users[idx].online) {
-                    zmq_msg_close(&id);
-                    zmq_msg_close(&msg);
-                    continue;
-                }
-
-                if (idx < 0) {
-                    idx = user_count++;
-                    strcpy(users[idx].name, sender);
-                }
-                
-                users[idx].online = 1;
-                memcpy(users[idx].zmq_id, zmq_msg_data(&id), zmq_msg_size(&id));
-                users[idx].zmq_id_size = zmq_msg_size(&id);
-
-                printf("%s client joined: %s\n", ts, sender);
-            } else if (strcmp(text, "/exit") == 0) {
-                int idx =  find_user(users, user_count, sender);
-                if (idx >= 0) {
-                    users[idx].online = 0;
-                }
-                printf("%s client disconnected: %s\n", ts, sender);
-            } else if (text[0] == '/') {
-                char *space1 = strchr(text, ' ');
-                if (!space1) {
-                    zmq_msg_close(&id);
-                    zmq_msg_close(&msg);
-                    continue;
-                }
-
-                *space1 = '\0';
-                char *cmd = text;
-                char *rest = space1 + 1;
+    void *outbound = zmq_socket(ctx, ZMQ_PULL);
+    int hwm = 0;
+    zmq_setsockopt(outbound, ZMQ_RCVHWM, &hwm, sizeof(hwm));
+    zmq_bind(outbound, OUTBOUND_ENDPOINT);
 
-                char *space2 = strchr(rest, ' ');
-                if (!space2) {
-                    zmq_msg_close(&id);
-                    zmq_msg_close(&msg); 
-                    continue;
-                }
+    chat_worker *workers = workers_start(ctx, count);
 
-                *space2 = '\0';
-
-                if (rest[0] != '@') {
-                    zmq_msg_close(&id);
-                    zmq_msg_close(&msg);
-                    continue;
-                }
-
-                char *target = rest + 1;
-                char *payload = space2 + 1;
-
-                if (payload[0] == '\0' || target[0] == '\0') {
-                    zmq_msg_close(&id);
-                    zmq_msg_close(&msg);
-                    continue;
-                }
-
-                if (strcmp(target, "all") == 0) {
-                    if (strcmp(cmd, "/m") != 0) {
-                        zmq_msg_close(&id);
-                        zmq_msg_close(&msg);
-                        continue;
-                    }
-                }
-
-                current_time(ts, sizeof(ts));
-
-                if (strcmp(cmd, "/m") == 0) {
-                    if (strcmp(target, "all") == 0) {
-                        printf("%s %s -> all: %s\n", ts, sender, payload);
-                        char out_other[MAX_MSG_LEN];
-                        char out_me[MAX_MSG_LEN];
-
-                        snprintf(out_other, sizeof(out_other), "%s %s -> all: %s", ts, sender, payload);
-                        snprintf(out_me, sizeof(out_me), "%s Me: %s", ts, payload);
-                        for (int i = 0; i < user_count; i++) {
-                            if (!users[i].online) {
-                                continue;
-                            }
-
-                            zmq_send(router, users[i].zmq_id, users[i].zmq_id_size, ZMQ_SNDMORE);
-                            if (strcmp(users[i].name, sender) == 0) {
-                                zmq_send(router, out_me, strlen(out_me), 0);
-                            } else {
-                                zmq_send(router, out_other, strlen(out_other), 0);
-                            }
-                        }
-                    } else {
-                        printf("%s %s -> %s: %s\n", ts, sender, target, payload);
-
-                        int r_idx = find_user(users, user_count, target);
-                        if (r_idx >= 0 && users[r_idx].online) {
-                            char out[MAX_MSG_LEN];
-                            if (strcmp(target, sender) == 0) {
-                                snprintf(out, sizeof(out), "%s Me: %s", ts, payload);
-                            } else {
-                                snprintf(out, sizeof(out), "%s %s -> %s: %s", ts, sender, target, payload);
-                            }
-
-                            zmq_send(router, users[r_idx].zmq_id, users[r_idx].zmq_id_size, ZMQ_SNDMORE);
-                            zmq_send(router, out, strlen(out), 0);
-                        }
-                    }
-                } else if (strncmp(cmd, "/dm_", 4) == 0) {
-                    int delay = atoi(cmd + 4);
-                    if (delay <= 0 || delayed_count >= MAX_DELAYED) {
-                        zmq_msg_close(&id);
-                        zmq_msg_close(&msg);
-                        continue;
-                    }
-
-                    struct timespec now_mono;
-                    clock_gettime(CLOCK_MONOTONIC, &now_mono);
+    static frontend_stats stats;
+    worker_stats *shard_stats[CHAT_MAX_WORKERS];
+    for (int i = 0; i < count; i++) {
+        shard_stats[i] = workers[i].stats;
+    }
+    const char *stats_endpoint = getenv(STATS_ENDPOINT_ENV) ? getenv(STATS_ENDPOINT_ENV) : STATS_ENDPOINT_DEFAULT;
+    stats_start(ctx, stats_endpoint, shard_stats, count, &stats);
+    evlog(EVLOG_INFO, "Chat server: %d worker threads, stats on %s", count, stats_endpoint);
 
-                    struct timespec deliver_at;
-                    deliver_at.tv_sec  = now_mono.tv_sec + delay;
-                    deliver_at.tv_nsec = now_mono.tv_nsec;
+    outbound_queues queues;
+    outq_init(&queues, &stats);
 
-                    time_t eta_wall = time(NULL) + delay;
-                    char eta[TIME_LEN];
-                    format_time(eta_wall, eta, sizeof(eta));
+    void *inboxes[CHAT_MAX_WORKERS];
+    char endpoint[64];
+    for (int i = 0; i < count; i++) {
+        inboxes[i] = zmq_socket(ctx, ZMQ_PUSH);
+        zmq_setsockopt(inboxes[i], ZMQ_SNDHWM, &hwm, sizeof(hwm));
+        snprintf(endpoint, sizeof(endpoint), WORKER_ENDPOINT_FORMAT, i);
+        zmq_connect(inboxes[i], endpoint);
+    }
 
-                    printf("%s (DELAYED) %s -> %s: %s (ETA %s)\n", ts, sender, target, payload, eta);
+    zmq_pollitem_t items[] = {
+        {router, 0, ZMQ_POLLIN, 0},
+        {outbound, 0, ZMQ_POLLIN, 0}
+    };
 
-                    delayed_msg_t *d = &delayed[delayed_count++];
-                    d->deliver_at = deliver_at;
-                    strcpy(d->sender, sender);
-                    strcpy(d->receiver, target);
-                    strcpy(d->payload, payload);
-                }
+    // пока есть ждущие в очередях клиентов - повтор раз в QUEUE_RETRY_MS, иначе poll без таймаута
+    uint64_t next_retry = 0;
+    while (1) {
+        long timeout = -1;
+        if (queues.pending_count > 0) {
+            uint64_t now = monotonic_ns();
+            timeout = (now >= next_retry) ? 0 : (long)((next_retry - now + 999999) / 1000000);
+        }
+        if (zmq_poll(items, 2, timeout) < 0) {
+            break;
+        }
+        if (queues.pending_count > 0 && monotonic_ns() >= next_retry) {
+            outq_flush(&queues, router);
+            next_retry = monotonic_ns() + QUEUE_RETRY_MS * 1000000ull;
+        }
+        if (items[0].revents & ZMQ_POLLIN) {
+            for (int i = 0; i < FRONTEND_BATCH && forward_inbound(router, inboxes, count, &stats); i++) {
             }
-            zmq_msg_close(&id);
-            zmq_msg_close(&msg);
-            continue;
         }
-
-        struct timespec now_mono;
-        clock_gettime(CLOCK_MONOTONIC, &now_mono);
-        for (int i = 0; i < delayed_count; ) {
-            if (timespec_ge(&now_mono, &delayed[i].deliver_at)) {
-                char ts[TIME_LEN];
-                current_time(ts, sizeof(ts));
-
-                int r_idx = find_user(users, user_count, delayed[i].receiver);
-                
-                if (r_idx >= 0 && users[r_idx].online) {
-                    printf("%s (DELAYED DELIVERED) %s -> %s: %s\n", ts, delayed[i].sender, delayed[i].receiver, delayed[i].payload);
-                    char out[MAX_MSG_LEN];
-
-                    snprintf(out, sizeof(out), "%s (delayed) %s -> %s: %s", ts, delayed[i].sender, delayed[i].receiver, delayed[i].payload);
-                    zmq_send(router, users[r_idx].zmq_id, users[r_idx].zmq_id_size, ZMQ_SNDMORE);
-                    zmq_send(router, out, strlen(out), 0);                
-                } else {
-                    printf("%s (DELAYED DROPPED) %s -> %s: %s (receiver offline)\n", ts, delayed[i].sender, delayed[i].receiver, delayed[i].payload);
-                }
-                delayed[i] = delayed[--delayed_count];
-            } else {
-                i++;
+        if (items[1].revents & ZMQ_POLLIN) {
+            for (int i = 0; i < FRONTEND_BATCH && forward_outbound(outbound, router, inboxes, count, &queues); i++) {
             }
         }
     }
+
+    for (int i = 0; i < count; i++) {
+        zmq_close(inboxes[i]);
+    }
+    free(workers);
+    zmq_close(outbound);
     zmq_close(router);
     zmq_ctx_destroy(ctx);
-}
\ No newline at end of file
+    evlog_stop();
+}
@@ -0,0 +1,202 @@
+#include <zmq.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "server_stats.h"
+#include "delayed_queue.h"
+#include "event_log.h"
+
+#define MAX_STAT_WORKERS 64
+#define REPORT_SIZE 16384
+
+static const char *command_names[STATS_COMMANDS] = {"join", "exit", "direct", "broadcast", "delayed", "ping"};
+
+// суммы по обработчикам в момент запроса
+typedef struct {
+    uint64_t time;
+    uint64_t commands[STATS_COMMANDS];
+    uint64_t worker_commands[MAX_STAT_WORKERS];
+    uint64_t forwarded;
+    uint64_t inbound;
+    uint64_t outbound;
+    latency_hist latency[STATS_COMMANDS];
+} stats_snapshot;
+
+typedef struct {
+    void *socket;
+    worker_stats **workers;
+    int count;
+    frontend_stats *frontend;
+    uint64_t started;
+    stats_snapshot previous;
+    stats_snapshot current;
+    latency_hist interval;
+    char report[REPORT_SIZE];
+    size_t length;
+} stats_server;
+
+
+static uint64_t load(_Atomic uint64_t *counter) {
+    return atomic_load_explicit(counter, memory_order_relaxed);
+}
+
+void stats_record_command(worker_stats *stats, chat_opcode opcode, uint64_t elapsed_ns) {
+    int command = (int)opcode - 1;
+    stats_add(&stats->commands[command], 1);
+    stats_add(&stats->latency[command][hist_bucket(elapsed_ns)], 1);
+}
+
+static void take_snapshot(stats_server *s, stats_snapshot *snap) {
+    memset(snap, 0, sizeof(*snap));
+    snap->time = monotonic_ns();
+    for (int w = 0; w < s->count; w++) {
+        worker_stats *ws = s->workers[w];
+        for (int c = 0; c < STATS_COMMANDS; c++) {
+            uint64_t commands = load(&ws->commands[c]);
+            snap->commands[c] += commands;
+            snap->worker_commands[w] += commands;
+            for (int b = 0; b < HIST_BUCKETS; b++) {
+                snap->latency[c].counts[b] += load(&ws->latency[c][b]);
+            }
+        }
+        snap->forwarded += load(&ws->forwarded);
+    }
+    snap->inbound = load(&s->frontend->inbound);
+    snap->outbound = load(&s->frontend->outbound);
+}
+
+static void append(stats_server *s, const char *format, ...) __attribute__((format(printf, 2, 3)));
+
+static void append(stats_server *s, const char *format, ...) {
+    if (s->length >= sizeof(s->report)) {
+        return;
+    }
+    va_list args;
+    va_start(args, format);
+    int n = vsnprintf(s->report + s->length, sizeof(s->report) - s->length, format, args);
+    va_end(args);
+    if (n > 0) {
+        s->length += (size_t)n;
+    }
+}
+
+// процентиль времени обработки команды за интервал между снимками, мкс
+static double interval_percentile(stats_server *s, int command, double percentile) {
+    latency_hist *h = &s->interval;
+    hist_init(h);
+    h->max = UINT64_MAX;
+    for (int b = 0; b < HIST_BUCKETS; b++) {
+        h->counts[b] = s->current.latency[command].counts[b] - s->previous.latency[command].counts[b];
+        h->total += h->counts[b];
+    }
+    return (double)hist_percentile(h, percentile) / 1e3;
+}
+
+static void build_report(stats_server *s) {
+    stats_snapshot *cur = &s->current;
+    stats_snapshot *prev = &s->previous;
+    take_snapshot(s, cur);
+    double interval = (double)(cur->time - prev->time) / 1e9;
+    s->length = 0;
+
+    uint64_t online = 0, queued = 0, stored = 0, idle = 0, slow = 0, lag = 0;
+    for (int w = 0; w < s->count; w++) {
+        online += load(&s->workers[w]->online);
+        queued += load(&s->workers[w]->delayed_queued);
+        stored += load(&s->workers[w]->delayed_stored);
+        idle += load(&s->workers[w]->evicted_idle);
+        slow += load(&s->workers[w]->evicted_slow);
+    }
+
+    append(s, "uptime_s %.1f\n", (double)(cur->time - s->started) / 1e9);
+    append(s, "interval_s %.3f\n", interval);
+    append(s, "workers %d\n", s->count);
+    append(s, "online_users %llu\n", (unsigned long long)online);
+    append(s, "delayed_queued %llu\n", (unsigned long long)queued);
+    append(s, "delayed_stored %llu\n", (unsigned long long)stored);
+
+    // насколько самый ранний срок в очереди уже просрочен: растёт, если обработчик не успевает
+    for (int w = 0; w < s->count; w++) {
+        uint64_t deadline = load(&s->workers[w]->next_deadline);
+        uint64_t worker_lag = (deadline != 0 && cur->time > deadline) ? cur->time - deadline : 0;
+        if (worker_lag > lag) {
+            lag = worker_lag;
+        }
+    }
+    append(s, "next_deadline_lag_ms %.3f\n", (double)lag / 1e6);
+
+    append(s, "inbound_per_s %.1f\n", (double)(cur->inbound - prev->inbound) / interval);
+    append(s, "outbound_per_s %.1f\n", (double)(cur->outbound - prev->outbound) / interval);
+    append(s, "forwarded_per_s %.1f\n", (double)(cur->forwarded - prev->forwarded) / interval);
+    append(s, "send_dropped_full %llu\n", (unsigned long long)load(&s->frontend->dropped_full));
+    append(s, "send_dropped_unroutable %llu\n", (unsigned long long)load(&s->frontend->dropped_unroutable));
+    append(s, "outbound_queued %llu\n", (unsigned long long)load(&s->frontend->queued));
+    append(s, "outbound_spilled %llu\n", (unsigned long long)load(&s->frontend->spilled));
+    append(s, "evicted_slow %llu\n", (unsigned long long)slow);
+    append(s, "evicted_idle %llu\n", (unsigned long long)idle);
+    append(s, "event_log_dropped %llu\n", (unsigned long long)evlog_dropped());
+
+    for (int c = 0; c < STATS_COMMANDS; c++) {
+        const char *name = command_names[c];
+        append(s, "cmd_%s_total %llu\n", name, (unsigned long long)cur->commands[c]);
+        append(s, "cmd_%s_per_s %.1f\n", name, (double)(cur->commands[c] - prev->commands[c]) / interval);
+        append(s, "cmd_%s_p50_us %.1f\n", name, interval_percentile(s, c, 50));
+        append(s, "cmd_%s_p99_us %.1f\n", name, interval_percentile(s, c, 99));
+    }
+    for (int w = 0; w < s->count; w++) {
+        append(s, "worker%d_commands_per_s %.1f\n", w,
+               (double)(cur->worker_commands[w] - prev->worker_commands[w]) / interval);
+    }
+
+    *prev = *cur;
+}
+
+static void *stats_loop(void *arg) {
+    stats_server *s = arg;
+    char request[256];
+    while (1) {
+        if (zmq_recv(s->socket, request, sizeof(request), 0) < 0) {
+            break;
+        }
+        int more = 0;
+        size_t more_size = sizeof(more);
+        zmq_getsockopt(s->socket, ZMQ_RCVMORE, &more, &more_size);
+        while (more) {
+            zmq_recv(s->socket, request, sizeof(request), 0);
+            zmq_getsockopt(s->socket, ZMQ_RCVMORE, &more, &more_size);
+        }
+
+        build_report(s);
+        zmq_send(s->socket, s->report, s->length, 0);
+    }
+    zmq_close(s->socket);
+    return NULL;
+}
+
+void stats_start(void *ctx, const char *endpoint, worker_stats **workers, int count,
+                 frontend_stats *frontend) {
+    stats_server *s = calloc(1, sizeof(stats_server));
+    if (s == NULL) {
+        perror("calloc");
+        exit(1);
+    }
+    s->socket = zmq_socket(ctx, ZMQ_REP);
+    if (zmq_bind(s->socket, endpoint) != 0) {
+        fprintf(stderr, "%s: %s\n", endpoint, zmq_strerror(zmq_errno()));
+        exit(1);
+    }
+    s->workers = workers;
+    s->count = (count > MAX_STAT_WORKERS) ? MAX_STAT_WORKERS : count;
+    s->frontend = frontend;
+    s->started = monotonic_ns();
+    s->previous.time = s->started;
+
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, stats_loop, s) != 0) {
+        perror("pthread_create");
+        exit(1);
+    }
+    pthread_detach(thread);
+}
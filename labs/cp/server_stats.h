@@ -0,0 +1,60 @@
+#ifndef SERVER_STATS_H
+#define SERVER_STATS_H
+
+#include <stdatomic.h>
+#include <stdint.h>
+#include "chat_protocol.h"
+#include "latency_hist.h"
+
+/*
+Метрики сервера. Каждый счётчик пишет один поток (обработчик или фронтенд) обычной
+атомарной записью без барьеров, читает - поток статистики. Ни блокировок, ни сообщений
+обработчикам: ответ приходит и тогда, когда обработчики перегружены.
+Запрос - любое сообщение в REQ-сокет (CHAT_STATS, по умолчанию порт 5556), ответ - строки
+"имя значение".
+Частоты и процентили - за время с прошлого запроса
+*/
+
+#define STATS_ENDPOINT_ENV "CHAT_STATS"
+#define STATS_ENDPOINT_DEFAULT "tcp://*:5556"
+#define STATS_COMMANDS CHAT_OP_PING         // индекс команды - opcode - 1
+
+typedef struct {
+    _Atomic uint64_t commands[STATS_COMMANDS];
+    // время обработки команды, нс: ячейки latency_hist
+    _Atomic uint64_t latency[STATS_COMMANDS][HIST_BUCKETS];
+    _Atomic uint64_t forwarded;             // D/B/S от других обработчиков
+    _Atomic uint64_t online;
+    _Atomic uint64_t delayed_queued;        // в куче, срок не наступил
+    _Atomic uint64_t delayed_stored;        // в почтовых ящиках, адресат не в сети
+    _Atomic uint64_t next_deadline;         // ближайший срок, CLOCK_MONOTONIC; 0 - очередь пуста
+    _Atomic uint64_t evicted_idle;          // отключены: нет PING дольше CHAT_IDLE_TIMEOUT
+    _Atomic uint64_t evicted_slow;          // отключены: очередь во фронтенде переполнена (disconnect)
+} worker_stats;
+
+typedef struct {
+    _Atomic uint64_t inbound;               // сообщений клиентов
+    _Atomic uint64_t outbound;              // отправлено клиентам
+    _Atomic uint64_t dropped_full;          // выброшено из полной очереди клиента (drop-oldest, disconnect)
+    _Atomic uint64_t dropped_unroutable;    // не отправлено: клиент отключился
+    _Atomic uint64_t queued;                // ждут в очередях клиентов (outbound_queue.c)
+    _Atomic uint64_t spilled;               // ждут в файлах очередей (spill)
+} frontend_stats;
+
+// запись единственным писателем: без lock-префикса и барьеров
+static inline void stats_add(_Atomic uint64_t *counter, uint64_t value) {
+    atomic_store_explicit(counter, atomic_load_explicit(counter, memory_order_relaxed) + value,
+                          memory_order_relaxed);
+}
+
+static inline void stats_set(_Atomic uint64_t *counter, uint64_t value) {
+    atomic_store_explicit(counter, value, memory_order_relaxed);
+}
+
+void stats_record_command(worker_stats *stats, chat_opcode opcode, uint64_t elapsed_ns);
+
+// поток статистики: REP-сокет на endpoint; workers - count указателей
+void stats_start(void *ctx, const char *endpoint, worker_stats **workers, int count,
+                 frontend_stats *frontend);
+
+#endif
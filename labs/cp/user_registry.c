@@ -0,0 +1,207 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "user_registry.h"
+
+/*
+Реестр пользователей чата с поиском за O(1):
+    - by_name - по имени (JOIN, адресат /m и /dm_N, отложенная доставка)
+    - by_id   - по routing id ROUTER-сокета (кто прислал сообщение)
+Таблицы заполнены не больше чем наполовину и растут удвоением, поэтому цепочки
+пробирования короткие; удаление из by_id - со сдвигом назад, без "надгробий"
+*/
+
+#define MAP_EMPTY (-1)
+#define MAP_INITIAL_SLOTS 64
+#define REGISTRY_INITIAL_USERS 32
+
+
+static void *checked_realloc(void *ptr, size_t size) {
+    void *result = realloc(ptr, size);
+    if (result == NULL) {
+        perror("realloc");
+        exit(1);
+    }
+    return result;
+}
+
+// FNV-1a с перемешиванием в конце: у имён вида user00017 различаются только последние байты
+static uint32_t hash_bytes(const void *data, size_t size) {
+    const unsigned char *p = data;
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < size; i++) {
+        h ^= p[i];
+        h *= 16777619u;
+    }
+    h ^= h >> 16;
+    h *= 0x85ebca6bu;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35u;
+    h ^= h >> 16;
+    return h;
+}
+
+uint32_t registry_hash(const void *data, size_t size) {
+    return hash_bytes(data, size);
+}
+
+static void map_init(index_map *map, size_t slots) {
+    map->slots = checked_realloc(NULL, slots * sizeof(index_slot));
+    for (size_t i = 0; i < slots; i++) {
+        map->slots[i].index = MAP_EMPTY;
+    }
+    map->mask = slots - 1;
+    map->count = 0;
+}
+
+static int key_matches(const user_t *user, int by_id, const void *key, size_t size) {
+    if (by_id) {
+        return user->zmq_id_size == size && memcmp(user->zmq_id, key, size) == 0;
+    }
+    return strcmp(user->name, key) == 0;
+}
+
+static int map_find(const index_map *map, const user_t *users, int by_id,
+                    const void *key, size_t size, uint32_t hash) {
+    for (size_t i = hash & map->mask; map->slots[i].index != MAP_EMPTY; i = (i + 1) & map->mask) {
+        if (map->slots[i].hash == hash && key_matches(&users[map->slots[i].index], by_id, key, size)) {
+            return map->slots[i].index;
+        }
+    }
+    return -1;
+}
+
+static void map_place(index_map *map, int32_t index, uint32_t hash) {
+    size_t i = hash & map->mask;
+    while (map->slots[i].index != MAP_EMPTY) {
+        i = (i + 1) & map->mask;
+    }
+    map->slots[i].index = index;
+    map->slots[i].hash = hash;
+}
+
+static void map_insert(index_map *map, int32_t index, uint32_t hash) {
+    if ((map->count + 1) * 2 > map->mask + 1) {
+        index_map old = *map;
+        map_init(map, (old.mask + 1) * 2);
+        for (size_t i = 0; i <= old.mask; i++) {
+            if (old.slots[i].index != MAP_EMPTY) {
+                map_place(map, old.slots[i].index, old.slots[i].hash);
+            }
+        }
+        map->count = old.count;
+        free(old.slots);
+    }
+    map_place(map, index, hash);
+    map->count++;
+}
+
+// удаление записи index: следующие за ней в цепочке сдвигаются на освободившееся место
+static void map_remove(index_map *map, int32_t index, uint32_t hash) {
+    size_t i = hash & map->mask;
+    while (map->slots[i].index != index) {
+        if (map->slots[i].index == MAP_EMPTY) {
+            return;
+        }
+        i = (i + 1) & map->mask;
+    }
+
+    size_t hole = i;
+    for (size_t j = (hole + 1) & map->mask; map->slots[j].index != MAP_EMPTY; j = (j + 1) & map->mask) {
+        size_t home = map->slots[j].hash & map->mask;
+        // запись j можно сдвинуть в дыру, если её родная ячейка не лежит между дырой и j
+        if (((j - home) & map->mask) >= ((j - hole) & map->mask)) {
+            map->slots[hole] = map->slots[j];
+            hole = j;
+        }
+    }
+    map->slots[hole].index = MAP_EMPTY;
+    map->count--;
+}
+
+void registry_init(user_registry *reg) {
+    reg->count = 0;
+    reg->capacity = REGISTRY_INITIAL_USERS;
+    reg->users = checked_realloc(NULL, reg->capacity * sizeof(user_t));
+    reg->online = checked_realloc(NULL, reg->capacity * sizeof(int32_t));
+    reg->online_count = 0;
+    map_init(&reg->by_name, MAP_INITIAL_SLOTS);
+    map_init(&reg->by_id, MAP_INITIAL_SLOTS);
+}
+
+void registry_free(user_registry *reg) {
+    free(reg->users);
+    free(reg->online);
+    free(reg->by_name.slots);
+    free(reg->by_id.slots);
+    memset(reg, 0, sizeof(*reg));
+}
+
+int registry_find(const user_registry *reg, const char *name) {
+    return map_find(&reg->by_name, reg->users, 0, name, 0, hash_bytes(name, strlen(name)));
+}
+
+int registry_find_id(const user_registry *reg, const void *id, size_t size) {
+    return map_find(&reg->by_id, reg->users, 1, id, size, hash_bytes(id, size));
+}
+
+int registry_add(user_registry *reg, const char *name) {
+    if (reg->count == reg->capacity) {
+        reg->capacity *= 2;
+        reg->users = checked_realloc(reg->users, reg->capacity * sizeof(user_t));
+        reg->online = checked_realloc(reg->online, reg->capacity * sizeof(int32_t));
+    }
+
+    int idx = (int)reg->count++;
+    user_t *user = &reg->users[idx];
+    snprintf(user->name, sizeof(user->name), "%s", name);
+    user->online = 0;
+    user->online_pos = -1;
+    user->zmq_id_size = 0;
+    user->last_seen = 0;
+    user->mailbox = NULL;
+    user->mailbox_tail = NULL;
+    map_insert(&reg->by_name, idx, hash_bytes(user->name, strlen(user->name)));
+    return idx;
+}
+
+void registry_clear_id(user_registry *reg, int idx) {
+    user_t *user = &reg->users[idx];
+    if (user->zmq_id_size > 0) {
+        map_remove(&reg->by_id, idx, hash_bytes(user->zmq_id, user->zmq_id_size));
+        user->zmq_id_size = 0;
+    }
+}
+
+void registry_set_id(user_registry *reg, int idx, const void *id, size_t size) {
+    if (size == 0 || size > ZMQ_ID_LEN) {
+        return;
+    }
+    registry_clear_id(reg, idx);
+
+    // тот же id мог остаться у другой записи (переподключение под другим именем)
+    int owner = registry_find_id(reg, id, size);
+    if (owner >= 0) {
+        registry_clear_id(reg, owner);
+    }
+
+    user_t *user = &reg->users[idx];
+    memcpy(user->zmq_id, id, size);
+    user->zmq_id_size = size;
+    map_insert(&reg->by_id, idx, hash_bytes(id, size));
+}
+
+void registry_set_online(user_registry *reg, int idx, int online) {
+    user_t *user = &reg->users[idx];
+    if (online && !user->online) {
+        user->online_pos = (int32_t)reg->online_count;
+        reg->online[reg->online_count++] = idx;
+    } else if (!online && user->online) {
+        // на место ушедшего - последний из списка
+        int32_t last = reg->online[--reg->online_count];
+        reg->online[user->online_pos] = last;
+        reg->users[last].online_pos = user->online_pos;
+        user->online_pos = -1;
+    }
+    user->online = online;
+}
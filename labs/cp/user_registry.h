@@ -0,0 +1,76 @@
+#ifndef USER_REGISTRY_H
+#define USER_REGISTRY_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define ZMQ_ID_LEN 256
+#define USERNAME_SIZE 256
+
+struct delayed_msg;
+
+typedef struct {
+    char name[USERNAME_SIZE];
+    int online;
+    int32_t online_pos;                 // место в registry.online (если online)
+    char zmq_id[ZMQ_ID_LEN];
+    size_t zmq_id_size;
+    uint64_t last_seen;                 // CLOCK_MONOTONIC последней команды (если online)
+    struct delayed_msg *mailbox;        // отложенные сообщения, срок которых наступил,
+    struct delayed_msg *mailbox_tail;   // пока пользователь был не в сети (доставка на JOIN)
+} user_t;
+
+/*
+Индекс по ключу (имя или routing id): открытая адресация с линейным пробированием.
+В ячейке - номер пользователя в registry.users и хэш ключа (сравнение ключей только
+при совпадении хэша). Пустая ячейка - index == -1
+*/
+typedef struct {
+    int32_t index;
+    uint32_t hash;
+} index_slot;
+
+typedef struct {
+    index_slot *slots;
+    size_t mask;                    // число ячеек - 1 (степень двойки)
+    size_t count;
+} index_map;
+
+/*
+Реестр пользователей: массив растёт удвоением, записи не удаляются (ушедший пользователь
+остаётся с online = 0 и при повторном JOIN получает ту же запись).
+by_id содержит только пользователей, у которых сейчас есть routing id.
+online - плотный список номеров пользователей в сети: рассылка всем идёт по нему,
+не просматривая ушедших
+*/
+typedef struct {
+    user_t *users;
+    size_t count;
+    size_t capacity;
+    index_map by_name;
+    index_map by_id;
+    int32_t *online;
+    size_t online_count;
+} user_registry;
+
+void registry_init(user_registry *reg);
+void registry_free(user_registry *reg);
+
+// номер пользователя или -1
+int registry_find(const user_registry *reg, const char *name);
+int registry_find_id(const user_registry *reg, const void *id, size_t size);
+
+// новый пользователь (имя ещё не занято); возвращает его номер
+int registry_add(user_registry *reg, const char *name);
+
+// привязать routing id к пользователю (старый id, если был, из индекса убирается)
+void registry_set_id(user_registry *reg, int idx, const void *id, size_t size);
+void registry_clear_id(user_registry *reg, int idx);
+
+// хэш имени / routing id, тот же, что в индексах (для распределения по шардам)
+uint32_t registry_hash(const void *data, size_t size);
+
+// вход/выход пользователя: флаг online и список registry.online
+void registry_set_online(user_registry *reg, int idx, int online);
+
+#endif
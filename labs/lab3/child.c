@@ -1,11 +1,50 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdint.h>
 #include <unistd.h>
-#include <ctype.h>
+#include <sched.h>
 #include "./shared_memory.h"
 
 
+/*
+Сумма чисел строки [p, end) прямо из разделяемой памяти, без копирования и без '\0' в конце.
+Токены разделены пробелами и табуляциями; как и atoi(), берётся числовой префикс токена,
+нечисловой токен даёт 0
+*/
+static int64_t sum_line(const char *p, const char *end) {
+    int64_t sum = 0;
+
+    while (p < end) {
+        while (p < end && (*p == ' ' || *p == '\t')) {
+            p++;
+        }
+        if (p == end) {
+            break;
+        }
+
+        int negative = 0;
+        if (*p == '-' || *p == '+') {
+            negative = (*p == '-');
+            p++;
+        }
+
+        int64_t value = 0;
+        while (p < end && *p >= '0' && *p <= '9') {
+            value = value * 10 + (*p - '0');
+            p++;
+        }
+        sum += negative ? -value : value;
+
+        // хвост токена после числа пропускаем
+        while (p < end && *p != ' ' && *p != '\t') {
+            p++;
+        }
+    }
+    return sum;
+}
+
+
 int main(int argc, char *argv[]) {
     if (argc != 3) {
         // fprintf() вместо perror() из-за отсутствия форматирования во втором
@@ -16,51 +55,56 @@ int main(int argc, char *argv[]) {
     const char *input_shm_name = argv[1];
     const char *output_shm_name = argv[2];
 
-    shared_memory *input_shm = open_shared_memory(input_shm_name);
-    shared_memory *output_shm = open_shared_memory(output_shm_name);
+    // входной сегмент после публикации только читается - отображаем его без права записи
+    shared_memory *input_shm = open_shared_memory(input_shm_name, 1);
+    shared_memory *output_shm = open_shared_memory(output_shm_name, 0);
 
     // ожидание готовности от родительского процесса
     while (!input_shm->data_ready) {
         usleep(100 * 1000); // 100ms
     }
 
-    // копия входных данных для безопасной обработки
-    char input_copy[SHARED_SIZE];
-    strncpy(input_copy, input_shm->data, SHARED_SIZE - 1);
-    input_copy[SHARED_SIZE - 1] = '\0';
-
-    char *output_ptr = output_shm->data;
-    // Обрабатываем каждую строку отдельно
-    char *line_start = input_copy;
-    char *line_end;
-
-    while (line_start && *line_start) {
-        // поиск конца строки
-        line_end = strchr(line_start, '\n');
-        if (line_end) {
-            *line_end = '\0'; // образ строки
+    /*
+    Потомки разбирают общую очередь пакетов, пока родитель не закроет её.
+    Пустая очередь без флага closed означает, что родитель ещё нарезает данные
+    */
+    line_batch batch;
+    while (1) {
+        if (queue_pop(&output_shm->queue, &batch) == -1) {
+            if (!queue_is_closed(&output_shm->queue)) {
+                sched_yield();
+                continue;
+            }
+            // всё, что положено до закрытия, уже видно - последняя попытка
+            if (queue_pop(&output_shm->queue, &batch) == -1) {
+                break;
+            }
         }
 
-        int sum = 0;
-        char *token = strtok(line_start, " \t");
-        while (token) {
-            if (strlen(token) > 0) {
-                sum += atoi(token);
-            }
-            token = strtok(NULL, " \t");
+        // пакет приходит через разделяемую память - проверяем, что он не выходит за границы сегментов
+        if (batch.offset + batch.length > SHARED_SIZE || batch.first_line + batch.line_count > MAX_LINES) {
+            fprintf(stderr, "Некорректный пакет: offset=%zu length=%zu\n", batch.offset, batch.length);
+            continue;
         }
 
-        output_ptr += sprintf(output_ptr, "%d\n", sum);
+        // строки разбираются прямо в отображении входного сегмента
+        const char *line_start = input_shm->data + batch.offset;
+        const char *batch_end = line_start + batch.length;
+        int64_t *sums = output_shm->sums.values + batch.first_line;
+
+        for (size_t line = 0; line < batch.line_count; line++) {
+            const char *line_end = memchr(line_start, '\n', batch_end - line_start);
+            if (!line_end) {
+                line_end = batch_end;
+            }
 
-        // next line
-        if (line_end) {
+            sums[line] = sum_line(line_start, line_end);
             line_start = line_end + 1;
-        } else {
-            break;
         }
+
+        __atomic_add_fetch(&output_shm->lines_done, batch.line_count, __ATOMIC_RELEASE);
     }
 
-    output_shm->process_complete = 1;       // флаг готовности для родительского процесса
     close_shared_memory(input_shm, input_shm_name, 0);
     close_shared_memory(output_shm, output_shm_name, 0);
 
@@ -1,7 +1,9 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <inttypes.h>
 #include <unistd.h>
+#include <sched.h>
 #include <sys/wait.h>
 #include "./shared_memory.h"
 
@@ -18,8 +20,21 @@ int main() {
         exit(EXIT_FAILURE);
     }
 
-    shared_memory *input_shm = create_shared_memory(SHM_NAME_1);
-    shared_memory *output_data = create_shared_memory(SHM_NAME_2);
+    /*
+    Флаги каждого сегмента задаются отдельно через окружение, например:
+        SHM_INPUT_FLAGS=hugetlb,populate SHM_OUTPUT_FLAGS=populate,mlock ./parent
+    По умолчанию сегменты анонимные (memfd): параллельные запуски не затирают друг другу
+    /dev/shm/sum_calc_shm_*. Старый режим с именованными объектами - SHM_NAMED=1
+    */
+    int mode = getenv("SHM_NAMED") ? 0 : SHM_FLAG_MEMFD;
+    shared_memory *input_shm = create_shared_memory(SHM_NAME_1, mode | parse_shm_flags(getenv("SHM_INPUT_FLAGS")));
+    shared_memory *output_data = create_shared_memory(SHM_NAME_2, mode | parse_shm_flags(getenv("SHM_OUTPUT_FLAGS")));
+
+    // как потомок найдёт сегменты: имя или "fd:N"
+    char input_handle[FILENAME_SIZE];
+    char output_handle[FILENAME_SIZE];
+    shared_memory_handle(input_shm, SHM_NAME_1, input_handle, sizeof(input_handle));
+    shared_memory_handle(output_data, SHM_NAME_2, output_handle, sizeof(output_handle));
 
     // загрузка данных из файла в shared memory
     FILE *file =  fopen(filename, "r");
@@ -34,47 +49,94 @@ int main() {
     input_shm->data[bytes_read] = '\0';
     fclose(file);
 
-    pid_t child_pid = fork_process();
+    // по одному обработчику на ядро, но не больше MAX_WORKERS
+    long cpu_count = sysconf(_SC_NPROCESSORS_ONLN);
+    int worker_count = (cpu_count < 1) ? 1 : (cpu_count > MAX_WORKERS ? MAX_WORKERS : (int)cpu_count);
+    pid_t child_pids[MAX_WORKERS];
 
-    if (child_pid == 0) {
-        // после execl закрыть отображения будет невозможно, поэтому закрываем + в ребёнке мы заново их октрываем
-        close_shared_memory(input_shm, SHM_NAME_1, 0);
-        close_shared_memory(output_data, SHM_NAME_2, 0);
+    for (int i = 0; i < worker_count; i++) {
+        child_pids[i] = fork_process();
 
-        execl("./child", "child", SHM_NAME_1, SHM_NAME_2, NULL);
-        perror("execl failed");
-        exit(EXIT_FAILURE);
+        if (child_pids[i] == 0) {
+            // после execl закрыть отображения будет невозможно, поэтому закрываем + в ребёнке мы заново их октрываем
+            close_shared_memory(input_shm, SHM_NAME_1, 0);
+            close_shared_memory(output_data, SHM_NAME_2, 0);
+
+            execl("./child", "child", input_handle, output_handle, NULL);
+            perror("execl failed");
+            exit(EXIT_FAILURE);
+        }
+    }
 
-    } else {
-        input_shm->data_ready = 1;      // флаг готовности для дочернего процесса
+    input_shm->data_ready = 1;      // флаг готовности для дочерних процессов
+
+    /*
+    Нарезка входных данных на пакеты по BATCH_LINES строк.
+    Границы строк совпадают с тем, как их разбирает child: строки разделены '\n',
+    завершающий '\n' не порождает лишней пустой строки
+    */
+    const char *data = input_shm->data;
+    size_t length = strlen(data);
+    size_t pos = 0;
+    size_t line_count = 0;
+
+    while (pos < length) {
+        line_batch batch;
+        batch.offset = pos;
+        batch.first_line = line_count;
+        batch.line_count = 0;
+
+        while (pos < length && batch.line_count < BATCH_LINES) {
+            const char *line_end = memchr(data + pos, '\n', length - pos);
+            pos = line_end ? (size_t)(line_end - data) + 1 : length;
+            batch.line_count++;
+        }
+        batch.length = pos - batch.offset;
+        line_count += batch.line_count;
 
-        // ожидание готовности от дочернего процесса
-        while (!output_data->process_complete) {
-            usleep(100 * 1000); // 100ms
+        // очередь заполнена - уступаем процессор обработчикам
+        while (queue_push(&output_data->queue, &batch) == -1) {
+            sched_yield();
         }
-        
-        printf("Результат обработки:\n");
-        printf("%s", output_data->data);
-        /*
-        waitpid() - заставляет родительский процесс ждать завершения дочернего процесса с указанным PID
-        Принимает:
-            - child_pid - pid дочернего процесса
-            - NULL - указатель на переменную для сохранения статуса завершения (в данном случае не нужен)
-            - 0 - опции: <0> означает, что waitpid() будет ждать до завершения дочернего процесса
-        Возвращает:
-            - число > 0 - PID завершившегося дочернего процесса
-            - 0 - дочерний процесс ещё не завершился
-            - -1 - ошибка
-        */
-        if (waitpid(child_pid, NULL, 0) == -1) {
+    }
+
+    output_data->sums.count = (int64_t)line_count;
+    queue_close(&output_data->queue);   // новых пакетов не будет - потомки завершатся, разобрав очередь
+
+    /*
+    waitpid() - заставляет родительский процесс ждать завершения дочернего процесса с указанным PID
+    Принимает:
+        - child_pid - pid дочернего процесса
+        - NULL - указатель на переменную для сохранения статуса завершения (в данном случае не нужен)
+        - 0 - опции: <0> означает, что waitpid() будет ждать до завершения дочернего процесса
+    Возвращает:
+        - число > 0 - PID завершившегося дочернего процесса
+        - 0 - дочерний процесс ещё не завершился
+        - -1 - ошибка
+    */
+    for (int i = 0; i < worker_count; i++) {
+        if (waitpid(child_pids[i], NULL, 0) == -1) {
             perror("waitpid failed");
         }
+    }
 
-        close_shared_memory(input_shm, SHM_NAME_1, 1);
-        close_shared_memory(output_data, SHM_NAME_2, 1);
+    size_t lines_done = __atomic_load_n(&output_data->lines_done, __ATOMIC_ACQUIRE);
+    if (lines_done != line_count) {
+        fprintf(stderr, "Обработано %zu строк из %zu\n", lines_done, line_count);
+    }
 
-        printf("Обработка завершена\n");
+    // суммы лежат по номерам строк, поэтому порядок вывода совпадает с порядком во входном файле;
+    // в текст они превращаются только здесь
+    const sum_array *sums = &output_data->sums;
+    printf("Результат обработки:\n");
+    for (int64_t i = 0; i < sums->count; i++) {
+        printf("%" PRId64 "\n", sums->values[i]);
     }
 
+    close_shared_memory(input_shm, SHM_NAME_1, 1);
+    close_shared_memory(output_data, SHM_NAME_2, 1);
+
+    printf("Обработка завершена\n");
+
     return 0;
-}   
\ No newline at end of file
+}
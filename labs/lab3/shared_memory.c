@@ -1,51 +1,169 @@
 #include "./shared_memory.h"
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>     // PATH_MAX
 #include <unistd.h>     // close(), fork()
 #include <fcntl.h>      // флаги по типу O_CREAT, O_RDWR
 #include <sys/stat.h>   // для работы с правами доступа
+#include <sys/socket.h> // sendmsg()/recvmsg() для передачи дескрипторов
 #include <sys/wait.h>   // для ожидания завершения активных процессов
 
 
-shared_memory *create_shared_memory(const char* name) {
-    if (shm_unlink(name) == -1 && errno != ENOENT) {
-        perror("shm_unlink in create");
+// размер отображения: для huge pages длина должна быть кратна размеру большой страницы
+static size_t mapping_size(int flags) {
+    size_t size = sizeof(shared_memory);
+    if (flags & SHM_FLAG_HUGETLB) {
+        size = (size + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+    }
+    return size;
+}
+
+// путь файла сегмента в hugetlbfs: shm-имена начинаются с '/', поэтому просто приклеиваем
+static void hugetlb_path(const char *name, char *path, size_t size) {
+    snprintf(path, size, "%s%s", HUGETLBFS_MOUNT, name);
+}
+
+static void unlink_backing(const char *name, int flags) {
+    if (flags & SHM_FLAG_MEMFD) {
+        return;     // у memfd нет имени в файловой системе - удалять нечего
+    }
+    if (flags & SHM_FLAG_HUGETLB) {
+        char path[PATH_MAX];
+        hugetlb_path(name, path, sizeof(path));
+        if (unlink(path) == -1) {
+            perror("unlink");
+        }
+    } else if (shm_unlink(name) == -1) {
+        perror("shm_unlink");
+    }
+}
+
+/*
+Прогрев и закрепление уже отображённого сегмента (SHM_FLAG_POPULATE / SHM_FLAG_MLOCK).
+Ошибки здесь не фатальны: сегмент остаётся рабочим, просто без оптимизации
+*/
+static void prepare_mapping(shared_memory *shm, size_t size, int flags, int populated, int readonly) {
+    if ((flags & SHM_FLAG_POPULATE) && !populated) {
+#ifdef MADV_POPULATE_WRITE
+        // Linux 5.14+: заполняем таблицы страниц заранее, без первых page fault при обработке
+        int advice = readonly ? MADV_POPULATE_READ : MADV_POPULATE_WRITE;
+        if (madvise(shm, size, advice) == -1) {
+            perror("madvise(MADV_POPULATE)");
+        }
+#else
+        madvise(shm, size, MADV_WILLNEED);
+#endif
     }
 
     /*
-    shm_open() - функция для создания/открытия объекта разделяемой памяти (shared memory)
-    Принимает:
-        - name - имя объекта
-        - O_CREAT | O_RDWR - флаги: в данном случае - (создать если не существует) и открыть для чтения и записи 
-        - 0666 - права доступа (чтение и запись для всех)
-    Возвращает файловый дескриптор в случае успеха, иначе -1 = ошибка
+    mlock() - запрещает вытеснение страниц сегмента в swap.
+    Ограничено RLIMIT_MEMLOCK (ulimit -l), поэтому при ошибке только предупреждаем
     */
-    int fd = shm_open(name, O_CREAT | O_RDWR, 0666);    
-    if (fd == -1) {
+    if ((flags & SHM_FLAG_MLOCK) && mlock(shm, size) == -1) {
+        perror("mlock");
+    }
+}
+
+
+shared_memory *create_shared_memory(const char* name, int flags) {
+    int fd;
+    char path[PATH_MAX];
+
+    if (flags & SHM_FLAG_MEMFD) {
         /*
-        perror - выводит в stderr сообщение об ошибке, а затем переданное пользовательское сообщение
+        memfd_create() - создаёт анонимный файл в памяти и возвращает его дескриптор.
+        Имя нужно только для отладки (видно в /proc/<pid>/fd как memfd:<name>), поэтому
+        одновременные запуски не конфликтуют и нечего удалять при аварийном завершении.
+        Принимает:
+            - name - отладочное имя
+            - MFD_ALLOW_SEALING - разрешить печати (F_SEAL_*) на файле
+            - MFD_HUGETLB - файл на huge pages
+        Дескриптор создаётся без MFD_CLOEXEC - он должен пережить execl в дочернем процессе
         */
-        perror("shm_open");     
-        exit(EXIT_FAILURE);
+        const char *memfd_name = (name[0] == '/') ? name + 1 : name;
+        unsigned int memfd_flags = MFD_ALLOW_SEALING | ((flags & SHM_FLAG_HUGETLB) ? MFD_HUGETLB : 0);
+        fd = memfd_create(memfd_name, memfd_flags);
+        if (fd == -1) {
+            perror("memfd_create");
+            if (flags & SHM_FLAG_HUGETLB) {
+                fprintf(stderr, "Huge pages недоступны для %s, используются обычные страницы\n", name);
+                return create_shared_memory(name, flags & ~SHM_FLAG_HUGETLB);
+            }
+            exit(EXIT_FAILURE);
+        }
+    } else if (flags & SHM_FLAG_HUGETLB) {
+        /*
+        Сегмент на huge pages: файл в смонтированной hugetlbfs.
+        Требуется зарезервировать страницы: echo N > /proc/sys/vm/nr_hugepages
+        */
+        hugetlb_path(name, path, sizeof(path));
+        if (unlink(path) == -1 && errno != ENOENT) {
+            perror("unlink in create");
+        }
+
+        fd = open(path, O_CREAT | O_RDWR, 0666);
+        if (fd == -1) {
+            perror("open hugetlbfs");
+            fprintf(stderr, "Huge pages недоступны для %s, используются обычные страницы\n", name);
+            return create_shared_memory(name, flags & ~SHM_FLAG_HUGETLB);
+        }
+    } else {
+        if (shm_unlink(name) == -1 && errno != ENOENT) {
+            perror("shm_unlink in create");
+        }
+
+        /*
+        shm_open() - функция для создания/открытия объекта разделяемой памяти (shared memory)
+        Принимает:
+            - name - имя объекта
+            - O_CREAT | O_RDWR - флаги: в данном случае - (создать если не существует) и открыть для чтения и записи 
+            - 0666 - права доступа (чтение и запись для всех)
+        Возвращает файловый дескриптор в случае успеха, иначе -1 = ошибка
+        */
+        fd = shm_open(name, O_CREAT | O_RDWR, 0666);    
+        if (fd == -1) {
+            /*
+            perror - выводит в stderr сообщение об ошибке, а затем переданное пользовательское сообщение
+            */
+            perror("shm_open");     
+            exit(EXIT_FAILURE);
+        }
     }
 
+    size_t size = mapping_size(flags);
+
     /*
     ftruncate() - устанавливает размер файла в указанное значение
     Принимает:
         - fd - файловый дескриптор, которому нужно установить новый размер
-        - sizeof() - новый размер
+        - size - новый размер
     Возвращает 0 при успехе, -1 при ошибке
 
     Использование ftruncate64(): требуеься только если нужны файлы больше 2GB на 32-битных системах
     */
-    if (ftruncate(fd, sizeof(shared_memory)) == -1) {   
+    if (ftruncate(fd, size) == -1) {   
+        perror("ftruncate");
         close(fd);
         /*
         shm_unlink() - удаляет имя объекта shared memory. После этого, когда все процессы отобразят объект, он уничтожается
         Принимает: 
             - name - имя объекта
         */
-        shm_unlink(name);     
+        unlink_backing(name, flags);
+        exit(EXIT_FAILURE);
+    }
+
+    /*
+    Печати memfd: после F_SEAL_SHRINK | F_SEAL_GROW размер файла больше не может измениться,
+    поэтому потребитель отображает сегмент без повторных проверок и без риска SIGBUS
+    из-за усечения файла. F_SEAL_SEAL запрещает снимать/добавлять печати дальше
+    */
+    if ((flags & SHM_FLAG_MEMFD) &&
+        fcntl(fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL) == -1) {
+        perror("fcntl(F_ADD_SEALS)");
+        close(fd);
         exit(EXIT_FAILURE);
     }
 
@@ -53,36 +171,114 @@ shared_memory *create_shared_memory(const char* name) {
     mmap() - отображение shared memory в адресное пространство процесса.
     Принимает:
         - NULL - предпочтительный адрес отображения (NULL даёт системе выбрать самой)
-        - sizeof() - размер отомбражаемой части
+        - size - размер отомбражаемой части
         - PROT_READ | PROT_WRITE - прав доступа: чтение и доступ
         - MAP_SHARED - флаг, что изменения видны другим процессам
+          (+ MAP_POPULATE - сразу выделить и отобразить все страницы, а не при первом обращении)
         - fd - соответствующий файловый дескриптор
         - 0 - смещение в файле на <0> байт
     Возвращает: указатель на память, где расположен, в случае успеха и MAP_FAILED в случае неудачи
     */
-    shared_memory *shm = mmap(NULL, sizeof(shared_memory), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);  // PROT = protection, предположительно, безопасные константы    
+    int map_flags = MAP_SHARED | ((flags & SHM_FLAG_POPULATE) ? MAP_POPULATE : 0);
+    shared_memory *shm = mmap(NULL, size, PROT_READ | PROT_WRITE, map_flags, fd, 0);  // PROT = protection, предположительно, безопасные константы    
     if (shm == MAP_FAILED) {
         perror("mmap");
         close(fd);
-        shm_unlink(name);
+        unlink_backing(name, flags);
+        if (flags & SHM_FLAG_HUGETLB) {
+            // чаще всего - не зарезервированы huge pages (nr_hugepages = 0)
+            fprintf(stderr, "Huge pages недоступны для %s, используются обычные страницы\n", name);
+            return create_shared_memory(name, flags & ~SHM_FLAG_HUGETLB);
+        }
         exit(EXIT_FAILURE);
     }
 
-    close(fd);      // после отображения файла в памяти в дескрипторе нет необходимости
+    // после отображения файла в памяти в дескрипторе нет необходимости (кроме memfd - его наследуют потомки)
+    if (flags & SHM_FLAG_MEMFD) {
+        shm->memfd = fd;
+    } else {
+        close(fd);
+        shm->memfd = -1;
+    }
+    prepare_mapping(shm, size, flags, 1, 0);
+
+    shm->mapped_size = size;
+    shm->flags = flags;
     shm->data_ready = 0;
     shm->process_complete = 0;
+    shm->sums.count = 0;
+    shm->lines_done = 0;
+    queue_init(&shm->queue);
+    return shm;
+}
+
+
+/*
+Открытие memfd-сегмента по дескриптору (унаследованному через execl или полученному через SCM_RIGHTS).
+Сегмент принимается только с печатями SHRINK и GROW: тогда размер, прочитанный один раз, неизменен.
+readonly - отобразить только для чтения (сегмент, который после публикации никто не меняет)
+*/
+shared_memory *open_shared_memory_fd(int fd, int readonly) {
+    int seals = fcntl(fd, F_GET_SEALS);
+    if (seals == -1) {
+        perror("fcntl(F_GET_SEALS)");
+        exit(EXIT_FAILURE);
+    }
+    if ((seals & (F_SEAL_SHRINK | F_SEAL_GROW)) != (F_SEAL_SHRINK | F_SEAL_GROW)) {
+        fprintf(stderr, "Сегмент fd:%d не запечатан, размер может измениться\n", fd);
+        exit(EXIT_FAILURE);
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) == -1 || (size_t)st.st_size < sizeof(shared_memory)) {
+        fprintf(stderr, "Некорректный размер сегмента fd:%d\n", fd);
+        exit(EXIT_FAILURE);
+    }
+    size_t size = (size_t)st.st_size;
+
+    int prot = readonly ? PROT_READ : PROT_READ | PROT_WRITE;
+    shared_memory *shm = mmap(NULL, size, prot, MAP_SHARED, fd, 0);
+    if (shm == MAP_FAILED) {
+        perror("mmap");
+        exit(EXIT_FAILURE);
+    }
+
+    close(fd);      // отображение держит файл само, дескриптор потомку больше не нужен
+    prepare_mapping(shm, size, shm->flags, 0, readonly);
     return shm;
 }
 
 
-shared_memory *open_shared_memory(const char* name) {
-    int fd = shm_open(name, O_RDWR, 0666);
+shared_memory *open_shared_memory(const char* name, int readonly) {
+    // "fd:N" - анонимный сегмент, дескриптор N унаследован от родителя
+    if (strncmp(name, SHM_FD_PREFIX, strlen(SHM_FD_PREFIX)) == 0) {
+        return open_shared_memory_fd(atoi(name + strlen(SHM_FD_PREFIX)), readonly);
+    }
+
+    // потомок не знает флагов родителя: ищем сегмент сначала в /dev/shm, затем в hugetlbfs
+    int open_flags = readonly ? O_RDONLY : O_RDWR;
+    int fd = shm_open(name, open_flags, 0666);
+    if (fd == -1 && errno == ENOENT) {
+        char path[PATH_MAX];
+        hugetlb_path(name, path, sizeof(path));
+        fd = open(path, open_flags);
+    }
     if (fd == -1) {
         perror("shm_open");
         exit(EXIT_FAILURE);
     }
 
-    shared_memory *shm = mmap(NULL, sizeof(shared_memory), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0); // аналогично функции в create функции
+    // реальный размер берём у файла - он зависит от флагов, с которыми сегмент создан
+    struct stat st;
+    if (fstat(fd, &st) == -1 || (size_t)st.st_size < sizeof(shared_memory)) {
+        fprintf(stderr, "Некорректный размер сегмента %s\n", name);
+        close(fd);
+        exit(EXIT_FAILURE);
+    }
+    size_t size = (size_t)st.st_size;
+
+    int prot = readonly ? PROT_READ : PROT_READ | PROT_WRITE;
+    shared_memory *shm = mmap(NULL, size, prot, MAP_SHARED, fd, 0); // аналогично функции в create функции
     if (shm == MAP_FAILED) {
         perror("mmap");
         close(fd);
@@ -90,6 +286,8 @@ shared_memory *open_shared_memory(const char* name) {
     }
 
     close(fd);
+    // флаги сегмента записал создатель - прогреваем своё отображение так же
+    prepare_mapping(shm, size, shm->flags, 0, readonly);
     return shm;
 }
 
@@ -97,21 +295,212 @@ shared_memory *open_shared_memory(const char* name) {
 void close_shared_memory(shared_memory *shm, const char* name, int unlink) { 
     if (shm == NULL) return;
 
+    // после munmap заголовок сегмента недоступен, поэтому размер и флаги читаем заранее
+    size_t size = shm->mapped_size;
+    int flags = shm->flags;
+    int memfd = shm->memfd;
+
     /*
     munmap() - отменяет отображение shared memory из адресного пространства процесса.
     Принимает:
         - shm - указатель на начало отображения
-        - sizeof() - размер отображения
+        - size - размер отображения
     Возвравщает: 0 при успехе, -1 в случае ошибки
     Примечание: полсе munmap обращение по указателю shm будет некорректным
     */
-    if(munmap(shm, sizeof(shared_memory)) == -1) {
+    if(munmap(shm, size) == -1) {
         perror("munmap");
     }
 
-    if (unlink && shm_unlink(name) == -1) {
-        perror("shm_unlink"); 
+    if (unlink) {
+        unlink_backing(name, flags);
+        // владелец memfd закрывает свой дескриптор - файл исчезнет, когда его отпустят все потомки
+        if ((flags & SHM_FLAG_MEMFD) && close(memfd) == -1) {
+            perror("close memfd");
+        }
+    }
+}
+
+
+/*
+Строка, по которой потомок откроет сегмент через open_shared_memory():
+имя для именованного сегмента или "fd:N" для memfd (номера дескрипторов сохраняются при fork/execl)
+*/
+void shared_memory_handle(shared_memory *shm, const char *name, char *buf, size_t size) {
+    if (shm->flags & SHM_FLAG_MEMFD) {
+        snprintf(buf, size, "%s%d", SHM_FD_PREFIX, shm->memfd);
+    } else {
+        snprintf(buf, size, "%s", name);
+    }
+}
+
+
+/*
+Передача дескриптора сегмента неродственному процессу через unix-сокет (SCM_RIGHTS).
+Ядро создаёт в процессе-получателе новый дескриптор на тот же memfd
+Возвращают 0 / полученный дескриптор при успехе, -1 при ошибке
+*/
+int send_shared_memory_fd(int sock, int fd) {
+    char byte = 0;
+    struct iovec iov = { .iov_base = &byte, .iov_len = 1 };     // хотя бы один байт данных обязателен
+    char control[CMSG_SPACE(sizeof(int))];
+    memset(control, 0, sizeof(control));
+
+    struct msghdr msg = {0};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+    memcpy(CMSG_DATA(cmsg), &fd, sizeof(int));
+
+    if (sendmsg(sock, &msg, 0) == -1) {
+        perror("sendmsg");
+        return -1;
+    }
+    return 0;
+}
+
+int recv_shared_memory_fd(int sock) {
+    char byte;
+    struct iovec iov = { .iov_base = &byte, .iov_len = 1 };
+    char control[CMSG_SPACE(sizeof(int))];
+
+    struct msghdr msg = {0};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+
+    if (recvmsg(sock, &msg, MSG_CMSG_CLOEXEC) <= 0) {
+        perror("recvmsg");
+        return -1;
+    }
+
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+    if (cmsg == NULL || cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS) {
+        fprintf(stderr, "recv_shared_memory_fd: дескриптор не передан\n");
+        return -1;
+    }
+
+    int fd;
+    memcpy(&fd, CMSG_DATA(cmsg), sizeof(int));
+    return fd;
+}
+
+
+/*
+Разбор флагов сегмента из строки вида "hugetlb,populate,mlock" (например, из переменной окружения).
+Неизвестные слова пропускаются с предупреждением
+*/
+int parse_shm_flags(const char *spec) {
+    int flags = 0;
+    if (spec == NULL) return 0;
+
+    char copy[256];
+    snprintf(copy, sizeof(copy), "%s", spec);
+
+    for (char *word = strtok(copy, ", "); word; word = strtok(NULL, ", ")) {
+        if (strcmp(word, "hugetlb") == 0) {
+            flags |= SHM_FLAG_HUGETLB;
+        } else if (strcmp(word, "populate") == 0) {
+            flags |= SHM_FLAG_POPULATE;
+        } else if (strcmp(word, "mlock") == 0) {
+            flags |= SHM_FLAG_MLOCK;
+        } else if (strcmp(word, "memfd") == 0) {
+            flags |= SHM_FLAG_MEMFD;
+        } else {
+            fprintf(stderr, "Неизвестный флаг сегмента: %s\n", word);
+        }
+    }
+    return flags;
+}
+
+
+/*
+Очередь пакетов - ограниченная MPMC-очередь Д. Вьюкова.
+Каждая ячейка хранит номер поколения sequence:
+    - sequence == pos        -> ячейка свободна для производителя с позицией pos
+    - sequence == pos + 1    -> ячейка заполнена и готова для потребителя с позицией pos
+Позиции захватываются через CAS, поэтому ни один процесс не держит блокировку - если потомок
+умрёт посреди операции, остальные не зависнут на мьютексе в разделяемой памяти.
+Используются встроенные атомарные операции GCC (__atomic_*), т.к. проект собирается в C99
+*/
+void queue_init(work_queue *queue) {
+    for (size_t i = 0; i < QUEUE_CAPACITY; i++) {
+        queue->cells[i].sequence = i;
+    }
+    queue->enqueue_pos = 0;
+    queue->dequeue_pos = 0;
+    queue->closed = 0;
+}
+
+// возвращает 0 при успехе, -1 если очередь заполнена
+int queue_push(work_queue *queue, const line_batch *batch) {
+    queue_cell *cell;
+    size_t pos = __atomic_load_n(&queue->enqueue_pos, __ATOMIC_RELAXED);
+
+    while (1) {
+        cell = &queue->cells[pos & (QUEUE_CAPACITY - 1)];
+        size_t seq = __atomic_load_n(&cell->sequence, __ATOMIC_ACQUIRE);
+        ptrdiff_t diff = (ptrdiff_t)seq - (ptrdiff_t)pos;
+
+        if (diff == 0) {
+            // при неудаче CAS записывает в pos актуальное значение
+            if (__atomic_compare_exchange_n(&queue->enqueue_pos, &pos, pos + 1, 1,
+                                            __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                break;
+            }
+        } else if (diff < 0) {
+            return -1;
+        } else {
+            pos = __atomic_load_n(&queue->enqueue_pos, __ATOMIC_RELAXED);
+        }
+    }
+
+    cell->batch = *batch;
+    __atomic_store_n(&cell->sequence, pos + 1, __ATOMIC_RELEASE);   // публикация пакета
+    return 0;
+}
+
+// возвращает 0 при успехе, -1 если очередь пуста
+int queue_pop(work_queue *queue, line_batch *batch) {
+    queue_cell *cell;
+    size_t pos = __atomic_load_n(&queue->dequeue_pos, __ATOMIC_RELAXED);
+
+    while (1) {
+        cell = &queue->cells[pos & (QUEUE_CAPACITY - 1)];
+        size_t seq = __atomic_load_n(&cell->sequence, __ATOMIC_ACQUIRE);
+        ptrdiff_t diff = (ptrdiff_t)seq - (ptrdiff_t)(pos + 1);
+
+        if (diff == 0) {
+            if (__atomic_compare_exchange_n(&queue->dequeue_pos, &pos, pos + 1, 1,
+                                            __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                break;
+            }
+        } else if (diff < 0) {
+            return -1;
+        } else {
+            pos = __atomic_load_n(&queue->dequeue_pos, __ATOMIC_RELAXED);
+        }
     }
+
+    *batch = cell->batch;
+    // освобождаем ячейку для производителя следующего круга
+    __atomic_store_n(&cell->sequence, pos + QUEUE_CAPACITY, __ATOMIC_RELEASE);
+    return 0;
+}
+
+void queue_close(work_queue *queue) {
+    __atomic_store_n(&queue->closed, 1, __ATOMIC_RELEASE);
+}
+
+int queue_is_closed(work_queue *queue) {
+    return __atomic_load_n(&queue->closed, __ATOMIC_ACQUIRE);
 }
 
 
@@ -1,6 +1,8 @@
 #ifndef SHARED_MEMORY_H
 #define SHARED_MEMORY_H
 
+#include <stddef.h>
+#include <stdint.h>
 #include <sys/mman.h>
 #include <sys/types.h>
 #include <unistd.h>
@@ -13,19 +15,115 @@ relat@relatinchik:/mnt/c/C/OS/labs/lab3$ getconf PAGESIZE
 4096
 ```
 Это аппаратно-определённое значение для эффективной работы MMU (Memory Management Unit)
+Для больших входных данных размер можно переопределить при сборке: make CFLAGS+=-DSHARED_SIZE=...
 */
+#ifndef SHARED_SIZE
 #define SHARED_SIZE 4096
+#endif
 
+/*
+Флаги сегмента для create_shared_memory (комбинируются через |):
+    - SHM_FLAG_HUGETLB  - сегмент на huge pages (файл в hugetlbfs): меньше промахов TLB
+    - SHM_FLAG_POPULATE - заранее выделить все страницы (MAP_POPULATE): без page fault при первом обращении
+    - SHM_FLAG_MLOCK    - закрепить страницы в RAM (mlock): горячий сегмент не уйдёт в swap
+    - SHM_FLAG_MEMFD    - анонимный сегмент (memfd_create) вместо имени в /dev/shm: передаётся потомку
+                          дескриптором ("fd:N"), запечатан от изменения размера
+*/
+#define SHM_FLAG_HUGETLB  0x1
+#define SHM_FLAG_POPULATE 0x2
+#define SHM_FLAG_MLOCK    0x4
+#define SHM_FLAG_MEMFD    0x8
+
+// префикс аргумента потомка для сегмента, переданного дескриптором
+#define SHM_FD_PREFIX "fd:"
+
+#define HUGETLBFS_MOUNT "/dev/hugepages"
+#define HUGE_PAGE_SIZE (2UL * 1024 * 1024)
+
+// каждая строка занимает хотя бы один байт ('\n'), поэтому строк не больше, чем байт
+#define MAX_LINES SHARED_SIZE
+
+// ёмкость очереди пакетов (обязательно степень двойки - индекс ячейки берётся маской)
+#define QUEUE_CAPACITY 64
+
+// сколько строк родитель кладёт в один пакет
+#define BATCH_LINES 16
+
+// верхняя граница числа дочерних процессов-обработчиков
+#define MAX_WORKERS 16
+
+// размер кэш-линии: счётчики производителей и потребителей разносим, чтобы не было false sharing
+#define CACHE_LINE 64
+
+
+/*
+Дескриптор пакета строк: сами строки лежат во входном сегменте, в очередь кладётся только
+смещение/длина и номер первой строки (он же индекс в выходном массиве сумм)
+*/
 typedef struct {
+    size_t offset;          // смещение начала пакета в data
+    size_t length;          // длина пакета в байтах
+    size_t first_line;      // глобальный номер первой строки пакета
+    size_t line_count;      // количество строк в пакете
+} line_batch;
+
+typedef struct {
+    size_t sequence;        // номер "поколения" ячейки (алгоритм Д. Вьюкова)
+    line_batch batch;
+} queue_cell;
+
+/*
+Ограниченная lock-free очередь MPMC (много производителей / много потребителей).
+Живёт в разделяемой памяти, поэтому вместо мьютексов используются атомарные операции
+над индексами enqueue_pos/dequeue_pos и номерами поколений в ячейках
+*/
+typedef struct {
+    queue_cell cells[QUEUE_CAPACITY];
+    char pad0[CACHE_LINE];
+    size_t enqueue_pos;
+    char pad1[CACHE_LINE - sizeof(size_t)];
+    size_t dequeue_pos;
+    char pad2[CACHE_LINE - sizeof(size_t)];
+    int closed;             // производители больше ничего не положат
+} work_queue;
+
+/*
+Результаты в компактном двоичном виде: массив int64 с префиксом длины.
+Потомки пишут суммы по номеру строки, текст формирует только родитель при выводе,
+поэтому размер выходных данных ограничен MAX_LINES по построению
+*/
+typedef struct {
+    int64_t count;                  // число строк (длина массива)
+    int64_t values[MAX_LINES];
+} sum_array;
+
+typedef struct {
+    size_t mapped_size;             // реальный размер отображения (с учётом выравнивания под huge pages)
+    int flags;                      // SHM_FLAG_*, с которыми создан сегмент
+    int memfd;                      // дескриптор memfd в процессе-создателе (-1 для именованных)
     char data[SHARED_SIZE];
     int data_ready;
     int process_complete;
+    work_queue queue;               // очередь пакетов (используется в выходном сегменте)
+    size_t lines_done;              // сколько строк уже посчитано потомками
+    sum_array sums;                 // суммы, адресуемые номером строки
 } shared_memory;
 
-shared_memory *create_shared_memory(const char* name);
-shared_memory *open_shared_memory(const char* name);
+shared_memory *create_shared_memory(const char* name, int flags);
+shared_memory *open_shared_memory(const char* name, int readonly);
+shared_memory *open_shared_memory_fd(int fd, int readonly);
 void close_shared_memory(shared_memory *shm, const char* name, int unlink);
+void shared_memory_handle(shared_memory *shm, const char *name, char *buf, size_t size);
+int send_shared_memory_fd(int sock, int fd);
+int recv_shared_memory_fd(int sock);
+int parse_shm_flags(const char *spec);
+
+void queue_init(work_queue *queue);
+int queue_push(work_queue *queue, const line_batch *batch);
+int queue_pop(work_queue *queue, line_batch *batch);
+void queue_close(work_queue *queue);
+int queue_is_closed(work_queue *queue);
 
 pid_t fork_process();
 
-#endif
\ No newline at end of file
+#endif
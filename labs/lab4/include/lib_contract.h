@@ -1,15 +1,63 @@
 #ifndef LIB_CONTRACT_H
 #define LIB_CONTRACT_H
 
+#include <stddef.h>
+
+/*
+Всё, что объявлено через LIB_API, экспортируется из библиотеки всегда. При сборке с
+-fvisibility=hidden (make startup-variants) остальные функции становятся локальными:
+таблица динамических символов меньше, вызовы внутри библиотеки идут напрямую, без PLT
+*/
+#define LIB_API __attribute__((visibility("default")))
 
 // Функция 1: Вычисление интеграла sin(x) на отрезке [A, B]
 // A, B - границы отрезка, e - шаг интегрирования
 // Возвращает: приближённое значение интеграла
-float sinIntegral(float A, float B, float e);
+LIB_API float sinIntegral(float A, float B, float e);
 
 // Функция 2: Поиск наибольшего общего делителя (НОД) двух натуральных чисел
 // A, B - натуральные числа (>0)
 // Возвращает: НОД(A, B)
-int GCF(int A, int B);
+LIB_API int GCF(int A, int B);
+
+// Функция 2а: Пакетный НОД - out[i] = GCF(A[i], B[i]) для i < n
+// Один вызов через границу библиотеки на весь массив вместо n вызовов
+LIB_API void GCF_many(const int *A, const int *B, int *out, size_t n);
+
+// Функция 3: Пакетное вычисление sin(x) в n точках (SIMD-ядро: AVX2 / SSE2 / скалярное)
+// x - точки, out - результаты (может совпадать с x), n - количество точек
+// sinIntegral в обеих библиотеках - обёртка над этой функцией
+LIB_API void sinBatch(const float *x, float *out, size_t n);
+
+// Функция 4: Интеграл sin(x) на [A, B] по таблице накопленных интегралов (только lib4)
+// Таблица для шага e строится один раз на сетке x_k = k*e и хранится в mmap-файле
+// (./build/cache или SIN_TABLE_DIR); запрос - два чтения таблицы и поправки на краях, O(1)
+LIB_API float sinIntegralTable(float A, float B, float e);
+
+
+/*
+Описание реализации, которое каждая библиотека экспортирует под именем LIB_DESCRIPTOR_SYMBOL.
+program2 читает его прямо из ELF-файла при сканировании каталога (не загружая библиотеку
+и не выполняя её код): проверяет версию ABI и требуемые возможности процессора и выбирает
+совместимый вариант с наибольшим priority
+*/
+#define LIB_ABI_VERSION 1
+#define LIB_DESCRIPTOR_SYMBOL "lib_info"
+
+// возможности процессора, без которых библиотека не работает (битовая маска)
+#define LIB_CPU_SSE42  0x1
+#define LIB_CPU_AVX2   0x2
+#define LIB_CPU_AVX512 0x4
+
+typedef struct {
+    int abi_version;                // LIB_ABI_VERSION, с которой собрана библиотека
+    const char *name;               // имя для ручного выбора ("lib1", "lib3_avx2", ...)
+    const char *integral_method;    // название метода sinIntegral
+    const char *gcf_method;         // название алгоритма GCF
+    unsigned int cpu_features;      // LIB_CPU_*
+    int priority;                   // больше - быстрее; выбирается лучший совместимый вариант
+} lib_descriptor;
+
+LIB_API extern const lib_descriptor lib_info;
 
 #endif
\ No newline at end of file
@@ -0,0 +1,303 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "batch_mode.h"
+
+/*
+Пакетный режим: вход не терминал (файл, pipe), поэтому приглашения не печатаются
+и stdout не сбрасывается после каждой команды.
+    1. вход читается блоками по BATCH_BLOCK_SIZE через read(), строки разбираются на месте
+       (strtof/strtol вместо sscanf, без копирования)
+    2. команды 1 и 2 копятся в массиве jobs и считаются кусками в нескольких потоках;
+       каждый поток форматирует результаты своего куска в свой буфер
+    3. буферы выводятся по порядку кусков - порядок вывода совпадает с порядком ввода
+    4. остальные команды (переключение библиотеки и т.п.) - точка синхронизации: всё
+       накопленное досчитывается и выводится, затем строка возвращается вызывающему
+*/
+
+typedef enum {
+    JOB_INTEGRAL,
+    JOB_GCF,
+    JOB_BAD_INTEGRAL,
+    JOB_BAD_GCF
+} job_type;
+
+struct batch_job {
+    job_type type;
+    union {
+        struct { float a, b, e; } integral;
+        struct { int a, b; } gcf;
+    } args;
+};
+
+struct batch_output {
+    char *data;
+    size_t length;
+    size_t capacity;
+};
+
+typedef struct {
+    const batch_job *jobs;
+    size_t count;
+    const batch_functions *functions;
+    batch_output *output;
+} chunk_task;
+
+// максимальная длина одной строки результата/ошибки
+#define MAX_RESULT_LINE 160
+
+
+int batch_requested(void) {
+    return !isatty(STDIN_FILENO);
+}
+
+/*
+Вывод не в терминал - stdout с буфером BATCH_BLOCK_SIZE: результаты и сообщения управляющих
+команд уходят большими кусками. setvbuf() допустим только до первого вывода в поток,
+поэтому вызывается первым делом в main(), раньше "Switched to ..." и калибровки
+*/
+void batch_buffer_stdout(void) {
+    if (!isatty(STDOUT_FILENO)) {
+        setvbuf(stdout, NULL, _IOFBF, BATCH_BLOCK_SIZE);
+    }
+}
+
+static void *checked_realloc(void *ptr, size_t size) {
+    void *result = realloc(ptr, size);
+    if (result == NULL) {
+        perror("realloc");
+        exit(1);
+    }
+    return result;
+}
+
+void batch_open(batch_reader *reader, int fd) {
+    memset(reader, 0, sizeof(*reader));
+    reader->fd = fd;
+    reader->capacity = BATCH_BLOCK_SIZE;
+    reader->buffer = checked_realloc(NULL, reader->capacity + 1);
+    reader->jobs = checked_realloc(NULL, BATCH_MAX_JOBS * sizeof(batch_job));
+
+    const char *threads = getenv("BATCH_THREADS");
+    long count = threads ? atol(threads) : sysconf(_SC_NPROCESSORS_ONLN);
+    reader->threads = (count < 1) ? 1 : (count > BATCH_MAX_THREADS ? BATCH_MAX_THREADS : (int)count);
+    reader->outputs = calloc((size_t)reader->threads, sizeof(batch_output));
+    if (reader->outputs == NULL) {
+        perror("calloc");
+        exit(1);
+    }
+}
+
+void batch_close(batch_reader *reader) {
+    fflush(stdout);
+    for (int i = 0; i < reader->threads; i++) {
+        free(reader->outputs[i].data);
+    }
+    free(reader->outputs);
+    free(reader->jobs);
+    free(reader->buffer);
+    memset(reader, 0, sizeof(*reader));
+}
+
+static int parse_floats(const char *s, float *values, int count) {
+    for (int i = 0; i < count; i++) {
+        char *end;
+        values[i] = strtof(s, &end);
+        if (end == s) return 0;
+        s = end;
+    }
+    return 1;
+}
+
+static int parse_ints(const char *s, int *values, int count) {
+    for (int i = 0; i < count; i++) {
+        char *end;
+        values[i] = (int)strtol(s, &end, 10);
+        if (end == s) return 0;
+        s = end;
+    }
+    return 1;
+}
+
+static void parse_job(const char *line, batch_job *job) {
+    if (line[0] == '1') {
+        float v[3] = {0.0f, 0.0f, 0.0f};
+        job->type = parse_floats(line + 1, v, 3) ? JOB_INTEGRAL : JOB_BAD_INTEGRAL;
+        job->args.integral.a = v[0];
+        job->args.integral.b = v[1];
+        job->args.integral.e = v[2];
+    } else {
+        int v[2] = {0, 0};
+        job->type = parse_ints(line + 1, v, 2) ? JOB_GCF : JOB_BAD_GCF;
+        job->args.gcf.a = v[0];
+        job->args.gcf.b = v[1];
+    }
+}
+
+static void *run_chunk(void *arg) {
+    chunk_task *task = (chunk_task *)arg;
+    batch_output *out = task->output;
+    const batch_functions *f = task->functions;
+    out->length = 0;
+
+    for (size_t i = 0; i < task->count; i++) {
+        if (out->capacity - out->length < MAX_RESULT_LINE) {
+            out->capacity = out->capacity ? out->capacity * 2 : BATCH_BLOCK_SIZE / 16;
+            out->data = checked_realloc(out->data, out->capacity);
+        }
+
+        const batch_job *job = &task->jobs[i];
+        char *dst = out->data + out->length;
+        int written = 0;
+        switch (job->type) {
+        case JOB_INTEGRAL:
+            written = snprintf(dst, MAX_RESULT_LINE, "Result (%s method): %.6f\n", f->integral_method,
+                               f->sinIntegral(job->args.integral.a, job->args.integral.b, job->args.integral.e));
+            break;
+        case JOB_GCF:
+            written = snprintf(dst, MAX_RESULT_LINE, "Result (%s algorithm): %d\n", f->gcf_method,
+                               f->GCF(job->args.gcf.a, job->args.gcf.b));
+            break;
+        case JOB_BAD_INTEGRAL:
+            written = snprintf(dst, MAX_RESULT_LINE,
+                               "Error: Invalid arguments for command '1'\nUsage: 1 A B e\n");
+            break;
+        case JOB_BAD_GCF:
+            written = snprintf(dst, MAX_RESULT_LINE,
+                               "Error: Invalid arguments for command '2'\nUsage: 2 A B\n");
+            break;
+        }
+        out->length += (written < MAX_RESULT_LINE) ? (size_t)written : MAX_RESULT_LINE - 1;
+    }
+    return NULL;
+}
+
+// расчёт накопленных команд и вывод результатов в порядке ввода
+static void flush_jobs(batch_reader *reader, const batch_functions *functions) {
+    size_t count = reader->job_count;
+    if (count == 0) {
+        return;
+    }
+
+    int threads = (count < BATCH_PARALLEL_MIN_JOBS) ? 1 : reader->threads;
+    chunk_task tasks[BATCH_MAX_THREADS];
+    pthread_t tids[BATCH_MAX_THREADS];
+    size_t per_thread = (count + (size_t)threads - 1) / (size_t)threads;
+
+    for (int t = 0; t < threads; t++) {
+        size_t begin = (size_t)t * per_thread;
+        size_t end = (begin + per_thread < count) ? begin + per_thread : count;
+        tasks[t].jobs = reader->jobs + begin;
+        tasks[t].count = (begin < end) ? end - begin : 0;
+        tasks[t].functions = functions;
+        tasks[t].output = &reader->outputs[t];
+    }
+
+    // первый кусок считает сам вызывающий поток
+    for (int t = 1; t < threads; t++) {
+        if (pthread_create(&tids[t], NULL, run_chunk, &tasks[t]) != 0) {
+            perror("pthread_create");
+            exit(1);
+        }
+    }
+    run_chunk(&tasks[0]);
+    for (int t = 1; t < threads; t++) {
+        pthread_join(tids[t], NULL);
+    }
+
+    for (int t = 0; t < threads; t++) {
+        fwrite(reader->outputs[t].data, 1, reader->outputs[t].length, stdout);
+    }
+    reader->job_count = 0;
+}
+
+/*
+Дочитать вход: недоразобранный хвост переносится в начало буфера, дальше читается блок.
+Возвращает 0, если новых целых строк больше нет
+*/
+static int fill_buffer(batch_reader *reader) {
+    memmove(reader->buffer, reader->buffer + reader->pos, reader->length - reader->pos);
+    reader->length -= reader->pos;
+    reader->pos = 0;
+    reader->ready = 0;
+
+    while (!reader->eof) {
+        // строка длиннее буфера - буфер растёт
+        if (reader->length == reader->capacity) {
+            reader->capacity *= 2;
+            reader->buffer = checked_realloc(reader->buffer, reader->capacity + 1);
+        }
+
+        ssize_t n = read(reader->fd, reader->buffer + reader->length, reader->capacity - reader->length);
+        if (n < 0) {
+            perror("read");
+            reader->eof = 1;
+            break;
+        }
+        if (n == 0) {
+            reader->eof = 1;
+            break;
+        }
+        reader->length += (size_t)n;
+
+        char *last = memrchr(reader->buffer, '\n', reader->length);
+        if (last != NULL) {
+            reader->ready = (size_t)(last - reader->buffer) + 1;
+            return 1;
+        }
+    }
+
+    // последняя строка без '\n' (место под него зарезервировано: capacity + 1)
+    if (reader->length > 0) {
+        reader->buffer[reader->length++] = '\n';
+        reader->ready = reader->length;
+        return 1;
+    }
+    return 0;
+}
+
+/*
+Обработка входа до следующей управляющей команды. Возвращает её строку (действительна
+до следующего вызова) или NULL, если вход кончился или встретилась команда 3.
+Все команды до возвращённой строки к этому моменту посчитаны и выведены
+*/
+const char *batch_run(batch_reader *reader, const batch_functions *functions) {
+    while (!reader->finished) {
+        if (reader->pos >= reader->ready && !fill_buffer(reader)) {
+            reader->finished = 1;
+            break;
+        }
+
+        while (reader->pos < reader->ready) {
+            char *line = reader->buffer + reader->pos;
+            char *newline = memchr(line, '\n', reader->ready - reader->pos);
+            *newline = '\0';
+            if (newline > line && newline[-1] == '\r') {
+                newline[-1] = '\0';
+            }
+            reader->pos = (size_t)(newline - reader->buffer) + 1;
+
+            if (line[0] == '1' || line[0] == '2') {
+                parse_job(line, &reader->jobs[reader->job_count++]);
+                if (reader->job_count == BATCH_MAX_JOBS) {
+                    flush_jobs(reader, functions);
+                }
+            } else if (strcmp(line, "3") == 0) {
+                // та же строка, что в интерактивном режиме, - после всех результатов до неё
+                flush_jobs(reader, functions);
+                fputs("Exiting...\n", stdout);
+                reader->finished = 1;
+                break;
+            } else {
+                flush_jobs(reader, functions);
+                return line;
+            }
+        }
+    }
+
+    flush_jobs(reader, functions);
+    fflush(stdout);
+    return NULL;
+}
@@ -0,0 +1,53 @@
+#ifndef BATCH_MODE_H
+#define BATCH_MODE_H
+
+#include <stddef.h>
+
+// начальный размер блока чтения входа и буфера stdout
+#define BATCH_BLOCK_SIZE (1 << 20)
+// сколько разобранных команд копится перед параллельным расчётом
+#define BATCH_MAX_JOBS 65536
+// меньше - считается в вызывающем потоке, без создания потоков
+#define BATCH_PARALLEL_MIN_JOBS 256
+#define BATCH_MAX_THREADS 64
+
+/*
+Функции, через которые пакетный режим считает команды 1 и 2, и подписи для вывода
+(такие же строки "Result (...)", как в интерактивном режиме)
+*/
+typedef struct {
+    float (*sinIntegral)(float, float, float);
+    int (*GCF)(int, int);
+    const char *integral_method;
+    const char *gcf_method;
+} batch_functions;
+
+typedef struct batch_job batch_job;
+typedef struct batch_output batch_output;
+
+/*
+Состояние пакетного чтения: вход читается блоками в buffer, строки [pos, ready) - целые,
+хвост [ready, length) - начало строки, которая дочитается со следующим блоком
+*/
+typedef struct {
+    int fd;
+    char *buffer;
+    size_t capacity;
+    size_t length;
+    size_t pos;
+    size_t ready;
+    int eof;
+    int finished;                   // встретилась команда 3 или кончился вход
+    int threads;
+    batch_job *jobs;                // разобранные, но ещё не посчитанные команды
+    size_t job_count;
+    batch_output *outputs;          // по буферу вывода на поток
+} batch_reader;
+
+int batch_requested(void);
+void batch_buffer_stdout(void);
+void batch_open(batch_reader *reader, int fd);
+const char *batch_run(batch_reader *reader, const batch_functions *functions);
+void batch_close(batch_reader *reader);
+
+#endif
@@ -0,0 +1,246 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <signal.h>
+#include <time.h>
+#include <dlfcn.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+
+/*
+Микробенчмарк GCF_many: все библиотеки на одних и тех же наборах пар.
+Наборы:
+    - random    - равномерно распределённые числа в [1, INT_MAX]
+    - fibonacci - соседние числа Фибоначчи F(k), F(k+1): худший случай для Евклида
+                  (максимум делений для чисел такого размера)
+    - coprime   - случайные взаимно простые пары: наивный перебор доходит до 1
+Каждый прогон идёт в отдельном процессе с бюджетом времени: наивный перебор lib2 на больших
+взаимно простых числах считает одну пару секундами, поэтому по истечении бюджета потомок
+убивается, а в таблицу попадает то, что он успел посчитать
+*/
+
+#define PAIRS 16384
+#define FIB_MIN 30
+#define FIB_MAX 45              // F(46) = 1836311903 - последнее, что влезает в int
+#define DEFAULT_BUDGET 1.0      // секунд на библиотеку и набор
+#define POLL_INTERVAL_NS 10000000L
+
+typedef void (*gcf_many_func)(const int *, const int *, int *, size_t);
+
+typedef struct {
+    const char *name;
+    int a[PAIRS];
+    int b[PAIRS];
+    int expected[PAIRS];
+} dataset;
+
+// статистика потомка: лежит в MAP_SHARED памяти, поэтому видна родителю и после kill
+typedef struct {
+    uint64_t ops;           // сколько пар посчитано
+    uint64_t ns;            // за сколько наносекунд
+    uint64_t mismatches;    // расхождений с эталоном
+} run_stats;
+
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+// xorshift32: воспроизводимые наборы без зависимости от rand() конкретной libc
+static uint32_t next_random(uint32_t *state) {
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return x;
+}
+
+static int random_positive(uint32_t *state) {
+    return (int)(next_random(state) % 0x7fffffffu) + 1;
+}
+
+// эталон - обычный Евклид, от проверяемых библиотек не зависит
+static int reference_gcd(int a, int b) {
+    while (b != 0) {
+        int temp = b;
+        b = a % b;
+        a = temp;
+    }
+    return a;
+}
+
+static void fill_random(dataset *set, uint32_t *state) {
+    for (int i = 0; i < PAIRS; i++) {
+        set->a[i] = random_positive(state);
+        set->b[i] = random_positive(state);
+    }
+}
+
+static void fill_fibonacci(dataset *set, uint32_t *state) {
+    int fib[FIB_MAX + 2];
+    fib[0] = 0;
+    fib[1] = 1;
+    for (int k = 2; k <= FIB_MAX + 1; k++) {
+        fib[k] = fib[k - 1] + fib[k - 2];
+    }
+
+    for (int i = 0; i < PAIRS; i++) {
+        int k = FIB_MIN + (int)(next_random(state) % (FIB_MAX - FIB_MIN + 1));
+        set->a[i] = fib[k + 1];
+        set->b[i] = fib[k];
+    }
+}
+
+static void fill_coprime(dataset *set, uint32_t *state) {
+    for (int i = 0; i < PAIRS; i++) {
+        do {
+            set->a[i] = random_positive(state);
+            set->b[i] = random_positive(state);
+        } while (reference_gcd(set->a[i], set->b[i]) != 1);
+    }
+}
+
+/*
+Прогон в потомке: пакеты растут 1, 2, 4, ... (чтобы медленная библиотека успела отчитаться
+хоть о чём-то), по кругу по набору, пока не выйдет бюджет. Статистика обновляется после
+каждого пакета
+*/
+static void run_child(gcf_many_func gcf_many, const dataset *set, double budget, run_stats *stats) {
+    static int out[PAIRS];
+    uint64_t limit = (uint64_t)(budget * 1e9);
+    uint64_t start = now_ns();
+    size_t pos = 0;
+    size_t chunk = 1;
+
+    do {
+        size_t count = (chunk < PAIRS - pos) ? chunk : PAIRS - pos;
+        gcf_many(set->a + pos, set->b + pos, out + pos, count);
+
+        uint64_t bad = 0;
+        for (size_t i = pos; i < pos + count; i++) {
+            bad += (out[i] != set->expected[i]);
+        }
+
+        stats->mismatches += bad;
+        stats->ops += count;
+        __atomic_store_n(&stats->ns, now_ns() - start, __ATOMIC_RELEASE);
+
+        pos = (pos + count) % PAIRS;
+        if (chunk < PAIRS) {
+            chunk *= 2;
+        }
+    } while (now_ns() - start < limit);
+
+    _exit(0);
+}
+
+// возвращает 1, если потомка пришлось убить по таймауту
+static int run_one(gcf_many_func gcf_many, const dataset *set, double budget, run_stats *stats) {
+    stats->ops = 0;
+    stats->ns = 0;
+    stats->mismatches = 0;
+
+    pid_t pid = fork();
+    if (pid == -1) {
+        perror("fork");
+        exit(EXIT_FAILURE);
+    }
+    if (pid == 0) {
+        run_child(gcf_many, set, budget, stats);
+    }
+
+    // потомок сам проверяет бюджет только между пакетами - даём ему запас, потом убиваем
+    uint64_t deadline = now_ns() + (uint64_t)(budget * 1e9) + 500000000ull;
+    struct timespec pause = {0, POLL_INTERVAL_NS};
+    int killed = 0;
+
+    while (waitpid(pid, NULL, WNOHANG) == 0) {
+        if (now_ns() > deadline) {
+            kill(pid, SIGKILL);
+            waitpid(pid, NULL, 0);
+            killed = 1;
+            break;
+        }
+        nanosleep(&pause, NULL);
+    }
+    return killed;
+}
+
+int main(int argc, char *argv[]) {
+    const char *lib_names[] = {"./build/lib/lib1.so",
+                               "./build/lib/lib2.so",
+                               "./build/lib/lib3.so"};
+    const int lib_count = sizeof(lib_names) / sizeof(lib_names[0]);
+
+    double budget = (argc > 1) ? atof(argv[1]) : DEFAULT_BUDGET;
+    if (budget <= 0.0) {
+        fprintf(stderr, "Usage: %s [seconds per run]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    static dataset sets[3];
+    uint32_t state = 0x9e3779b9u;
+    sets[0].name = "random";
+    fill_random(&sets[0], &state);
+    sets[1].name = "fibonacci";
+    fill_fibonacci(&sets[1], &state);
+    sets[2].name = "coprime";
+    fill_coprime(&sets[2], &state);
+    const int set_count = sizeof(sets) / sizeof(sets[0]);
+
+    for (int s = 0; s < set_count; s++) {
+        for (int i = 0; i < PAIRS; i++) {
+            sets[s].expected[i] = reference_gcd(sets[s].a[i], sets[s].b[i]);
+        }
+    }
+
+    run_stats *stats = mmap(NULL, sizeof(run_stats), PROT_READ | PROT_WRITE,
+                            MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (stats == MAP_FAILED) {
+        perror("mmap");
+        return EXIT_FAILURE;
+    }
+
+    printf("GCF_many benchmark: %d pairs per set, %.2f s per run\n", PAIRS, budget);
+    printf("%-6s %-10s %14s %12s %10s\n", "lib", "set", "ns/pair", "pairs", "status");
+
+    for (int l = 0; l < lib_count; l++) {
+        void *handle = dlopen(lib_names[l], RTLD_NOW);
+        if (handle == NULL) {
+            fprintf(stderr, "Warning: %s\n", dlerror());
+            continue;
+        }
+
+        gcf_many_func gcf_many = (gcf_many_func)dlsym(handle, "GCF_many");
+        if (gcf_many == NULL) {
+            fprintf(stderr, "Warning: %s has no GCF_many\n", lib_names[l]);
+            dlclose(handle);
+            continue;
+        }
+
+        for (int s = 0; s < set_count; s++) {
+            int killed = run_one(gcf_many, &sets[s], budget, stats);
+            uint64_t ns = __atomic_load_n(&stats->ns, __ATOMIC_ACQUIRE);
+            const char *status = (stats->mismatches != 0) ? "MISMATCH"
+                               : killed ? "timeout"
+                               : (stats->ops < PAIRS) ? "partial" : "ok";
+
+            if (stats->ops == 0) {
+                printf("lib%-3d %-10s %14s %12d %10s\n", l + 1, sets[s].name, "-", 0, status);
+            } else {
+                printf("lib%-3d %-10s %14.1f %12llu %10s\n", l + 1, sets[s].name,
+                       (double)ns / (double)stats->ops, (unsigned long long)stats->ops, status);
+            }
+            fflush(stdout);
+        }
+
+        dlclose(handle);
+    }
+
+    munmap(stats, sizeof(run_stats));
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,256 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ptrace.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+
+/*
+Замер запуска программ в разных вариантах сборки (make startup-variants).
+Для каждого варианта:
+    - время от fork/exec до первой строки "Result" в stdout (медиана и минимум по RUNS запускам)
+      и до завершения процесса
+    - число системных вызовов до первого write в stdout и всего за запуск: один запуск под
+      ptrace (PTRACE_SYSCALL + PTRACE_GET_SYSCALL_INFO), считаются только входы в вызов
+На вход программе подаётся одна короткая команда - почти всё время уходит на загрузчик,
+разрешение символов и инициализацию, а не на расчёт.
+Аргументы: RUNS label:program[:plugin_dir] ... (plugin_dir уходит в PLUGIN_DIR для program2)
+*/
+
+#define DEFAULT_RUNS 200
+#define MAX_VARIANTS 16
+#define PROGRAM_INPUT "2 48 18\n3\n"
+#define RESULT_MARK "Result"
+
+typedef struct {
+    char *label;
+    char *program;
+    char *plugin_dir;               // NULL - PLUGIN_DIR не трогаем
+} variant;
+
+typedef struct {
+    uint64_t first_result_ns;
+    uint64_t exit_ns;
+} run_times;
+
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static int compare_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a;
+    uint64_t y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+// потомок: stdin/stdout - концы каналов, stderr в /dev/null (предупреждения не мешают замеру)
+static void exec_variant(const variant *v, int in_fd, int out_fd, int traced) {
+    dup2(in_fd, STDIN_FILENO);
+    dup2(out_fd, STDOUT_FILENO);
+    if (freopen("/dev/null", "w", stderr) == NULL) {
+        _exit(127);
+    }
+    if (v->plugin_dir != NULL) {
+        setenv("PLUGIN_DIR", v->plugin_dir, 1);
+    }
+    if (traced && ptrace(PTRACE_TRACEME, 0, NULL, NULL) == -1) {
+        _exit(127);
+    }
+    char *argv[] = {v->program, NULL};
+    execv(v->program, argv);
+    _exit(127);
+}
+
+/*
+Запуск программы с каналами на stdin и stdout. Вход пишется сразу целиком (он меньше
+буфера канала), поэтому запись не блокируется
+*/
+static pid_t spawn(const variant *v, int traced, int *out_fd) {
+    int in_pipe[2], out_pipe[2];
+    if (pipe(in_pipe) == -1 || pipe(out_pipe) == -1) {
+        perror("pipe");
+        exit(1);
+    }
+
+    pid_t pid = fork();
+    if (pid == -1) {
+        perror("fork");
+        exit(1);
+    }
+    if (pid == 0) {
+        close(in_pipe[1]);
+        close(out_pipe[0]);
+        exec_variant(v, in_pipe[0], out_pipe[1], traced);
+    }
+
+    close(in_pipe[0]);
+    close(out_pipe[1]);
+    if (write(in_pipe[1], PROGRAM_INPUT, strlen(PROGRAM_INPUT)) != (ssize_t)strlen(PROGRAM_INPUT)) {
+        perror("write");
+    }
+    close(in_pipe[1]);
+    *out_fd = out_pipe[0];
+    return pid;
+}
+
+// один запуск без трассировки; 0 - программа не выдала результат
+static int timed_run(const variant *v, run_times *times) {
+    uint64_t start = now_ns();
+    int out_fd;
+    pid_t pid = spawn(v, 0, &out_fd);
+
+    char buffer[4096];
+    size_t length = 0;
+    times->first_result_ns = 0;
+    ssize_t n;
+    while ((n = read(out_fd, buffer + length, sizeof(buffer) - 1 - length)) > 0) {
+        length += (size_t)n;
+        buffer[length] = '\0';
+        if (times->first_result_ns == 0 && strstr(buffer, RESULT_MARK) != NULL) {
+            times->first_result_ns = now_ns() - start;
+        }
+        if (length == sizeof(buffer) - 1) {
+            length = 0;
+        }
+    }
+    close(out_fd);
+
+    int status;
+    waitpid(pid, &status, 0);
+    times->exit_ns = now_ns() - start;
+    return times->first_result_ns != 0 && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+/*
+Подсчёт системных вызовов: потомок останавливается на exec, дальше каждая остановка
+PTRACE_SYSCALL - вход или выход из вызова; GET_SYSCALL_INFO отличает вход от выхода.
+Потоки, если программа их создаст, не трассируются - считается главный поток
+*/
+static int count_syscalls(const variant *v, long *before_result, long *total) {
+    int out_fd;
+    pid_t pid = spawn(v, 1, &out_fd);
+    int status;
+
+    *before_result = -1;
+    *total = 0;
+    if (waitpid(pid, &status, 0) == -1 || !WIFSTOPPED(status)) {
+        close(out_fd);
+        return 0;
+    }
+    ptrace(PTRACE_SETOPTIONS, pid, NULL, (void *)(PTRACE_O_TRACESYSGOOD | PTRACE_O_EXITKILL));
+
+    int signal_to_deliver = 0;
+    while (ptrace(PTRACE_SYSCALL, pid, NULL, (void *)(intptr_t)signal_to_deliver) == 0) {
+        signal_to_deliver = 0;
+        if (waitpid(pid, &status, 0) == -1 || WIFEXITED(status) || WIFSIGNALED(status)) {
+            break;
+        }
+        if (WSTOPSIG(status) != (SIGTRAP | 0x80)) {
+            signal_to_deliver = WSTOPSIG(status);
+            continue;
+        }
+
+        struct __ptrace_syscall_info info;
+        if (ptrace(PTRACE_GET_SYSCALL_INFO, pid, (void *)sizeof(info), &info) <= 0 ||
+            info.op != PTRACE_SYSCALL_INFO_ENTRY) {
+            continue;
+        }
+        if (*before_result < 0 && info.entry.nr == SYS_write && info.entry.args[0] == STDOUT_FILENO) {
+            *before_result = *total;
+        }
+        (*total)++;
+    }
+
+    // вывод не читался: канал вмещает весь вывод такой короткой сессии
+    close(out_fd);
+    waitpid(pid, &status, 0);
+    return 1;
+}
+
+static int parse_variant(char *spec, variant *v) {
+    v->label = spec;
+    v->program = strchr(spec, ':');
+    if (v->program == NULL) {
+        return 0;
+    }
+    *v->program++ = '\0';
+    v->plugin_dir = strchr(v->program, ':');
+    if (v->plugin_dir != NULL) {
+        *v->plugin_dir++ = '\0';
+    }
+    return 1;
+}
+
+static const char *base_name(const char *path) {
+    const char *slash = strrchr(path, '/');
+    return slash ? slash + 1 : path;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 3) {
+        fprintf(stderr, "Usage: %s RUNS label:program[:plugin_dir] ...\n", argv[0]);
+        return 1;
+    }
+    int runs = atoi(argv[1]);
+    if (runs <= 0) {
+        runs = DEFAULT_RUNS;
+    }
+
+    variant variants[MAX_VARIANTS];
+    int count = 0;
+    for (int i = 2; i < argc && count < MAX_VARIANTS; i++) {
+        if (!parse_variant(argv[i], &variants[count])) {
+            fprintf(stderr, "Bad variant '%s' (expected label:program[:plugin_dir])\n", argv[i]);
+            return 1;
+        }
+        count++;
+    }
+
+    uint64_t *first = malloc((size_t)runs * sizeof(uint64_t));
+    uint64_t *exit_times = malloc((size_t)runs * sizeof(uint64_t));
+    if (first == NULL || exit_times == NULL) {
+        perror("malloc");
+        return 1;
+    }
+
+    printf("Startup benchmark: %d runs per variant, input \"%s\"\n\n", runs, "2 48 18");
+    printf("%-10s %-10s %14s %14s %14s %16s %10s\n", "program", "variant", "result med,us",
+           "result min,us", "exit med,us", "syscalls<result", "syscalls");
+
+    for (int i = 0; i < count; i++) {
+        const variant *v = &variants[i];
+        int ok = 1;
+        for (int r = 0; r < runs && ok; r++) {
+            run_times times;
+            ok = timed_run(v, &times);
+            first[r] = times.first_result_ns;
+            exit_times[r] = times.exit_ns;
+        }
+        if (!ok) {
+            printf("%-10s %-10s failed (no result from %s)\n", base_name(v->program), v->label, v->program);
+            continue;
+        }
+        qsort(first, (size_t)runs, sizeof(uint64_t), compare_u64);
+        qsort(exit_times, (size_t)runs, sizeof(uint64_t), compare_u64);
+
+        long before_result, total;
+        if (!count_syscalls(v, &before_result, &total)) {
+            before_result = total = -1;
+        }
+
+        printf("%-10s %-10s %14.1f %14.1f %14.1f %16ld %10ld\n", base_name(v->program), v->label,
+               (double)first[runs / 2] / 1000.0, (double)first[0] / 1000.0,
+               (double)exit_times[runs / 2] / 1000.0, before_result, total);
+    }
+
+    free(first);
+    free(exit_times);
+    return 0;
+}
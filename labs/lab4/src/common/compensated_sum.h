@@ -0,0 +1,30 @@
+#ifndef COMPENSATED_SUM_H
+#define COMPENSATED_SUM_H
+
+#include <math.h>
+
+/*
+Суммирование Кэхэна-Неймайера в double: потерянные младшие разряды каждого сложения
+копятся в compensation и возвращаются в конце. При миллионах слагаемых ошибка
+не растёт с их количеством, в отличие от наивного накопления во float
+*/
+typedef struct {
+    double sum;
+    double compensation;
+} compensated_sum;
+
+static inline void compensated_add(compensated_sum *acc, double value) {
+    double t = acc->sum + value;
+    if (fabs(acc->sum) >= fabs(value)) {
+        acc->compensation += (acc->sum - t) + value;
+    } else {
+        acc->compensation += (value - t) + acc->sum;
+    }
+    acc->sum = t;
+}
+
+static inline double compensated_result(const compensated_sum *acc) {
+    return acc->sum + acc->compensation;
+}
+
+#endif
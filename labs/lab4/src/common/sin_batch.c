@@ -0,0 +1,189 @@
+#include <math.h>
+#include <stdint.h>
+#include "lib_contract.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define SIN_BATCH_X86 1
+#endif
+
+/*
+Полиномиальный sin(x) (по мотивам cephes sinf):
+    1. x сводится к отрезку [-pi/4, pi/4]: j = ближайшее чётное к x * 4/pi,
+       x - j * pi/4 вычисляется в три шага (DP1 + DP2 + DP3 = pi/4) без потери точности
+    2. в зависимости от октанта j считается полином sin или cos, знак берётся из j и знака x
+Одна и та же схема используется в скалярной, SSE2 и AVX2 версиях, поэтому результат не зависит
+от того, какая ветка выбрана. Погрешность ~1 ulp при |x| <= SIN_SIMD_MAX_ARG, для больших
+аргументов (где трёхшаговое сведение теряет точность) используется sinf()
+*/
+#define SIN_SIMD_MAX_ARG 8192.0f
+
+#define FOUR_OVER_PI 1.27323954473516f
+#define DP1 0.78515625f
+#define DP2 2.4187564849853515625e-4f
+#define DP3 3.77489497744594108e-8f
+
+#define SIN_P0 -1.9515295891e-4f
+#define SIN_P1  8.3321608736e-3f
+#define SIN_P2 -1.6666654611e-1f
+#define COS_P0  2.443315711809948e-5f
+#define COS_P1 -1.388731625493765e-3f
+#define COS_P2  4.166664568298827e-2f
+
+
+static float sin_scalar(float x) {
+    if (fabsf(x) > SIN_SIMD_MAX_ARG || x != x) {
+        return sinf(x);
+    }
+
+    float sign = (x < 0.0f) ? -1.0f : 1.0f;
+    x = fabsf(x);
+
+    int32_t j = (int32_t)(x * FOUR_OVER_PI);
+    j = (j + 1) & ~1;
+    float y = (float)j;
+    if (j & 4) {
+        sign = -sign;
+    }
+
+    x = ((x - y * DP1) - y * DP2) - y * DP3;
+    float z = x * x;
+
+    float result;
+    if (j & 2) {
+        result = ((COS_P0 * z + COS_P1) * z + COS_P2) * z * z - 0.5f * z + 1.0f;
+    } else {
+        result = ((SIN_P0 * z + SIN_P1) * z + SIN_P2) * z * x + x;
+    }
+    return sign * result;
+}
+
+static void sin_batch_scalar(const float *x, float *out, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        out[i] = sin_scalar(x[i]);
+    }
+}
+
+
+#ifdef SIN_BATCH_X86
+
+// 4 значения за раз: SSE2 есть на любом x86-64, поэтому это базовая векторная ветка
+static void sin_batch_sse2(const float *x, float *out, size_t n) {
+    const __m128 sign_mask = _mm_castsi128_ps(_mm_set1_epi32((int)0x80000000));
+    const __m128 max_arg = _mm_set1_ps(SIN_SIMD_MAX_ARG);
+    size_t i = 0;
+
+    for (; i + 4 <= n; i += 4) {
+        __m128 v = _mm_loadu_ps(x + i);
+        __m128 sign = _mm_and_ps(v, sign_mask);
+        v = _mm_andnot_ps(sign_mask, v);                // |x|
+
+        // большие аргументы и NaN - скалярно через sinf()
+        if (_mm_movemask_ps(_mm_cmpngt_ps(max_arg, v)) != 0) {
+            sin_batch_scalar(x + i, out + i, 4);
+            continue;
+        }
+
+        __m128i j = _mm_cvttps_epi32(_mm_mul_ps(v, _mm_set1_ps(FOUR_OVER_PI)));
+        j = _mm_and_si128(_mm_add_epi32(j, _mm_set1_epi32(1)), _mm_set1_epi32(~1));
+        __m128 y = _mm_cvtepi32_ps(j);
+
+        // бит 4 октанта меняет знак, бит 2 выбирает полином cos вместо sin
+        sign = _mm_xor_ps(sign, _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(j, _mm_set1_epi32(4)), 29)));
+        __m128 use_cos = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(j, _mm_set1_epi32(2)), _mm_set1_epi32(2)));
+
+        v = _mm_sub_ps(v, _mm_mul_ps(y, _mm_set1_ps(DP1)));
+        v = _mm_sub_ps(v, _mm_mul_ps(y, _mm_set1_ps(DP2)));
+        v = _mm_sub_ps(v, _mm_mul_ps(y, _mm_set1_ps(DP3)));
+        __m128 z = _mm_mul_ps(v, v);
+
+        __m128 c = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(COS_P0), z), _mm_set1_ps(COS_P1));
+        c = _mm_add_ps(_mm_mul_ps(c, z), _mm_set1_ps(COS_P2));
+        c = _mm_mul_ps(_mm_mul_ps(c, z), z);
+        c = _mm_sub_ps(c, _mm_mul_ps(_mm_set1_ps(0.5f), z));
+        c = _mm_add_ps(c, _mm_set1_ps(1.0f));
+
+        __m128 s = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(SIN_P0), z), _mm_set1_ps(SIN_P1));
+        s = _mm_add_ps(_mm_mul_ps(s, z), _mm_set1_ps(SIN_P2));
+        s = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(s, z), v), v);
+
+        __m128 r = _mm_or_ps(_mm_and_ps(use_cos, c), _mm_andnot_ps(use_cos, s));
+        _mm_storeu_ps(out + i, _mm_xor_ps(r, sign));
+    }
+
+    sin_batch_scalar(x + i, out + i, n - i);
+}
+
+// 8 значений за раз; функция компилируется под AVX2 независимо от флагов сборки библиотеки
+__attribute__((target("avx2")))
+static void sin_batch_avx2(const float *x, float *out, size_t n) {
+    const __m256 sign_mask = _mm256_castsi256_ps(_mm256_set1_epi32((int)0x80000000));
+    const __m256 max_arg = _mm256_set1_ps(SIN_SIMD_MAX_ARG);
+    size_t i = 0;
+
+    for (; i + 8 <= n; i += 8) {
+        __m256 v = _mm256_loadu_ps(x + i);
+        __m256 sign = _mm256_and_ps(v, sign_mask);
+        v = _mm256_andnot_ps(sign_mask, v);
+
+        if (_mm256_movemask_ps(_mm256_cmp_ps(v, max_arg, _CMP_NLE_UQ)) != 0) {
+            sin_batch_scalar(x + i, out + i, 8);
+            continue;
+        }
+
+        __m256i j = _mm256_cvttps_epi32(_mm256_mul_ps(v, _mm256_set1_ps(FOUR_OVER_PI)));
+        j = _mm256_and_si256(_mm256_add_epi32(j, _mm256_set1_epi32(1)), _mm256_set1_epi32(~1));
+        __m256 y = _mm256_cvtepi32_ps(j);
+
+        sign = _mm256_xor_ps(sign, _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_and_si256(j, _mm256_set1_epi32(4)), 29)));
+        __m256 use_cos = _mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_and_si256(j, _mm256_set1_epi32(2)), _mm256_set1_epi32(2)));
+
+        v = _mm256_sub_ps(v, _mm256_mul_ps(y, _mm256_set1_ps(DP1)));
+        v = _mm256_sub_ps(v, _mm256_mul_ps(y, _mm256_set1_ps(DP2)));
+        v = _mm256_sub_ps(v, _mm256_mul_ps(y, _mm256_set1_ps(DP3)));
+        __m256 z = _mm256_mul_ps(v, v);
+
+        __m256 c = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(COS_P0), z), _mm256_set1_ps(COS_P1));
+        c = _mm256_add_ps(_mm256_mul_ps(c, z), _mm256_set1_ps(COS_P2));
+        c = _mm256_mul_ps(_mm256_mul_ps(c, z), z);
+        c = _mm256_sub_ps(c, _mm256_mul_ps(_mm256_set1_ps(0.5f), z));
+        c = _mm256_add_ps(c, _mm256_set1_ps(1.0f));
+
+        __m256 s = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(SIN_P0), z), _mm256_set1_ps(SIN_P1));
+        s = _mm256_add_ps(_mm256_mul_ps(s, z), _mm256_set1_ps(SIN_P2));
+        s = _mm256_add_ps(_mm256_mul_ps(_mm256_mul_ps(s, z), v), v);
+
+        __m256 r = _mm256_blendv_ps(s, c, use_cos);
+        _mm256_storeu_ps(out + i, _mm256_xor_ps(r, sign));
+    }
+
+    sin_batch_sse2(x + i, out + i, n - i);
+}
+
+#endif
+
+
+typedef void (*sin_batch_impl)(const float *, float *, size_t);
+
+// выбор ветки по возможностям процессора делается один раз, при первом вызове
+static sin_batch_impl select_impl(void) {
+#ifdef SIN_BATCH_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return sin_batch_avx2;
+    }
+    return sin_batch_sse2;
+#else
+    return sin_batch_scalar;
+#endif
+}
+
+void sinBatch(const float *x, float *out, size_t n) {
+    static sin_batch_impl impl = NULL;
+    sin_batch_impl f = __atomic_load_n(&impl, __ATOMIC_RELAXED);
+    if (f == NULL) {
+        f = select_impl();
+        __atomic_store_n(&impl, f, __ATOMIC_RELAXED);
+    }
+    f(x, out, n);
+}
@@ -0,0 +1,10 @@
+#include "lib_contract.h"
+
+const lib_descriptor lib_info = {
+    .abi_version = LIB_ABI_VERSION,
+    .name = "lib1",
+    .integral_method = "Rectangles",
+    .gcf_method = "Euclidean",
+    .cpu_features = 0,
+    .priority = 10,
+};
@@ -1,5 +1,10 @@
 #include <math.h>
 #include <stdio.h>
+#include "lib_contract.h"
+#include "../common/compensated_sum.h"
+
+// сколько точек за раз передаётся в sinBatch (буфер на стеке, 2 КБ)
+#define SIN_BLOCK 256
 
 float sinIntegral(float A, float B, float e) {
     // Проверка корректности входных данных
@@ -7,17 +12,32 @@ float sinIntegral(float A, float B, float e) {
         fprintf(stderr, "Warning: Invalid input for sinIntegral: A=%.2f, B=%.2f, e=%.2f\n", A, B, e);
         return 0.0f;
     }
-    
-    float result = 0.0f;
-    float current = A;
-    
-    // Метод левых прямоугольников
-    while (current < B) {
-        float width = (current + e < B) ? e : (B - current);
-        float height = sinf(current);  // Значение функции на левой границе
-        result += height * width;
-        current += width;
+
+    /*
+    Метод левых прямоугольников.
+    Точки считаются по индексу (A + i*e), а не накоплением current += e, поэтому
+    ошибка округления не копится от шага к шагу; последний шаг может быть неполным
+    */
+    double span = (double)B - (double)A;
+    size_t steps = (size_t)ceil(span / e);
+    double last_width = span - (double)(steps - 1) * e;
+
+    compensated_sum acc = {0.0, 0.0};
+    float x[SIN_BLOCK];
+    float y[SIN_BLOCK];
+
+    for (size_t base = 0; base < steps; base += SIN_BLOCK) {
+        size_t count = (steps - base < SIN_BLOCK) ? steps - base : SIN_BLOCK;
+        for (size_t i = 0; i < count; i++) {
+            x[i] = (float)(A + (double)(base + i) * e);
+        }
+        sinBatch(x, y, count);
+
+        for (size_t i = 0; i < count; i++) {
+            double width = (base + i == steps - 1) ? last_width : e;
+            compensated_add(&acc, y[i] * width);   // высота - значение на левой границе
+        }
     }
-    
-    return result;
-}
\ No newline at end of file
+
+    return (float)compensated_result(&acc);
+}
@@ -0,0 +1,11 @@
+#include "lib_contract.h"
+
+// перебор делителей в GCF - самый медленный вариант, автоматически выбирается последним
+const lib_descriptor lib_info = {
+    .abi_version = LIB_ABI_VERSION,
+    .name = "lib2",
+    .integral_method = "Trapezoids",
+    .gcf_method = "Naive",
+    .cpu_features = 0,
+    .priority = 0,
+};
@@ -1,4 +1,5 @@
 #include <stdlib.h>  // для abs()
+#include "lib_contract.h"
 
 int GCF(int A, int B) {
     // Взятие модулей
@@ -21,4 +22,11 @@ int GCF(int A, int B) {
     
     // Если не нашли делителей больше 1, возвращаем 1
     return 1;
+}
+
+// пакетная версия: тот же алгоритм для каждой пары
+void GCF_many(const int *A, const int *B, int *out, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        out[i] = GCF(A[i], B[i]);
+    }
 }
\ No newline at end of file
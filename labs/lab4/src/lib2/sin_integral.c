@@ -1,5 +1,10 @@
 #include <math.h>
 #include <stdio.h>
+#include "lib_contract.h"
+#include "../common/compensated_sum.h"
+
+// сколько точек за раз передаётся в sinBatch (буфер на стеке, 2 КБ)
+#define SIN_BLOCK 256
 
 float sinIntegral(float A, float B, float e) {
     // Проверка корректности входных данных
@@ -7,20 +12,36 @@ float sinIntegral(float A, float B, float e) {
         fprintf(stderr, "Warning: Invalid input for sinIntegral: A=%.2f, B=%.2f, e=%.2f\n", A, B, e);
         return 0.0f;
     }
-    
-    float result = 0.0f;
-    float current = A;
-    
-    // Метод трапеций
-    while (current < B) {
-        float next = (current + e < B) ? (current + e) : B;
-        float height_left = sinf(current);
-        float height_right = sinf(next);
-        float average_height = (height_left + height_right) / 2.0f;
-        float width = next - current;
-        result += average_height * width;
-        current = next;
+
+    /*
+    Метод трапеций.
+    Узлы x_i = A + i*e (i = 0..steps-1) и B; внутренние узлы входят в сумму с весом e,
+    крайние - с весом половины прилегающего шага. Последний шаг может быть неполным
+    */
+    double span = (double)B - (double)A;
+    size_t steps = (size_t)ceil(span / e);
+    double last_width = span - (double)(steps - 1) * e;
+    size_t nodes = steps + 1;       // последний узел - ровно B
+
+    compensated_sum acc = {0.0, 0.0};
+    float x[SIN_BLOCK];
+    float y[SIN_BLOCK];
+
+    for (size_t base = 0; base < nodes; base += SIN_BLOCK) {
+        size_t count = (nodes - base < SIN_BLOCK) ? nodes - base : SIN_BLOCK;
+        for (size_t i = 0; i < count; i++) {
+            size_t k = base + i;
+            x[i] = (k == steps) ? B : (float)(A + (double)k * e);
+        }
+        sinBatch(x, y, count);
+
+        for (size_t i = 0; i < count; i++) {
+            size_t k = base + i;
+            double left = (k == 0) ? 0.0 : (k == steps ? last_width : e);      // шаг слева от узла
+            double right = (k == steps) ? 0.0 : (k == steps - 1 ? last_width : e);
+            compensated_add(&acc, y[i] * 0.5 * (left + right));
+        }
     }
-    
-    return result;
-}
\ No newline at end of file
+
+    return (float)compensated_result(&acc);
+}
@@ -0,0 +1,27 @@
+#include "lib_contract.h"
+
+/*
+Из одних и тех же исходников собираются два варианта lib3:
+    - lib3.so      - базовый x86-64, работает везде
+    - lib3_avx2.so - весь код (узлы, суммы, Стейн) скомпилирован с -mavx2 -mfma; program2 читает
+                     это описание, не вызывая функций библиотеки, и не выбирает её на процессоре без AVX2
+*/
+#ifdef LIB3_AVX2
+const lib_descriptor lib_info = {
+    .abi_version = LIB_ABI_VERSION,
+    .name = "lib3_avx2",
+    .integral_method = "Parallel quadrature (AVX2)",
+    .gcf_method = "Binary (Stein)",
+    .cpu_features = LIB_CPU_AVX2,
+    .priority = 30,
+};
+#else
+const lib_descriptor lib_info = {
+    .abi_version = LIB_ABI_VERSION,
+    .name = "lib3",
+    .integral_method = "Parallel quadrature",
+    .gcf_method = "Binary (Stein)",
+    .cpu_features = 0,
+    .priority = 20,
+};
+#endif
@@ -0,0 +1,408 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "lib_contract.h"
+#include "../common/compensated_sum.h"
+
+/*
+Вариант 3: многопоточное интегрирование с выбором квадратурной формулы.
+    - SIN_METHOD  = rect | trapezoid | simpson | gauss | exact  (по умолчанию gauss)
+    - SIN_THREADS = число потоков пула (по умолчанию - число ядер)
+Переменные окружения читаются один раз, при первом вызове - так вариант выбирается
+и при обычной линковке, и при загрузке через dlopen() в program2.
+
+Для rect/trapezoid e - шаг, как в lib1/lib2. Для simpson/gauss e задаёт требуемую точность:
+шаг подбирается так, чтобы оценка погрешности не превышала оценку для трапеций с шагом e
+(span * e^2 / 12, |sin''| <= 1) - это требует на порядки меньше вычислений sin.
+exact - замкнутая форма cos(A) - cos(B).
+*/
+
+#define MAX_THREADS 64
+#define MAX_UNIT_NODES 5            // узлов на одну элементарную часть (у Гаусса-Лежандра 5)
+#define SIN_BLOCK 256               // узлов за один вызов sinBatch
+#define PARALLEL_MIN_NODES (1 << 15)    // меньше - быстрее посчитать в вызывающем потоке
+
+typedef enum {
+    METHOD_RECT,
+    METHOD_TRAPEZOID,
+    METHOD_SIMPSON,
+    METHOD_GAUSS,
+    METHOD_EXACT
+} integration_method;
+
+/*
+Отрезок делится на units одинаковых частей шириной width (последняя может быть короче - last_width).
+Узлы каждой части вычисляются по её индексу, поэтому части независимы и делятся между потоками
+*/
+typedef struct {
+    integration_method method;
+    double a;
+    double b;
+    double width;
+    double last_width;
+    size_t units;
+} integration_task;
+
+// узлы и веса 5-точечной формулы Гаусса-Лежандра на [-1, 1]
+static const double gauss_nodes[5] = {
+    0.0, -0.5384693101056831, 0.5384693101056831, -0.9061798459386640, 0.9061798459386640
+};
+static const double gauss_weights[5] = {
+    0.5688888888888889, 0.4786286704993665, 0.4786286704993665, 0.2369268850561891, 0.2369268850561891
+};
+
+
+static struct {
+    integration_method method;
+    int threads;
+} config;
+
+static pthread_once_t config_once = PTHREAD_ONCE_INIT;
+
+static void read_config(void) {
+    const char *method = getenv("SIN_METHOD");
+    config.method = METHOD_GAUSS;
+    if (method) {
+        if (strcmp(method, "rect") == 0) config.method = METHOD_RECT;
+        else if (strcmp(method, "trapezoid") == 0) config.method = METHOD_TRAPEZOID;
+        else if (strcmp(method, "simpson") == 0) config.method = METHOD_SIMPSON;
+        else if (strcmp(method, "gauss") == 0) config.method = METHOD_GAUSS;
+        else if (strcmp(method, "exact") == 0) config.method = METHOD_EXACT;
+        else fprintf(stderr, "Warning: Unknown SIN_METHOD=%s, using gauss\n", method);
+    }
+
+    const char *threads = getenv("SIN_THREADS");
+    long count = threads ? atol(threads) : sysconf(_SC_NPROCESSORS_ONLN);
+    config.threads = (count < 1) ? 1 : (count > MAX_THREADS ? MAX_THREADS : (int)count);
+}
+
+
+// узлы и веса части с индексом unit для формул Симпсона и Гаусса; возвращает число узлов
+static int unit_nodes(const integration_task *task, size_t unit, double *x, double *w) {
+    double width = (unit == task->units - 1) ? task->last_width : task->width;
+    double left = task->a + (double)unit * task->width;
+
+    switch (task->method) {
+    case METHOD_SIMPSON:
+        x[0] = left;
+        x[1] = left + 0.5 * width;
+        x[2] = left + width;
+        w[0] = w[2] = width / 6.0;
+        w[1] = 4.0 * width / 6.0;
+        return 3;
+    case METHOD_GAUSS:
+        for (int k = 0; k < 5; k++) {
+            x[k] = left + 0.5 * width * (1.0 + gauss_nodes[k]);
+            w[k] = 0.5 * width * gauss_weights[k];
+        }
+        return 5;
+    default:
+        return 0;
+    }
+}
+
+/*
+sin периодичен, поэтому узел сводится к [-pi, pi] ещё в double и только потом округляется до float:
+иначе при |x| ~ 1000 шаг сетки float (~1e-4) сравним с размером частей формул высокого порядка
+*/
+static float reduce_node(double x) {
+    const double two_pi = 6.283185307179586;
+    const double inv_two_pi = 0.15915494309189535;
+    // округление через приведение к целому: nearbyint() без SSE4.1 - вызов libm на каждый узел
+    double turns = x * inv_two_pi;
+    long long k = (long long)(turns + (turns >= 0.0 ? 0.5 : -0.5));
+    return (float)(x - two_pi * (double)k);
+}
+
+/*
+Блок из SIN_BLOCK слагаемых складывается обычным double (ошибка ~SIN_BLOCK ulp),
+а компенсированно - уже суммы блоков: точность та же, а ветвлений на каждый узел нет.
+Четыре независимых накопителя убирают цепочку зависимостей между сложениями.
+weight == NULL - все веса равны 1
+*/
+static double block_sum(const float *x, float *y, const double *weight, int count) {
+    sinBatch(x, y, (size_t)count);
+    double s0 = 0.0, s1 = 0.0, s2 = 0.0, s3 = 0.0;
+    int i = 0;
+
+    if (weight == NULL) {
+        for (; i + 4 <= count; i += 4) {
+            s0 += y[i];
+            s1 += y[i + 1];
+            s2 += y[i + 2];
+            s3 += y[i + 3];
+        }
+        for (; i < count; i++) {
+            s0 += y[i];
+        }
+    } else {
+        for (; i + 4 <= count; i += 4) {
+            s0 += y[i] * weight[i];
+            s1 += y[i + 1] * weight[i + 1];
+            s2 += y[i + 2] * weight[i + 2];
+            s3 += y[i + 3] * weight[i + 3];
+        }
+        for (; i < count; i++) {
+            s0 += y[i] * weight[i];
+        }
+    }
+    return (s0 + s1) + (s2 + s3);
+}
+
+/*
+Вклад частей [begin, end): узлы собираются в блоки и считаются одним вызовом sinBatch.
+У rect/trapezoid на часть приходится ровно один узел (левый), поэтому для них узлы
+генерируются плотным циклом по индексу; формулы высокого порядка идут через unit_nodes()
+*/
+static double integrate_units(const integration_task *task, size_t begin, size_t end) {
+    compensated_sum acc = {0.0, 0.0};
+    float x[SIN_BLOCK];
+    float y[SIN_BLOCK];
+    double weight[SIN_BLOCK];
+
+    if (task->method == METHOD_RECT || task->method == METHOD_TRAPEZOID) {
+        double first = 0.0;         // sin в первом узле отрезка
+        double last = 0.0;          // sin в последнем левом узле отрезка
+
+        for (size_t base = begin; base < end; base += SIN_BLOCK) {
+            int count = (end - base < SIN_BLOCK) ? (int)(end - base) : SIN_BLOCK;
+            double offset = task->a + (double)base * task->width;
+            for (int i = 0; i < count; i++) {
+                x[i] = reduce_node(offset + (double)i * task->width);
+            }
+            compensated_add(&acc, block_sum(x, y, NULL, count) * task->width);
+
+            if (base == 0) first = y[0];
+            if (base + (size_t)count == task->units) last = y[count - 1];
+        }
+
+        // все узлы взяты с весом width - поправки для крайних узлов отрезка
+        if (end == task->units) {
+            double last_weight = (task->method == METHOD_RECT)
+                                 ? task->last_width
+                                 : 0.5 * (task->last_width + (task->units == 1 ? 0.0 : task->width));
+            compensated_add(&acc, last * (last_weight - task->width));
+        }
+        if (begin == 0 && task->method == METHOD_TRAPEZOID && task->units > 1) {
+            compensated_add(&acc, -0.5 * first * task->width);
+        }
+
+        // правый конец отрезка у трапеций - отдельный узел B
+        if (task->method == METHOD_TRAPEZOID && end == task->units) {
+            x[0] = reduce_node(task->b);
+            weight[0] = 0.5 * task->last_width;
+            compensated_add(&acc, block_sum(x, y, weight, 1));
+        }
+        return compensated_result(&acc);
+    }
+
+    int count = 0;
+    for (size_t unit = begin; unit < end; unit++) {
+        double ux[MAX_UNIT_NODES];
+        double uw[MAX_UNIT_NODES];
+        int nodes = unit_nodes(task, unit, ux, uw);
+
+        if (count + nodes > SIN_BLOCK) {
+            compensated_add(&acc, block_sum(x, y, weight, count));
+            count = 0;
+        }
+        for (int k = 0; k < nodes; k++) {
+            x[count] = reduce_node(ux[k]);
+            weight[count] = uw[k];
+            count++;
+        }
+    }
+
+    if (count > 0) {
+        compensated_add(&acc, block_sum(x, y, weight, count));
+    }
+    return compensated_result(&acc);
+}
+
+
+/*
+Пул потоков. Одновременно выполняется одно задание: отрезок частей делится на parts кусков,
+потоки (и вызывающий тоже) разбирают куски по номеру и пишут частичные суммы в partial[].
+Если пул занят другим вызовом, вызывающий считает всё сам - без ожидания
+*/
+static struct {
+    pthread_mutex_t lock;
+    pthread_cond_t work_cv;
+    pthread_cond_t done_cv;
+    pthread_mutex_t busy;           // захвачен на время одного задания
+    pthread_t threads[MAX_THREADS];
+    int thread_count;
+    int shutdown;
+    unsigned long generation;       // номер задания - по нему потоки видят новую работу
+
+    const integration_task *task;
+    int parts;
+    int next_part;
+    int done_parts;
+    double partial[MAX_THREADS];
+} pool = {
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+    .work_cv = PTHREAD_COND_INITIALIZER,
+    .done_cv = PTHREAD_COND_INITIALIZER,
+    .busy = PTHREAD_MUTEX_INITIALIZER,
+};
+
+static pthread_once_t pool_once = PTHREAD_ONCE_INIT;
+
+// вызывается под pool.lock; разбирает куски текущего задания, пока они не кончатся
+static void run_parts(void) {
+    while (pool.next_part < pool.parts) {
+        int part = pool.next_part++;
+        const integration_task *task = pool.task;
+        size_t begin = task->units * (size_t)part / (size_t)pool.parts;
+        size_t end = task->units * (size_t)(part + 1) / (size_t)pool.parts;
+
+        pthread_mutex_unlock(&pool.lock);
+        double value = integrate_units(task, begin, end);
+        pthread_mutex_lock(&pool.lock);
+
+        pool.partial[part] = value;
+        if (++pool.done_parts == pool.parts) {
+            pthread_cond_signal(&pool.done_cv);
+        }
+    }
+}
+
+static void *pool_worker(void *arg) {
+    (void)arg;
+    unsigned long seen = 0;
+
+    pthread_mutex_lock(&pool.lock);
+    while (1) {
+        while (!pool.shutdown && pool.generation == seen) {
+            pthread_cond_wait(&pool.work_cv, &pool.lock);
+        }
+        if (pool.shutdown) {
+            break;
+        }
+        seen = pool.generation;
+        run_parts();
+    }
+    pthread_mutex_unlock(&pool.lock);
+    return NULL;
+}
+
+static void pool_start(void) {
+    pthread_once(&config_once, read_config);
+    // вызывающий поток - тоже исполнитель, поэтому запускаем на один меньше
+    for (int i = 0; i < config.threads - 1; i++) {
+        if (pthread_create(&pool.threads[i], NULL, pool_worker, NULL) != 0) {
+            break;
+        }
+        pool.thread_count++;
+    }
+}
+
+/*
+Потоки пула выполняют код библиотеки, поэтому их нужно остановить до выгрузки:
+program2 делает dlclose() при переключении библиотек
+*/
+__attribute__((destructor))
+static void pool_stop(void) {
+    pthread_mutex_lock(&pool.lock);
+    pool.shutdown = 1;
+    pthread_cond_broadcast(&pool.work_cv);
+    pthread_mutex_unlock(&pool.lock);
+
+    for (int i = 0; i < pool.thread_count; i++) {
+        pthread_join(pool.threads[i], NULL);
+    }
+    pool.thread_count = 0;
+}
+
+static double integrate_parallel(const integration_task *task) {
+    pthread_once(&pool_once, pool_start);
+
+    if (pool.thread_count == 0 || task->units * MAX_UNIT_NODES < PARALLEL_MIN_NODES ||
+        pthread_mutex_trylock(&pool.busy) != 0) {
+        return integrate_units(task, 0, task->units);
+    }
+
+    pthread_mutex_lock(&pool.lock);
+    pool.task = task;
+    pool.parts = pool.thread_count + 1;
+    pool.next_part = 0;
+    pool.done_parts = 0;
+    pool.generation++;
+    pthread_cond_broadcast(&pool.work_cv);
+
+    run_parts();
+    while (pool.done_parts < pool.parts) {
+        pthread_cond_wait(&pool.done_cv, &pool.lock);
+    }
+
+    // частичные суммы складываются в фиксированном порядке - результат не зависит от расписания потоков
+    compensated_sum acc = {0.0, 0.0};
+    for (int i = 0; i < pool.parts; i++) {
+        compensated_add(&acc, pool.partial[i]);
+    }
+    pthread_mutex_unlock(&pool.lock);
+    pthread_mutex_unlock(&pool.busy);
+
+    return compensated_result(&acc);
+}
+
+
+/*
+Число частей для составных формул высокого порядка.
+Погрешности (|sin^(k)| <= 1):
+    трапеции с шагом e:            span * e^2 / 12         - эталон точности
+    Симпсон, часть ширины H:       span * H^4 / 2880
+    Гаусс-Лежандр, 5 узлов:        span * H^10 * (5!)^4 / (11 * (10!)^3)
+*/
+static size_t panel_count(integration_method method, double span, double e) {
+    double tolerance = span * e * e / 12.0;
+    double width;
+
+    if (method == METHOD_SIMPSON) {
+        width = pow(2880.0 * tolerance / span, 0.25);
+    } else {
+        double c = pow(120.0, 4) / (11.0 * pow(3628800.0, 3));
+        width = pow(tolerance / (span * c), 0.1);
+    }
+
+    double panels = ceil(span / width);
+    return (panels < 1.0) ? 1 : (size_t)panels;
+}
+
+float sinIntegral(float A, float B, float e) {
+    // Проверка корректности входных данных
+    if (B <= A || e <= 0.0f) {
+        fprintf(stderr, "Warning: Invalid input for sinIntegral: A=%.2f, B=%.2f, e=%.2f\n", A, B, e);
+        return 0.0f;
+    }
+
+    pthread_once(&config_once, read_config);
+
+    integration_task task;
+    task.method = config.method;
+    task.a = A;
+    task.b = B;
+    double span = (double)B - (double)A;
+
+    switch (config.method) {
+    case METHOD_EXACT:
+        return (float)(cos((double)A) - cos((double)B));
+    case METHOD_RECT:
+    case METHOD_TRAPEZOID:
+        task.units = (size_t)ceil(span / e);
+        task.width = e;
+        task.last_width = span - (double)(task.units - 1) * e;
+        break;
+    default:
+        task.units = panel_count(config.method, span, e);
+        task.width = span / (double)task.units;
+        task.last_width = span - (double)(task.units - 1) * task.width;
+        break;
+    }
+
+    return (float)integrate_parallel(&task);
+}
@@ -0,0 +1,11 @@
+#include "lib_contract.h"
+
+// первый запрос с новым шагом строит таблицу, поэтому по умолчанию выше неё lib3
+const lib_descriptor lib_info = {
+    .abi_version = LIB_ABI_VERSION,
+    .name = "lib4",
+    .integral_method = "Prefix-sum table",
+    .gcf_method = "Binary (Stein)",
+    .cpu_features = 0,
+    .priority = 15,
+};
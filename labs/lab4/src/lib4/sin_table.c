@@ -0,0 +1,475 @@
+#define _GNU_SOURCE
+#include <dirent.h>
+#include <dlfcn.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include "lib_contract.h"
+#include "../common/compensated_sum.h"
+
+/*
+Вариант 4: интегрирование по таблице накопленных интегралов.
+Для шага e строится сетка x_k = k*e (общая для всех запросов с этим шагом) и таблица
+    C_k = интеграл sin от x_first до x_k (трапеции по ячейкам сетки, сумма с компенсацией)
+    S_k = sin(x_k)
+Тогда для x из ячейки [x_k, x_k+1):  I(x) = C_k + (x - x_k) * (S_k + sin(x)) / 2
+(трапеция по неполной ячейке), а интеграл по [A, B] = I(B) - I(A): два чтения таблицы и два sin
+вместо (B - A) / e вычислений на каждый запрос.
+
+Таблица лежит в файле SIN_TABLE_DIR/sin_<биты e>.tbl (по умолчанию build/cache рядом с каталогом
+самой lib4.so, как build/lib у program2) и отображается через mmap - после перезапуска она
+не строится заново; пустой SIN_TABLE_DIR - таблицы только в памяти, без файлов. Если запрос выходит за покрытый отрезок, таблица перестраивается
+на объединение старого и нового отрезка (с запасом до TABLE_CHUNK узлов).
+Размер ограничен: одна таблица - MAX_TABLE_NODES узлов, все файлы каталога вместе -
+SIN_TABLE_CACHE_MB (перед записью новой давно не использованные удаляются); в памяти
+одновременно отображены TABLE_SLOTS таблиц разных шагов
+*/
+
+#define TABLE_MAGIC 0x544e4953u         // "SINT"
+#define TABLE_VERSION 1
+#define TABLE_CHUNK 65536               // покрытие таблицы округляется до стольких узлов
+#define MAX_TABLE_NODES (1L << 22)      // 4M узлов = 64 МБ; больше - считаем без таблицы
+#define TABLE_DIR_DEFAULT "./build/cache" // если не удалось узнать, откуда загружена библиотека
+#define TABLE_CACHE_MB_DEFAULT 256      // все файлы таблиц вместе (SIN_TABLE_CACHE_MB)
+#define TABLE_STALE_TMP_SEC 3600        // временный файл старше - остался от упавшего строителя
+#define TABLE_SLOTS 4                   // отображённых таблиц (разных шагов) в памяти
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    double step;
+    int64_t first;                      // индекс первого узла сетки
+    int64_t count;                      // число узлов
+} table_header;
+
+// за заголовком - count пар {C_k, S_k}
+typedef struct {
+    double integral;
+    double sine;
+} table_node;
+
+typedef struct {
+    table_header *header;               // NULL - слот пуст
+    size_t mapped_size;
+    uint64_t last_used;                 // для вытеснения из памяти (обновляется под rdlock - атомарно)
+} table_slot;
+
+static table_slot slots[TABLE_SLOTS];
+static uint64_t use_clock;
+
+static pthread_rwlock_t table_lock = PTHREAD_RWLOCK_INITIALIZER;
+
+
+static const table_node *table_nodes(const table_slot *slot) {
+    return (const table_node *)(slot->header + 1);
+}
+
+// слот, таблица которого покрывает узлы [k_from, k_to] шага e; NULL - такого нет
+static table_slot *table_find(float e, int64_t k_from, int64_t k_to) {
+    for (int i = 0; i < TABLE_SLOTS; i++) {
+        const table_header *h = slots[i].header;
+        if (h != NULL && h->step == (double)e && k_from >= h->first && k_to < h->first + h->count) {
+            return &slots[i];
+        }
+    }
+    return NULL;
+}
+
+// слот с таблицей шага e, иначе пустой, иначе давно не использованный
+static table_slot *table_slot_for(float e) {
+    table_slot *victim = &slots[0];
+    for (int i = 0; i < TABLE_SLOTS; i++) {
+        if (slots[i].header != NULL && slots[i].header->step == (double)e) {
+            return &slots[i];
+        }
+        if (victim->header != NULL &&
+            (slots[i].header == NULL || slots[i].last_used < victim->last_used)) {
+            victim = &slots[i];
+        }
+    }
+    return victim;
+}
+
+static void table_unmap(table_slot *slot) {
+    if (slot->header != NULL) {
+        munmap(slot->header, slot->mapped_size);
+        slot->header = NULL;
+        slot->mapped_size = 0;
+    }
+}
+
+static void table_install(table_slot *slot, table_header *header, size_t size) {
+    table_unmap(slot);
+    slot->header = header;
+    slot->mapped_size = size;
+    slot->last_used = __atomic_add_fetch(&use_clock, 1, __ATOMIC_RELAXED);
+}
+
+/*
+Каталог по умолчанию - build/cache рядом с build/lib, откуда загружена сама библиотека
+(а не относительно текущего каталога). Вызывается под блокировкой на запись
+*/
+static const char *table_dir(void) {
+    const char *dir = getenv("SIN_TABLE_DIR");
+    if (dir != NULL) {
+        return dir;
+    }
+    static char default_dir[PATH_MAX];
+    if (default_dir[0] != '\0') {
+        return default_dir;
+    }
+    Dl_info info;
+    char lib_path[PATH_MAX];
+    char *slash;
+    if (dladdr((void *)sinIntegralTable, &info) != 0 && info.dli_fname != NULL &&
+        realpath(info.dli_fname, lib_path) != NULL && (slash = strrchr(lib_path, '/')) != NULL) {
+        *slash = '\0';                 // .../build/lib
+        slash = strrchr(lib_path, '/');
+        if (slash != NULL && slash != lib_path) {
+            *slash = '\0';             // .../build
+        }
+        if (snprintf(default_dir, sizeof(default_dir), "%s/cache", lib_path) < (int)sizeof(default_dir)) {
+            return default_dir;
+        }
+    }
+    snprintf(default_dir, sizeof(default_dir), "%s", TABLE_DIR_DEFAULT);
+    return default_dir;
+}
+
+// SIN_TABLE_DIR="" - таблицы только в памяти (так их строит калибровка program2)
+static int table_in_memory(void) {
+    return table_dir()[0] == '\0';
+}
+
+static void table_path(float e, char *buf, size_t size) {
+    uint32_t bits;
+    memcpy(&bits, &e, sizeof(bits));
+    snprintf(buf, size, "%s/sin_%08x.tbl", table_dir(), bits);
+}
+
+// mkdir -p: SIN_TABLE_DIR может быть вложенным, а build/ - ещё не созданным
+static void make_dirs(const char *dir) {
+    char path[PATH_MAX];
+    snprintf(path, sizeof(path), "%s", dir);
+    for (char *p = path + 1; *p != '\0'; p++) {
+        if (*p == '/') {
+            *p = '\0';
+            mkdir(path, 0755);
+            *p = '/';
+        }
+    }
+    if (mkdir(path, 0755) == -1 && errno != EEXIST) {
+        perror(path);
+    }
+}
+
+typedef struct {
+    char name[256];
+    off_t size;
+    time_t mtime;
+} cache_file;
+
+static int compare_by_mtime(const void *a, const void *b) {
+    time_t ta = ((const cache_file *)a)->mtime;
+    time_t tb = ((const cache_file *)b)->mtime;
+    return (ta > tb) - (ta < tb);
+}
+
+/*
+Место под новую таблицу размера incoming: пока файлы таблиц вместе с ней больше
+SIN_TABLE_CACHE_MB, удаляются самые давно использованные (mtime обновляется при каждом
+открытии). Файл того же шага (keep) не считается - новая таблица его заменит.
+Удалять можно и файл, отображённый в другом процессе: его отображение остаётся целым
+*/
+static void cache_evict(const char *dir, size_t incoming, const char *keep) {
+    const char *limit = getenv("SIN_TABLE_CACHE_MB");
+    long limit_mb = limit ? atol(limit) : TABLE_CACHE_MB_DEFAULT;
+    if (limit_mb <= 0) {
+        limit_mb = TABLE_CACHE_MB_DEFAULT;
+    }
+    uint64_t cap = (uint64_t)limit_mb << 20;
+
+    DIR *d = opendir(dir);
+    if (d == NULL) {
+        return;
+    }
+    cache_file *files = NULL;
+    size_t count = 0, capacity = 0;
+    uint64_t total = 0;
+    time_t now = time(NULL);
+    char path[PATH_MAX];
+
+    struct dirent *entry;
+    while ((entry = readdir(d)) != NULL) {
+        const char *tbl = strstr(entry->d_name, ".tbl");
+        struct stat st;
+        if (strncmp(entry->d_name, "sin_", 4) != 0 || tbl == NULL ||
+            snprintf(path, sizeof(path), "%s/%s", dir, entry->d_name) >= (int)sizeof(path) ||
+            stat(path, &st) == -1) {
+            continue;
+        }
+        if (tbl[4] != '\0') {
+            // временный файл (sin_*.tbl.XXXXXX), давно брошенный строителем
+            if (now - st.st_mtime > TABLE_STALE_TMP_SEC) {
+                unlink(path);
+            }
+            continue;
+        }
+        if (strcmp(entry->d_name, keep) == 0) {
+            continue;
+        }
+        if (count == capacity) {
+            capacity = capacity ? capacity * 2 : 16;
+            cache_file *grown = realloc(files, capacity * sizeof(cache_file));
+            if (grown == NULL) {
+                break;
+            }
+            files = grown;
+        }
+        size_t name_len = strlen(entry->d_name);
+        if (name_len >= sizeof(files[count].name)) {
+            continue;
+        }
+        memcpy(files[count].name, entry->d_name, name_len + 1);
+        files[count].size = st.st_size;
+        files[count].mtime = st.st_mtime;
+        total += (uint64_t)st.st_size;
+        count++;
+    }
+    closedir(d);
+
+    qsort(files, count, sizeof(cache_file), compare_by_mtime);
+    for (size_t i = 0; i < count && total + incoming > cap; i++) {
+        if (snprintf(path, sizeof(path), "%s/%s", dir, files[i].name) < (int)sizeof(path) && unlink(path) == 0) {
+            total -= (uint64_t)files[i].size;
+        }
+    }
+    free(files);
+}
+
+/*
+Открыть готовую таблицу для шага e, если она покрывает узлы [k_from, k_to]
+(0 - файла нет, он не подходит или его покрытия не хватает; текущая таблица не меняется)
+*/
+static int table_open_file(float e, int64_t k_from, int64_t k_to) {
+    if (table_in_memory()) {
+        return 0;
+    }
+    char path[4096];
+    table_path(e, path, sizeof(path));
+
+    int fd = open(path, O_RDONLY);
+    if (fd == -1) {
+        return 0;
+    }
+
+    struct stat st;
+    table_header header;
+    if (fstat(fd, &st) == -1 || pread(fd, &header, sizeof(header), 0) != (ssize_t)sizeof(header) ||
+        header.magic != TABLE_MAGIC || header.version != TABLE_VERSION || header.step != (double)e ||
+        header.count <= 0 || k_from < header.first || k_to >= header.first + header.count ||
+        (size_t)st.st_size != sizeof(table_header) + (size_t)header.count * sizeof(table_node)) {
+        close(fd);
+        return 0;
+    }
+
+    void *mapped = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    // отметка использования для cache_evict (без прав на запись - просто не обновится)
+    futimens(fd, NULL);
+    close(fd);
+    if (mapped == MAP_FAILED) {
+        return 0;
+    }
+
+    table_install(table_slot_for(e), (table_header *)mapped, (size_t)st.st_size);
+    return 1;
+}
+
+/*
+Память под новую таблицу: временный файл рядом с итоговым (после заполнения переименовывается,
+так что другой процесс никогда не увидит недостроенную таблицу). Имя временного файла у каждого
+строителя своё (mkstemp): другой процесс, строящий ту же таблицу, не обрежет его через O_TRUNC
+посреди заполнения. Если файл создать нельзя - анонимная память: таблица работает,
+но не переживёт перезапуск
+*/
+static void *table_allocate(size_t size, int *fd, char *tmp_path, size_t path_size, float e) {
+    if (table_in_memory()) {
+        *fd = -1;
+        void *mapped = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        return (mapped == MAP_FAILED) ? NULL : mapped;
+    }
+    table_path(e, tmp_path, path_size);
+    char *slash = strrchr(tmp_path, '/');
+    if (slash != NULL) {
+        *slash = '\0';
+        make_dirs(tmp_path);
+        cache_evict(tmp_path, size, slash + 1);
+        *slash = '/';
+    }
+    strncat(tmp_path, ".XXXXXX", path_size - strlen(tmp_path) - 1);
+
+    *fd = mkstemp(tmp_path);
+    if (*fd != -1 && fchmod(*fd, 0644) == 0 && ftruncate(*fd, (off_t)size) == 0) {
+        void *mapped = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, *fd, 0);
+        if (mapped != MAP_FAILED) {
+            return mapped;
+        }
+    }
+
+    perror("Warning: sin table is not persistent");
+    if (*fd != -1) {
+        close(*fd);
+        unlink(tmp_path);
+        *fd = -1;
+    }
+    void *mapped = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    return (mapped == MAP_FAILED) ? NULL : mapped;
+}
+
+// построение таблицы для узлов [k_from, k_to]; 0 при ошибке
+static int table_build(float e, int64_t k_from, int64_t k_to) {
+    int64_t count = k_to - k_from + 1;
+    size_t size = sizeof(table_header) + (size_t)count * sizeof(table_node);
+
+    int fd;
+    char tmp_path[4096];
+    table_header *header = table_allocate(size, &fd, tmp_path, sizeof(tmp_path), e);
+    if (header == NULL) {
+        return 0;
+    }
+
+    table_node *nodes = (table_node *)(header + 1);
+    compensated_sum acc = {0.0, 0.0};
+    double step = (double)e;
+    double previous = sin((double)k_from * step);
+
+    nodes[0].integral = 0.0;
+    nodes[0].sine = previous;
+    for (int64_t i = 1; i < count; i++) {
+        double current = sin((double)(k_from + i) * step);
+        compensated_add(&acc, 0.5 * step * (previous + current));
+        nodes[i].integral = compensated_result(&acc);
+        nodes[i].sine = current;
+        previous = current;
+    }
+
+    header->magic = TABLE_MAGIC;
+    header->version = TABLE_VERSION;
+    header->step = step;
+    header->first = k_from;
+    header->count = count;
+
+    if (fd != -1) {
+        char path[4096];
+        table_path(e, path, sizeof(path));
+        if (fsync(fd) == -1 || rename(tmp_path, path) == -1) {
+            perror("Warning: sin table is not persistent");
+            unlink(tmp_path);
+        }
+        close(fd);
+    }
+
+    mprotect(header, size, PROT_READ);
+    table_install(table_slot_for(e), header, size);
+    return 1;
+}
+
+/*
+Подготовка таблицы под запрос (под блокировкой на запись): сначала файл с диска - его мог
+только что построить другой процесс, - если его покрытия не хватает - перестройка
+на объединение отрезков
+*/
+static table_slot *table_prepare(float e, int64_t k_from, int64_t k_to) {
+    table_slot *slot = table_find(e, k_from, k_to);
+    if (slot != NULL || (table_open_file(e, k_from, k_to) && (slot = table_find(e, k_from, k_to)) != NULL)) {
+        return slot;
+    }
+
+    const table_header *current = table_slot_for(e)->header;
+    if (current != NULL && current->step == (double)e) {
+        if (current->first < k_from) k_from = current->first;
+        if (current->first + current->count - 1 > k_to) k_to = current->first + current->count - 1;
+    }
+
+    // запас до границ блоков TABLE_CHUNK: соседние запросы попадут в ту же таблицу
+    k_from = (int64_t)floor((double)k_from / TABLE_CHUNK) * TABLE_CHUNK;
+    k_to = (int64_t)floor((double)k_to / TABLE_CHUNK) * TABLE_CHUNK + TABLE_CHUNK;
+    if (k_to - k_from + 1 > MAX_TABLE_NODES || !table_build(e, k_from, k_to)) {
+        return NULL;
+    }
+    return table_find(e, k_from, k_to);
+}
+
+// интеграл от x_first до x по таблице (x внутри покрытия)
+static double table_integral_at(const table_slot *slot, double x, double step, int64_t k) {
+    const table_node *node = &table_nodes(slot)[k - slot->header->first];
+    double partial = x - (double)k * step;
+    return node->integral + 0.5 * partial * (node->sine + sin(x));
+}
+
+// без таблицы (слишком большой отрезок): те же трапеции по сетке, посчитанные напрямую
+static double grid_integral(double a, double b, double step, int64_t k_a, int64_t k_b) {
+    compensated_sum acc = {0.0, 0.0};
+    double previous = sin((double)k_a * step);
+    for (int64_t k = k_a + 1; k <= k_b; k++) {
+        double current = sin((double)k * step);
+        compensated_add(&acc, 0.5 * step * (previous + current));
+        previous = current;
+    }
+    double start = (double)k_a * step;
+    double end = (double)k_b * step;
+    compensated_add(&acc, -0.5 * (a - start) * (sin(start) + sin(a)));
+    compensated_add(&acc, 0.5 * (b - end) * (sin(end) + sin(b)));
+    return compensated_result(&acc);
+}
+
+float sinIntegralTable(float A, float B, float e) {
+    if (B <= A || e <= 0.0f) {
+        fprintf(stderr, "Warning: Invalid input for sinIntegral: A=%.2f, B=%.2f, e=%.2f\n", A, B, e);
+        return 0.0f;
+    }
+
+    double step = (double)e;
+    int64_t k_a = (int64_t)floor((double)A / step);
+    int64_t k_b = (int64_t)floor((double)B / step);
+    double result;
+
+    pthread_rwlock_rdlock(&table_lock);
+    table_slot *slot = table_find(e, k_a, k_b);
+    if (slot == NULL) {
+        pthread_rwlock_unlock(&table_lock);
+        pthread_rwlock_wrlock(&table_lock);
+        slot = table_prepare(e, k_a, k_b);
+        if (slot == NULL) {
+            pthread_rwlock_unlock(&table_lock);
+            return (float)grid_integral(A, B, step, k_a, k_b);
+        }
+    }
+    __atomic_store_n(&slot->last_used, __atomic_add_fetch(&use_clock, 1, __ATOMIC_RELAXED), __ATOMIC_RELAXED);
+    result = table_integral_at(slot, B, step, k_b) - table_integral_at(slot, A, step, k_a);
+    pthread_rwlock_unlock(&table_lock);
+
+    return (float)result;
+}
+
+// общий контракт: в этой библиотеке обычный sinIntegral тоже отвечает по таблице
+float sinIntegral(float A, float B, float e) {
+    return sinIntegralTable(A, B, e);
+}
+
+__attribute__((destructor))
+static void table_close(void) {
+    for (int i = 0; i < TABLE_SLOTS; i++) {
+        table_unmap(&slots[i]);
+    }
+}
@@ -1,9 +1,38 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 #include "../../include/lib_contract.h"
+#include "../batch/batch_mode.h"
+
+// команды, кроме 1, 2 и 3 - общие для интерактивного и пакетного режима
+static void other_command(const char *command) {
+    if (strcmp(command, "0") == 0) {            // тут нельзя переключаться, для аналогичности интерфейса сделана
+        printf("Warning: Library switching is not supported in Program 1\n");
+        printf("This program is hard-linked to lib1.so\n");
+    } else {
+        printf("Unknown command. Available: 0, 1 A B e, 2 A B, 3\n");
+    }
+}
 
 int main() {
+    batch_buffer_stdout();
+    
+    // вход не терминал (файл, pipe) - пакетный режим: без приглашений и сброса вывода на каждой строке
+    if (batch_requested()) {
+        batch_functions functions = {sinIntegral, GCF, "Rectangles", "Euclidean"};
+        batch_reader reader;
+        batch_open(&reader, STDIN_FILENO);
+        
+        const char *line;
+        while ((line = batch_run(&reader, &functions)) != NULL) {
+            other_command(line);
+        }
+        
+        batch_close(&reader);
+        return 0;
+    }
+    
     printf("=== Program 1: Static Linking Demo ===\n");
     printf("This program is linked with lib1.so at compile time\n");
     printf("Commands:\n");
@@ -29,9 +58,6 @@ int main() {
         if (strcmp(command, "3") == 0) {            // выход
             printf("Exiting...\n");
             break;
-        } else if (strcmp(command, "0") == 0) {     // тут нельзя переключаться, для аналогичности интерфейса сделана
-            printf("Warning: Library switching is not supported in Program 1\n");
-            printf("This program is hard-linked to lib1.so\n");
         } else if (command[0] == '1') {             // интеграл
             float A, B, e;
             /*
@@ -55,7 +81,7 @@ int main() {
                 printf("Usage: 2 A B\n");
             }
         } else {
-            printf("Unknown command. Available: 0, 1 A B e, 2 A B, 3\n");
+            other_command(command);
         }
     }
     
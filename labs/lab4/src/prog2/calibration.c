@@ -0,0 +1,189 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <dlfcn.h>
+#include "calibration.h"
+
+/*
+Калибровка: каждая совместимая библиотека замеряется на одном и том же наборе типичных запросов,
+и для каждой функции отдельно выбирается самая быстрая. Набор повторяется, пока не наберётся
+CALIBRATION_MIN_NS, но не меньше одного раза - так медленный перебор lib2 не растягивает
+калибровку, а быстрые функции меряются на достаточном числе вызовов.
+Запросы sinIntegral в каждом проходе свои (шаг и сдвиг отрезка из SIN_VARIANTS вариантов):
+иначе lib4 отвечала бы из уже построенной таблицы и выигрывала бы за счёт повторов, а не метода.
+Время методов с разной точностью не сравнимо само по себе, поэтому рядом печатается ошибка
+*/
+#define CALIBRATION_MIN_NS 20000000ull    // 20 мс на функцию и библиотеку
+#define SIN_VARIANTS 64                   // разных шагов на запрос; больше, чем таблиц в памяти lib4
+
+// типичные запросы: короткий и длинный отрезок с мелким шагом, большие аргументы
+static const float sin_inputs[][3] = {
+    {0.0f, 3.14159f, 0.001f},
+    {-10.0f, 10.0f, 0.0005f},
+    {1000.0f, 1001.0f, 0.0001f},
+};
+
+// обычные пары, соседние числа Фибоначчи (худший случай Евклида), взаимно простые;
+// числа до ~1e5, чтобы перебор делителей укладывался в доли миллисекунды
+static const int gcf_inputs[][2] = {
+    {48, 18}, {1071, 462}, {46368, 75025}, {99991, 65536},
+    {12345, 54321}, {83160, 98280}, {17711, 28657}, {100000, 99999},
+};
+
+#define SIN_INPUT_COUNT (sizeof(sin_inputs) / sizeof(sin_inputs[0]))
+#define GCF_INPUT_COUNT (sizeof(gcf_inputs) / sizeof(gcf_inputs[0]))
+
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+// volatile-приёмник не даёт компилятору выбросить вызовы, результат которых не используется
+static volatile float sin_sink;
+static volatile int gcf_sink;
+
+// запрос i в проходе round: шаг больше исходного на round/512 (до 12%), отрезок сдвинут на round/8
+static void sin_input(size_t i, unsigned round, float *a, float *b, float *e) {
+    unsigned variant = round % SIN_VARIANTS;
+    *a = sin_inputs[i][0] + (float)variant * 0.125f;
+    *b = sin_inputs[i][1] + (float)variant * 0.125f;
+    *e = sin_inputs[i][2] * (1.0f + (float)variant / 512.0f);
+}
+
+static double time_sin(sin_integral_func f) {
+    // прогрев: ленивое связывание, запуск пула потоков lib3
+    sin_sink = f(sin_inputs[0][0], sin_inputs[0][1], sin_inputs[0][2]);
+
+    uint64_t calls = 0;
+    unsigned round = 1;                   // вариант 0 уже встречался при прогреве
+    uint64_t start = now_ns();
+    uint64_t elapsed;
+    do {
+        for (size_t i = 0; i < SIN_INPUT_COUNT; i++) {
+            float a, b, e;
+            sin_input(i, round, &a, &b, &e);
+            sin_sink = f(a, b, e);
+        }
+        calls += SIN_INPUT_COUNT;
+        round++;
+        elapsed = now_ns() - start;
+    } while (elapsed < CALIBRATION_MIN_NS);
+
+    return (double)elapsed / (double)calls;
+}
+
+// наибольшая абсолютная ошибка на исходном наборе против точного cos(A) - cos(B)
+static double sin_error(sin_integral_func f) {
+    double worst = 0.0;
+    for (size_t i = 0; i < SIN_INPUT_COUNT; i++) {
+        double a = sin_inputs[i][0];
+        double b = sin_inputs[i][1];
+        double error = fabs((double)f(sin_inputs[i][0], sin_inputs[i][1], sin_inputs[i][2]) - (cos(a) - cos(b)));
+        if (error > worst) {
+            worst = error;
+        }
+    }
+    return worst;
+}
+
+static double time_gcf(gcf_func f) {
+    gcf_sink = f(gcf_inputs[0][0], gcf_inputs[0][1]);
+
+    uint64_t calls = 0;
+    uint64_t start = now_ns();
+    uint64_t elapsed;
+    do {
+        for (size_t i = 0; i < GCF_INPUT_COUNT; i++) {
+            gcf_sink = f(gcf_inputs[i][0], gcf_inputs[i][1]);
+        }
+        calls += GCF_INPUT_COUNT;
+        elapsed = now_ns() - start;
+    } while (elapsed < CALIBRATION_MIN_NS);
+
+    return (double)elapsed / (double)calls;
+}
+
+/*
+Замер всех совместимых библиотек. Библиотеки открываются с RTLD_NOW (разрешение символов
+не попадает в замер) и закрываются после замера; уже привязанные программой функции
+не страдают - dlopen() той же библиотеки лишь увеличивает счётчик ссылок.
+На время замера SIN_TABLE_DIR="" - таблицы lib4 строятся только в памяти, калибровка
+не оставляет файлов в кэше.
+Возвращает число замеренных библиотек, в best_sin/best_gcf - индексы самых быстрых
+*/
+int calibrate(const plugin_registry *reg, calibration_result *results, int *best_sin, int *best_gcf) {
+    int measured = 0;
+    *best_sin = -1;
+    *best_gcf = -1;
+
+    const char *table_dir = getenv("SIN_TABLE_DIR");
+    char *saved_table_dir = table_dir ? strdup(table_dir) : NULL;
+    setenv("SIN_TABLE_DIR", "", 1);
+
+    for (size_t i = 0; i < reg->count; i++) {
+        results[i].sin_ns = -1.0;
+        results[i].sin_error = -1.0;
+        results[i].gcf_ns = -1.0;
+        if (!reg->items[i].compatible) {
+            continue;
+        }
+
+        void *handle = dlopen(reg->items[i].path, RTLD_NOW);
+        if (!handle) {
+            fprintf(stderr, "Warning: Cannot calibrate %s: %s\n", reg->items[i].name, dlerror());
+            continue;
+        }
+
+        sin_integral_func sin_f = (sin_integral_func)dlsym(handle, "sinIntegral");
+        gcf_func gcf_f = (gcf_func)dlsym(handle, "GCF");
+        if (sin_f == NULL || gcf_f == NULL) {
+            fprintf(stderr, "Warning: Cannot calibrate %s: missing symbols\n", reg->items[i].name);
+            dlclose(handle);
+            continue;
+        }
+
+        results[i].sin_ns = time_sin(sin_f);
+        results[i].sin_error = sin_error(sin_f);
+        results[i].gcf_ns = time_gcf(gcf_f);
+        dlclose(handle);
+        measured++;
+
+        if (*best_sin < 0 || results[i].sin_ns < results[*best_sin].sin_ns) {
+            *best_sin = (int)i;
+        }
+        if (*best_gcf < 0 || results[i].gcf_ns < results[*best_gcf].gcf_ns) {
+            *best_gcf = (int)i;
+        }
+    }
+
+    if (saved_table_dir != NULL) {
+        setenv("SIN_TABLE_DIR", saved_table_dir, 1);
+        free(saved_table_dir);
+    } else {
+        unsetenv("SIN_TABLE_DIR");
+    }
+    return measured;
+}
+
+void calibration_print(const plugin_registry *reg, const calibration_result *results,
+                       int best_sin, int best_gcf) {
+    printf("%-12s %16s %9s  %-28s %12s  %s\n", "library", "sinIntegral ns", "error", "method",
+           "GCF ns", "method");
+    for (size_t i = 0; i < reg->count; i++) {
+        const plugin_info *info = &reg->items[i];
+        if (results[i].sin_ns < 0.0) {
+            printf("%-12s %16s %9s  %-28s %12s  %s\n", info->name, "-", "-", info->integral_method,
+                   "-", info->gcf_method);
+            continue;
+        }
+        printf("%-12s %14.0f%s %9.1e  %-28s %10.1f%s  %s\n", info->name,
+               results[i].sin_ns, ((int)i == best_sin) ? " *" : "  ",
+               results[i].sin_error, info->integral_method,
+               results[i].gcf_ns, ((int)i == best_gcf) ? " *" : "  ", info->gcf_method);
+    }
+}
@@ -0,0 +1,17 @@
+#ifndef CALIBRATION_H
+#define CALIBRATION_H
+
+#include "plugin_registry.h"
+
+// результат замера одной библиотеки (ns на вызов; < 0 - не замерялась)
+typedef struct {
+    double sin_ns;
+    double sin_error;                   // наибольшая |ошибка| sinIntegral на типичных запросах
+    double gcf_ns;
+} calibration_result;
+
+int calibrate(const plugin_registry *reg, calibration_result *results, int *best_sin, int *best_gcf);
+void calibration_print(const plugin_registry *reg, const calibration_result *results,
+                       int best_sin, int best_gcf);
+
+#endif
@@ -0,0 +1,140 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <dlfcn.h>
+#include "function_table.h"
+
+#define GRACE_POLL_NS 100000L       // пауза писателя между проверками читателей
+
+
+static void *open_symbol(const plugin_info *info, const char *symbol, void **function) {
+    // RTLD_NOW: все перемещения разрешаются здесь, а не при первом вызове в рабочем потоке
+    void *handle = dlopen(info->path, RTLD_NOW);
+    if (!handle) {
+        fprintf(stderr, "Error loading library %s: %s\n", info->name, dlerror());
+        return NULL;
+    }
+
+    *function = dlsym(handle, symbol);
+    if (*function == NULL) {
+        fprintf(stderr, "Error loading symbols: %s\n", dlerror());
+        dlclose(handle);
+        return NULL;
+    }
+    return handle;
+}
+
+/*
+Подготовка новой таблицы целиком до публикации: загрузка с RTLD_NOW и прогрев - по вызову
+каждой функции (первые обращения к страницам кода, запуск пула потоков lib3, выбор
+SIMD-ветки sinBatch). Так первый запрос после замены не платит за загрузку
+*/
+function_table *table_load(const plugin_registry *reg, int sin_index, int gcf_index) {
+    const plugin_info *sin_info = &reg->items[sin_index];
+    const plugin_info *gcf_info = &reg->items[gcf_index];
+    if (!sin_info->compatible || !gcf_info->compatible) {
+        fprintf(stderr, "Error: %s needs CPU features this host does not have\n",
+                sin_info->compatible ? gcf_info->name : sin_info->name);
+        return NULL;
+    }
+
+    function_table *table = calloc(1, sizeof(function_table));
+    if (table == NULL) {
+        perror("calloc");
+        return NULL;
+    }
+
+    void *sin_f = NULL;
+    void *gcf_f = NULL;
+    table->sin_handle = open_symbol(sin_info, "sinIntegral", &sin_f);
+    table->gcf_handle = table->sin_handle ? open_symbol(gcf_info, "GCF", &gcf_f) : NULL;
+    if (table->gcf_handle == NULL) {
+        table_free(table);
+        return NULL;
+    }
+
+    table->sinIntegral = (sin_integral_func)sin_f;
+    table->GCF = (gcf_func)gcf_f;
+    table->sin_lib = sin_index;
+    table->gcf_lib = gcf_index;
+
+    volatile float sin_warm = table->sinIntegral(0.0f, 3.14159f, 0.01f);
+    volatile int gcf_warm = table->GCF(48, 18);
+    (void)sin_warm;
+    (void)gcf_warm;
+    return table;
+}
+
+void table_free(function_table *table) {
+    if (table == NULL) {
+        return;
+    }
+    if (table->sin_handle) dlclose(table->sin_handle);
+    if (table->gcf_handle) dlclose(table->gcf_handle);
+    free(table);
+}
+
+void domain_init(table_domain *domain, function_table *initial) {
+    memset(domain, 0, sizeof(*domain));
+    domain->current = initial;
+    pthread_mutex_init(&domain->writer_lock, NULL);
+}
+
+/*
+Захват таблицы читателем: объявить hazard-указатель и убедиться, что таблица всё ещё текущая.
+Если писатель успел её подменить между чтением и объявлением - повторить.
+seq_cst на записи hazard и повторном чтении гарантирует, что писатель, закончивший
+ожидание, не пропустит этого читателя. Дальше таблица не будет освобождена до table_release()
+*/
+const function_table *table_acquire(table_domain *domain, int reader) {
+    reader_slot *slot = &domain->readers[reader];
+    function_table *table;
+    do {
+        table = __atomic_load_n(&domain->current, __ATOMIC_SEQ_CST);
+        __atomic_store_n(&slot->hazard, table, __ATOMIC_SEQ_CST);
+    } while (table != __atomic_load_n(&domain->current, __ATOMIC_SEQ_CST));
+    return table;
+}
+
+void table_release(table_domain *domain, int reader) {
+    __atomic_store_n(&domain->readers[reader].hazard, NULL, __ATOMIC_RELEASE);
+}
+
+static int table_in_use(table_domain *domain, const function_table *table) {
+    for (int i = 0; i < MAX_READERS; i++) {
+        if (__atomic_load_n(&domain->readers[i].hazard, __ATOMIC_SEQ_CST) == table) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/*
+Публикация новой таблицы. Читатели переключаются на неё сразу (следующий table_acquire),
+ожидание "grace period" ложится только на вызывающий поток: старые дескрипторы закрываются,
+когда последний читатель отпустил старую таблицу. Возвращает длительность ожидания в нс
+*/
+long table_swap(table_domain *domain, function_table *next) {
+    pthread_mutex_lock(&domain->writer_lock);
+    function_table *old = __atomic_exchange_n(&domain->current, next, __ATOMIC_SEQ_CST);
+
+    struct timespec start, end;
+    struct timespec pause = {0, GRACE_POLL_NS};
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    while (table_in_use(domain, old)) {
+        nanosleep(&pause, NULL);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    table_free(old);
+    pthread_mutex_unlock(&domain->writer_lock);
+    return (end.tv_sec - start.tv_sec) * 1000000000L + (end.tv_nsec - start.tv_nsec);
+}
+
+// вызывается, когда читателей уже не осталось
+void domain_destroy(table_domain *domain) {
+    table_free(domain->current);
+    domain->current = NULL;
+    pthread_mutex_destroy(&domain->writer_lock);
+}
@@ -0,0 +1,50 @@
+#ifndef FUNCTION_TABLE_H
+#define FUNCTION_TABLE_H
+
+#include <pthread.h>
+#include "plugin_registry.h"
+
+// верхняя граница числа потоков-читателей (по слоту hazard-указателя на поток)
+#define MAX_READERS 64
+#define CACHE_LINE 64
+
+/*
+Таблица функций: указатели и дескрипторы, из которых они взяты.
+После публикации таблица не меняется - замена библиотеки = публикация новой таблицы
+*/
+typedef struct {
+    sin_integral_func sinIntegral;
+    gcf_func GCF;
+    void *sin_handle;
+    void *gcf_handle;
+    int sin_lib;                    // индексы в plugin_registry.items
+    int gcf_lib;
+} function_table;
+
+// слот читателя на отдельной кэш-линии: записи разных потоков не мешают друг другу
+typedef struct {
+    function_table *hazard;         // таблица, которой поток сейчас пользуется (NULL - никакой)
+    char pad[CACHE_LINE - sizeof(function_table *)];
+} reader_slot;
+
+/*
+RCU-подобная публикация: читатели берут текущую таблицу без блокировок (hazard pointer),
+писатель атомарно подменяет указатель и закрывает старые дескрипторы только после того,
+как ни один читатель на неё больше не ссылается
+*/
+typedef struct {
+    function_table *current;
+    reader_slot readers[MAX_READERS];
+    pthread_mutex_t writer_lock;    // замены идут по одной
+} table_domain;
+
+function_table *table_load(const plugin_registry *reg, int sin_index, int gcf_index);
+void table_free(function_table *table);
+
+void domain_init(table_domain *domain, function_table *initial);
+const function_table *table_acquire(table_domain *domain, int reader);
+void table_release(table_domain *domain, int reader);
+long table_swap(table_domain *domain, function_table *next);
+void domain_destroy(table_domain *domain);
+
+#endif
@@ -2,50 +2,115 @@
 #include <stdlib.h>
 #include <string.h>
 #include <dlfcn.h>
+#include <unistd.h>
+#include "plugin_registry.h"
+#include "calibration.h"
+#include "server_mode.h"
+#include "memo_cache.h"
+#include "../batch/batch_mode.h"
 
-// типы функций
-typedef float (*sin_integral_func)(float, float, float);
-typedef int (*gcf_func)(int, int);
-
-int main() {
-    void* lib_handle = NULL;
+int main(int argc, char *argv[]) {
+    batch_buffer_stdout();
+    
+    /*
+    Каждая функция привязана к своей библиотеке: после калибровки sinIntegral и GCF
+    могут браться из разных реализаций. dlopen() одной и той же библиотеки дважды
+    возвращает тот же дескриптор с увеличенным счётчиком ссылок, поэтому у каждой
+    функции свой дескриптор и выгружается библиотека, только когда не нужна ни одной
+    */
+    void* sin_handle = NULL;
+    void* gcf_handle = NULL;
     sin_integral_func sinIntegral = NULL;
     gcf_func GCF = NULL;
     
-    // по дефолту сначала грузится первая библиотека
-    int current_lib = 1;
-    const char* lib_names[] = {"./build/lib/lib1.so", 
-                               "./build/lib/lib2.so"};
-    
-    printf("=== Program 2: Dynamic Loading Demo ===\n");
-    printf("Commands:\n");
-    printf("  0        - Switch between lib1 and lib2\n");
-    printf("  1 A B e  - Compute integral of sin(x) from A to B with step e\n");
-    printf("  2 A B    - Compute GCD of A and B\n");
-    printf("  3        - Exit program\n");
-    printf("========================================\n");
-    
-    // загрузка библиотеки
-    void load_library(int lib_num) {
-        // если уже загружена библиотека - выгружаем
-        if (lib_handle != NULL) {
-            /*
-            dlclose() - уменьшает количество ссылок на библиотеку. Если счётчик равен 0, то библиотека выгружается из памяти
-            Принимает:
-                - handle - дескриптор обрабатываемой библиотеки
-            Возвращает:
-                - 0 при успехе
-                - число != 0, означающее ошибку
-            */
-            if (dlclose(lib_handle) != 0) {
-                const char* error_msg = dlerror();
-                if (error_msg) {
-                    fprintf(stderr, "Warning: Failed to unload library: %s\n", error_msg);
-                }
+    /*
+    Библиотеки не зашиты в программу: все *.so из каталога (PLUGIN_DIR, по умолчанию ./build/lib)
+    регистрируются по своему описанию lib_info. По умолчанию грузится совместимая с процессором
+    библиотека с наибольшим приоритетом, вручную - по имени: ./build/program2 lib2 или команда "0 lib2"
+    */
+    const char* plugin_dir = getenv("PLUGIN_DIR") ? getenv("PLUGIN_DIR") : PLUGIN_DIR_DEFAULT;
+    plugin_registry registry;
+    if (registry_scan(&registry, plugin_dir) <= 0) {
+        fprintf(stderr, "Error: No libraries found in %s\n", plugin_dir);
+        exit(1);
+    }
+    int sin_lib = -1;                   // индексы в registry.items
+    int gcf_lib = -1;
+    
+    // кэш результатов для повторяющихся запросов: MEMO_CACHE=<число записей>, 0 или не задан - выключен
+    memo_init(getenv("MEMO_CACHE") ? (size_t)atol(getenv("MEMO_CACHE")) : 0);
+    
+    /*
+    Режимы запуска:
+        - ./build/program2 NAME              - библиотека NAME целиком
+        - ./build/program2 --calibrate       - каждая функция из самой быстрой библиотеки
+        - ./build/program2 --server N [NAME] - N рабочих потоков под нагрузкой, замена библиотеки на лету
+        - без аргументов                     - лучшая для этого процессора по приоритету
+    */
+    int calibrate_at_start = (argc > 1 && strcmp(argv[1], "--calibrate") == 0);
+    int server_threads = (argc > 2 && strcmp(argv[1], "--server") == 0) ? atoi(argv[2]) : 0;
+    const char* lib_name = (argc > 1 && argv[1][0] != '-') ? argv[1] : NULL;
+    if (server_threads > 0 && argc > 3) {
+        lib_name = argv[3];
+    }
+    
+    int first_lib = lib_name ? registry_find(&registry, lib_name) : registry_best(&registry);
+    if (first_lib < 0) {
+        fprintf(stderr, "Error: No %s library in %s\n", lib_name ? lib_name : "compatible", plugin_dir);
+        registry_print(&registry, -1);
+        exit(1);
+    }
+    
+    if (server_threads > 0) {
+        int status = run_server(&registry, first_lib, server_threads);
+        registry_free(&registry);
+        return status;
+    }
+    
+    // вход не терминал (файл, pipe) - пакетный режим: без приглашений и сброса вывода на каждой строке
+    int batch = batch_requested();
+    
+    if (!batch) {
+        printf("=== Program 2: Dynamic Loading Demo ===\n");
+        printf("Commands:\n");
+        printf("  0        - Switch to the next compatible library\n");
+        printf("  0 NAME   - Switch to the library NAME (e.g. 0 lib2)\n");
+        printf("  1 A B e  - Compute integral of sin(x) from A to B with step e\n");
+        printf("  2 A B    - Compute GCD of A and B\n");
+        printf("  3        - Exit program\n");
+        printf("  4        - List available libraries\n");
+        printf("  calibrate - Time every library, bind each function to the fastest\n");
+        printf("  cache    - Memo cache statistics (enable with MEMO_CACHE=<entries>)\n");
+        printf("========================================\n");
+    }
+    
+    // выгрузка библиотеки, если на неё больше нет ссылок
+    void close_handle(void* handle) {
+        if (handle == NULL) {
+            return;
+        }
+        /*
+        dlclose() - уменьшает количество ссылок на библиотеку. Если счётчик равен 0, то библиотека выгружается из памяти
+        Принимает:
+            - handle - дескриптор обрабатываемой библиотеки
+        Возвращает:
+            - 0 при успехе
+            - число != 0, означающее ошибку
+        */
+        if (dlclose(handle) != 0) {
+            const char* error_msg = dlerror();
+            if (error_msg) {
+                fprintf(stderr, "Warning: Failed to unload library: %s\n", error_msg);
             }
-            lib_handle = NULL;
-            sinIntegral = NULL;
-            GCF = NULL;
+        }
+    }
+    
+    // открыть библиотеку и найти в ней функцию; NULL при ошибке
+    void* open_function(int index, const char* symbol, void** function) {
+        const plugin_info* info = &registry.items[index];
+        if (!info->compatible) {
+            printf("Error: %s needs CPU features this host does not have\n", info->name);
+            return NULL;
         }
         
         /*
@@ -61,21 +126,19 @@ int main() {
             - Файловый дескриптор в случае удачи
             - NULL в случае ошибки
         */
-        lib_handle = dlopen(lib_names[lib_num - 1], RTLD_LAZY);
-        if (!lib_handle) {
+        void* handle = dlopen(info->path, RTLD_LAZY);
+        if (!handle) {
             /*
             dlerror() - Возвращает строку с описанием последеней ошибки при вызове функций dl*
             Возвращает:
                 - char* - строка с описанием ошибки
                 - NULL если ошибок ещё не было или с последнего вызова dlerror новых не возникло
             */
-            fprintf(stderr, "Error loading library %d: %s\n", lib_num, dlerror());
-            exit(1);
+            fprintf(stderr, "Error loading library %s: %s\n", info->name, dlerror());
+            return NULL;
         }
         
-        // получить указатели на функции
         dlerror(); // сброс ошибок перед dlsym
-        sinIntegral = (sin_integral_func)dlsym(lib_handle, "sinIntegral");
         /*
         dlsym() - находит функцию или переменную в загруженной библиотеке и возвращает указатель на неё
         Принимает:
@@ -85,27 +148,134 @@ int main() {
             - void* - указатель на фукнцию или переменную при успехе
             - NULL - в случае ошибки или ненахода
         */
-        GCF = (gcf_func)dlsym(lib_handle, "GCF");
-        
-        // проверка, все ли функции определились
+        *function = dlsym(handle, symbol);
         const char* dlsym_error = dlerror();
-        if (dlsym_error) {
-            fprintf(stderr, "Error loading symbols: %s\n", dlsym_error);
-            dlclose(lib_handle);
-            exit(1);
+        if (dlsym_error || *function == NULL) {
+            fprintf(stderr, "Error loading symbols: %s\n", dlsym_error ? dlsym_error : symbol);
+            dlclose(handle);
+            return NULL;
+        }
+        return handle;
+    }
+    
+    /*
+    Привязка функций к библиотекам. Новые дескрипторы открываются до закрытия старых:
+    при ошибке остаётся прежняя привязка, а общая библиотека не выгружается и не грузится заново
+    */
+    int bind_functions(int sin_index, int gcf_index) {
+        void* sin_f = NULL;
+        void* gcf_f = NULL;
+        void* new_sin_handle = open_function(sin_index, "sinIntegral", &sin_f);
+        if (new_sin_handle == NULL) {
+            return -1;
         }
+        void* new_gcf_handle = open_function(gcf_index, "GCF", &gcf_f);
+        if (new_gcf_handle == NULL) {
+            close_handle(new_sin_handle);
+            return -1;
+        }
+        
+        close_handle(sin_handle);
+        close_handle(gcf_handle);
+        sin_handle = new_sin_handle;
+        gcf_handle = new_gcf_handle;
+        sinIntegral = (sin_integral_func)sin_f;
+        GCF = (gcf_func)gcf_f;
+        sin_lib = sin_index;
+        gcf_lib = gcf_index;
         
-        current_lib = lib_num;
-        printf("Switched to lib%d.so\n", lib_num);
+        // вызовы идут через кэш; смена хотя бы одной функции сбрасывает его
+        if (memo_enabled()) {
+            memo_bind(sinIntegral, sin_lib, GCF, gcf_lib);
+            sinIntegral = memo_sinIntegral;
+            GCF = memo_GCF;
+        }
+        return 0;
+    }
+    
+    // загрузка библиотеки целиком: обе функции из одной реализации
+    void load_library(int index) {
+        if (bind_functions(index, index) == 0) {
+            printf("Switched to %s\n", strrchr(registry.items[index].path, '/') + 1);
+        }
+    }
+    
+    // замер всех библиотек и привязка каждой функции к самой быстрой
+    void calibrate_and_bind(void) {
+        calibration_result results[registry.count];
+        int best_sin, best_gcf;
+        if (calibrate(&registry, results, &best_sin, &best_gcf) == 0) {
+            printf("Error: No library could be calibrated\n");
+            return;
+        }
+        calibration_print(&registry, results, best_sin, best_gcf);
+        if (bind_functions(best_sin, best_gcf) == 0) {
+            printf("Bound sinIntegral -> %s, GCF -> %s\n",
+                   registry.items[best_sin].name, registry.items[best_gcf].name);
+        }
     }
     
-    // загрузка первой библиотеки
-    load_library(1);
+    // команды управления (всё, кроме 1, 2 и 3) - общие для интерактивного и пакетного режима
+    void control_command(const char* command) {
+        if (strcmp(command, "0") == 0) {                // переключение библиотеки
+            load_library(registry_next(&registry, sin_lib));
+        } else if (command[0] == '0' && command[1] == ' ') {    // выбор библиотеки по имени
+            char name[PLUGIN_NAME_LEN];
+            if (sscanf(command + 1, "%63s", name) == 1) {
+                int index = registry_find(&registry, name);
+                if (index >= 0) {
+                    load_library(index);
+                } else {
+                    printf("Error: Unknown library '%s' (command 4 lists them)\n", name);
+                }
+            }
+        } else if (strcmp(command, "4") == 0) {         // список библиотек
+            registry_print(&registry, (sin_lib == gcf_lib) ? sin_lib : -1);
+        } else if (strcmp(command, "calibrate") == 0) { // выбор библиотеки для каждой функции
+            calibrate_and_bind();
+        } else if (strcmp(command, "cache") == 0) {     // статистика кэша результатов
+            memo_print_stats(stdout);
+        } else {
+            printf("Unknown command. Available: 0 [NAME], 1 A B e, 2 A B, 3, 4, calibrate, cache\n");
+        }
+    }
+    
+    // первая привязка
+    load_library(first_lib);
+    if (sin_lib < 0) {
+        exit(1);
+    }
+    if (calibrate_at_start) {
+        calibrate_and_bind();
+    }
+    
+    if (batch) {
+        batch_reader reader;
+        batch_open(&reader, STDIN_FILENO);
+        
+        // функции перечитываются после каждой управляющей команды: она могла сменить библиотеку
+        const char* line;
+        do {
+            batch_functions functions = {sinIntegral, GCF,
+                                         registry.items[sin_lib].integral_method,
+                                         registry.items[gcf_lib].gcf_method};
+            line = batch_run(&reader, &functions);
+            if (line != NULL) {
+                control_command(line);
+            }
+        } while (line != NULL);
+        
+        batch_close(&reader);
+    }
     
     char command[256];
     
-    while (1) {
-        printf("\n[lib%d]> ", current_lib);
+    while (!batch) {
+        if (sin_lib == gcf_lib) {
+            printf("\n[%s]> ", registry.items[sin_lib].name);
+        } else {
+            printf("\n[%s+%s]> ", registry.items[sin_lib].name, registry.items[gcf_lib].name);
+        }
         fflush(stdout);
         
         if (!fgets(command, sizeof(command), stdin)) {
@@ -118,15 +288,12 @@ int main() {
         if (strcmp(command, "3") == 0) {                // выход из программы
             printf("Exiting...\n");
             break;
-        } else if (strcmp(command, "0") == 0) {         // переключение библиотеки
-            int new_lib = (current_lib == 1) ? 2 : 1;
-            load_library(new_lib);
         } else if (command[0] == '1') {                 // интегральная функция
             float A, B, e;
             if (sscanf(command + 1, "%f %f %f", &A, &B, &e) == 3) {
                 float result = sinIntegral(A, B, e);
                 printf("Result (%s method): %.6f\n", 
-                       (current_lib == 1) ? "Rectangles" : "Trapezoids", 
+                       registry.items[sin_lib].integral_method,
                        result);
             } else {
                 printf("Error: Invalid arguments for command '1'\n");
@@ -137,26 +304,26 @@ int main() {
             if (sscanf(command + 1, "%d %d", &A, &B) == 2) {
                 int result = GCF(A, B);
                 printf("Result (%s algorithm): %d\n",
-                       (current_lib == 1) ? "Euclidean" : "Naive",
+                       registry.items[gcf_lib].gcf_method,
                        result);
             } else {
                 printf("Error: Invalid arguments for command '2'\n");
                 printf("Usage: 2 A B\n");
             }
         } else {
-            printf("Unknown command. Available: 0, 1 A B e, 2 A B, 3\n");
+            control_command(command);
         }
     }
     
-    // выгрузить библиотеку перед выходом
-    if (lib_handle != NULL) {
-        if (dlclose(lib_handle) != 0) {
-            const char* error_msg = dlerror();
-            if (error_msg) {
-                fprintf(stderr, "Warning: Failed to unload library when exiting the program: %s\n", error_msg);
-            }
-        }
-    }
+    // выгрузить библиотеки перед выходом
+    close_handle(sin_handle);
+    close_handle(gcf_handle);
     
+    // итог кэша - в stderr, чтобы не смешиваться с результатами пакетного режима
+    if (memo_enabled()) {
+        memo_print_stats(stderr);
+        memo_free();
+    }
+    registry_free(&registry);
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,312 @@
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "memo_cache.h"
+
+/*
+Кэш результатов (мемоизация) для повторяющихся запросов 1 A B e и 2 A B.
+    - ключ: функция, номер библиотеки и аргументы (float берутся побитово)
+    - кэш ограничен: у каждого шарда фиксированное число записей, при переполнении
+      вытесняется давно не использованная (LRU - двусвязный список по индексам)
+    - поиск - цепочки в хэш-таблице шарда; шард выбирается старшими битами хэша
+    - при промахе функция считается вне блокировки: медленный НОД lib2 не держит шард
+    - при смене библиотеки (memo_bind с другой функцией) кэш сбрасывается целиком
+Включается переменной окружения MEMO_CACHE=<число записей>
+*/
+
+#define MEMO_NONE (-1)
+
+typedef enum {
+    MEMO_SIN = 1,
+    MEMO_GCF = 2
+} memo_function;
+
+typedef struct {
+    uint32_t function;              // MEMO_SIN / MEMO_GCF
+    int32_t lib;                    // индекс библиотеки в реестре
+    uint32_t args[3];               // аргументы как есть (битовое представление float)
+} memo_key;
+
+typedef struct {
+    memo_key key;
+    uint32_t value;                 // результат (битовое представление float или int)
+    int32_t prev;                   // соседи в списке LRU
+    int32_t next;
+    int32_t chain;                  // следующая запись в той же корзине
+} memo_entry;
+
+typedef struct {
+    pthread_mutex_t lock;
+    memo_entry *entries;
+    int32_t *buckets;
+    size_t bucket_mask;
+    size_t capacity;
+    size_t count;
+    int32_t head;                   // самая свежая запись
+    int32_t tail;                   // кандидат на вытеснение
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
+} memo_shard;
+
+static struct {
+    int enabled;
+    memo_shard shards[MEMO_SHARDS];
+    sin_integral_func sin_f;
+    gcf_func gcf_f;
+    int sin_lib;
+    int gcf_lib;
+    uint64_t invalidations;
+} memo;
+
+
+static uint64_t hash_key(const memo_key *key) {
+    // splitmix64 от каждого слова ключа
+    uint64_t h = key->function * 0x9e3779b97f4a7c15ull ^ (uint64_t)(uint32_t)key->lib;
+    for (int i = 0; i < 3; i++) {
+        h ^= key->args[i] + 0x9e3779b97f4a7c15ull + (h << 6) + (h >> 2);
+        h ^= h >> 30;
+        h *= 0xbf58476d1ce4e5b9ull;
+        h ^= h >> 27;
+        h *= 0x94d049bb133111ebull;
+        h ^= h >> 31;
+    }
+    return h;
+}
+
+static int key_equal(const memo_key *a, const memo_key *b) {
+    return a->function == b->function && a->lib == b->lib &&
+           a->args[0] == b->args[0] && a->args[1] == b->args[1] && a->args[2] == b->args[2];
+}
+
+static void shard_reset(memo_shard *shard) {
+    for (size_t i = 0; i <= shard->bucket_mask; i++) {
+        shard->buckets[i] = MEMO_NONE;
+    }
+    shard->count = 0;
+    shard->head = MEMO_NONE;
+    shard->tail = MEMO_NONE;
+}
+
+void memo_init(size_t capacity) {
+    memset(&memo, 0, sizeof(memo));
+    memo.sin_lib = -1;
+    memo.gcf_lib = -1;
+    if (capacity == 0) {
+        return;
+    }
+
+    size_t per_shard = (capacity + MEMO_SHARDS - 1) / MEMO_SHARDS;
+    // корзин - степень двойки не меньше числа записей: средняя длина цепочки <= 1
+    size_t buckets = 1;
+    while (buckets < per_shard) {
+        buckets <<= 1;
+    }
+
+    for (int i = 0; i < MEMO_SHARDS; i++) {
+        memo_shard *shard = &memo.shards[i];
+        pthread_mutex_init(&shard->lock, NULL);
+        shard->capacity = per_shard;
+        shard->bucket_mask = buckets - 1;
+        shard->entries = calloc(per_shard, sizeof(memo_entry));
+        shard->buckets = malloc(buckets * sizeof(int32_t));
+        if (shard->entries == NULL || shard->buckets == NULL) {
+            perror("memo_init");
+            exit(1);
+        }
+        shard_reset(shard);
+    }
+    memo.enabled = 1;
+}
+
+int memo_enabled(void) {
+    return memo.enabled;
+}
+
+/*
+Привязка кэша к текущим функциям. Вызывается при каждой смене библиотеки (load_library,
+калибровка) в момент, когда вычислений нет; если хоть одна функция поменялась - кэш сбрасывается
+*/
+void memo_bind(sin_integral_func sin_f, int sin_lib, gcf_func gcf_f, int gcf_lib) {
+    if (!memo.enabled) {
+        return;
+    }
+    if (memo.sin_lib == sin_lib && memo.gcf_lib == gcf_lib && memo.sin_f == sin_f && memo.gcf_f == gcf_f) {
+        return;
+    }
+
+    if (memo.sin_lib >= 0) {
+        memo.invalidations++;
+    }
+    for (int i = 0; i < MEMO_SHARDS; i++) {
+        pthread_mutex_lock(&memo.shards[i].lock);
+        shard_reset(&memo.shards[i]);
+        pthread_mutex_unlock(&memo.shards[i].lock);
+    }
+    memo.sin_f = sin_f;
+    memo.gcf_f = gcf_f;
+    memo.sin_lib = sin_lib;
+    memo.gcf_lib = gcf_lib;
+}
+
+static void lru_unlink(memo_shard *shard, int32_t index) {
+    memo_entry *entry = &shard->entries[index];
+    if (entry->prev != MEMO_NONE) shard->entries[entry->prev].next = entry->next;
+    else shard->head = entry->next;
+    if (entry->next != MEMO_NONE) shard->entries[entry->next].prev = entry->prev;
+    else shard->tail = entry->prev;
+}
+
+static void lru_push_front(memo_shard *shard, int32_t index) {
+    memo_entry *entry = &shard->entries[index];
+    entry->prev = MEMO_NONE;
+    entry->next = shard->head;
+    if (shard->head != MEMO_NONE) shard->entries[shard->head].prev = index;
+    shard->head = index;
+    if (shard->tail == MEMO_NONE) shard->tail = index;
+}
+
+static int32_t shard_find(memo_shard *shard, const memo_key *key, size_t bucket) {
+    for (int32_t i = shard->buckets[bucket]; i != MEMO_NONE; i = shard->entries[i].chain) {
+        if (key_equal(&shard->entries[i].key, key)) {
+            return i;
+        }
+    }
+    return MEMO_NONE;
+}
+
+static void chain_remove(memo_shard *shard, int32_t index) {
+    size_t bucket = hash_key(&shard->entries[index].key) & shard->bucket_mask;
+    int32_t *link = &shard->buckets[bucket];
+    while (*link != index) {
+        link = &shard->entries[*link].chain;
+    }
+    *link = shard->entries[index].chain;
+}
+
+// поиск: 1 и значение в value при попадании
+static int memo_lookup(const memo_key *key, uint64_t hash, uint32_t *value) {
+    memo_shard *shard = &memo.shards[hash >> 60 & (MEMO_SHARDS - 1)];
+    size_t bucket = hash & shard->bucket_mask;
+
+    pthread_mutex_lock(&shard->lock);
+    int32_t index = shard_find(shard, key, bucket);
+    if (index != MEMO_NONE) {
+        lru_unlink(shard, index);
+        lru_push_front(shard, index);
+        *value = shard->entries[index].value;
+        shard->hits++;
+    } else {
+        shard->misses++;
+    }
+    pthread_mutex_unlock(&shard->lock);
+    return index != MEMO_NONE;
+}
+
+static void memo_insert(const memo_key *key, uint64_t hash, uint32_t value) {
+    memo_shard *shard = &memo.shards[hash >> 60 & (MEMO_SHARDS - 1)];
+    size_t bucket = hash & shard->bucket_mask;
+
+    pthread_mutex_lock(&shard->lock);
+    // другой поток мог посчитать то же самое, пока этот считал без блокировки
+    if (shard_find(shard, key, bucket) == MEMO_NONE) {
+        int32_t index;
+        if (shard->count < shard->capacity) {
+            index = (int32_t)shard->count++;
+        } else {
+            index = shard->tail;
+            lru_unlink(shard, index);
+            chain_remove(shard, index);
+            shard->evictions++;
+        }
+
+        memo_entry *entry = &shard->entries[index];
+        entry->key = *key;
+        entry->value = value;
+        entry->chain = shard->buckets[bucket];
+        shard->buckets[bucket] = index;
+        lru_push_front(shard, index);
+    }
+    pthread_mutex_unlock(&shard->lock);
+}
+
+float memo_sinIntegral(float A, float B, float e) {
+    memo_key key = {MEMO_SIN, memo.sin_lib, {0, 0, 0}};
+    memcpy(&key.args[0], &A, sizeof(float));
+    memcpy(&key.args[1], &B, sizeof(float));
+    memcpy(&key.args[2], &e, sizeof(float));
+    uint64_t hash = hash_key(&key);
+
+    uint32_t bits;
+    float result;
+    if (memo_lookup(&key, hash, &bits)) {
+        memcpy(&result, &bits, sizeof(float));
+        return result;
+    }
+
+    result = memo.sin_f(A, B, e);
+    memcpy(&bits, &result, sizeof(float));
+    memo_insert(&key, hash, bits);
+    return result;
+}
+
+int memo_GCF(int A, int B) {
+    memo_key key = {MEMO_GCF, memo.gcf_lib, {(uint32_t)A, (uint32_t)B, 0}};
+    uint64_t hash = hash_key(&key);
+
+    uint32_t bits;
+    if (memo_lookup(&key, hash, &bits)) {
+        return (int)bits;
+    }
+
+    int result = memo.gcf_f(A, B);
+    memo_insert(&key, hash, (uint32_t)result);
+    return result;
+}
+
+void memo_get_stats(memo_stats *stats) {
+    memset(stats, 0, sizeof(*stats));
+    stats->invalidations = memo.invalidations;
+    for (int i = 0; i < MEMO_SHARDS; i++) {
+        memo_shard *shard = &memo.shards[i];
+        if (!memo.enabled) {
+            break;
+        }
+        pthread_mutex_lock(&shard->lock);
+        stats->hits += shard->hits;
+        stats->misses += shard->misses;
+        stats->evictions += shard->evictions;
+        stats->entries += shard->count;
+        stats->capacity += shard->capacity;
+        pthread_mutex_unlock(&shard->lock);
+    }
+}
+
+void memo_print_stats(FILE *out) {
+    if (!memo.enabled) {
+        fprintf(out, "Memo cache is disabled (set MEMO_CACHE=<entries> to enable)\n");
+        return;
+    }
+
+    memo_stats stats;
+    memo_get_stats(&stats);
+    uint64_t lookups = stats.hits + stats.misses;
+    fprintf(out, "Memo cache: %zu/%zu entries, %llu hits, %llu misses (hit rate %.1f%%), "
+                 "%llu evictions, %llu invalidations\n",
+            stats.entries, stats.capacity,
+            (unsigned long long)stats.hits, (unsigned long long)stats.misses,
+            lookups ? 100.0 * (double)stats.hits / (double)lookups : 0.0,
+            (unsigned long long)stats.evictions, (unsigned long long)stats.invalidations);
+}
+
+void memo_free(void) {
+    if (!memo.enabled) {
+        return;
+    }
+    for (int i = 0; i < MEMO_SHARDS; i++) {
+        pthread_mutex_destroy(&memo.shards[i].lock);
+        free(memo.shards[i].entries);
+        free(memo.shards[i].buckets);
+    }
+    memset(&memo, 0, sizeof(memo));
+}
@@ -0,0 +1,30 @@
+#ifndef MEMO_CACHE_H
+#define MEMO_CACHE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "plugin_registry.h"
+
+// число шардов (степень двойки): у каждого свой мьютекс, потоки пакетного режима редко сталкиваются
+#define MEMO_SHARDS 16
+
+typedef struct {
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
+    uint64_t invalidations;         // сколько раз кэш сбрасывался при смене библиотеки
+    size_t entries;
+    size_t capacity;
+} memo_stats;
+
+void memo_init(size_t capacity);
+int memo_enabled(void);
+void memo_bind(sin_integral_func sin_f, int sin_lib, gcf_func gcf_f, int gcf_lib);
+float memo_sinIntegral(float A, float B, float e);
+int memo_GCF(int A, int B);
+void memo_get_stats(memo_stats *stats);
+void memo_print_stats(FILE *out);
+void memo_free(void);
+
+#endif
@@ -0,0 +1,353 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <elf.h>
+#include <link.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "plugin_registry.h"
+
+#define SO_SUFFIX ".so"
+
+
+/*
+Возможности процессора определяются один раз через __builtin_cpu_supports
+(cpuid + проверка, что ОС сохраняет соответствующие регистры при переключении контекста)
+*/
+unsigned int host_cpu_features(void) {
+    unsigned int features = 0;
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse4.2")) features |= LIB_CPU_SSE42;
+    if (__builtin_cpu_supports("avx2")) features |= LIB_CPU_AVX2;
+    if (__builtin_cpu_supports("avx512f")) features |= LIB_CPU_AVX512;
+#endif
+    return features;
+}
+
+void cpu_features_string(unsigned int features, char *buf, size_t size) {
+    snprintf(buf, size, "%s%s%s%s",
+             (features & LIB_CPU_SSE42) ? "sse4.2 " : "",
+             (features & LIB_CPU_AVX2) ? "avx2 " : "",
+             (features & LIB_CPU_AVX512) ? "avx512 " : "",
+             (features == 0) ? "baseline" : "");
+
+    size_t len = strlen(buf);
+    if (len > 0 && buf[len - 1] == ' ') {
+        buf[len - 1] = '\0';
+    }
+}
+
+static int has_suffix(const char *name, const char *suffix) {
+    size_t name_len = strlen(name);
+    size_t suffix_len = strlen(suffix);
+    return name_len > suffix_len && strcmp(name + name_len - suffix_len, suffix) == 0;
+}
+
+static void copy_string(char *dst, const char *src, size_t size) {
+    snprintf(dst, size, "%s", src ? src : "?");
+}
+
+static int compare_by_name(const void *a, const void *b) {
+    return strcmp(((const plugin_info *)a)->name, ((const plugin_info *)b)->name);
+}
+
+/*
+Описание библиотеки читается прямо из ELF-файла, без dlopen(): dlopen() выполнил бы
+конструкторы библиотеки, а dlclose() - деструкторы, то есть её код, возможно собранный
+под инструкции, которых у процессора нет. Файл отображается только для чтения:
+    .dynsym       - адрес lib_info
+    PT_LOAD       - адрес -> смещение в файле
+    .rela.dyn     - значения указателей-строк (относительные перемещения, слагаемое - в записи;
+                    без записи значение лежит на месте, как при REL/RELR)
+*/
+typedef struct {
+    const unsigned char *data;
+    size_t size;
+    const ElfW(Ehdr) *ehdr;
+    const ElfW(Phdr) *phdr;
+    const ElfW(Shdr) *shdr;
+} elf_image;
+
+#if __ELF_NATIVE_CLASS == 64
+#define ELF_NATIVE_R_SYM ELF64_R_SYM
+#else
+#define ELF_NATIVE_R_SYM ELF32_R_SYM
+#endif
+
+#if defined(__x86_64__)
+#define ELF_NATIVE_MACHINE EM_X86_64
+#elif defined(__i386__)
+#define ELF_NATIVE_MACHINE EM_386
+#elif defined(__aarch64__)
+#define ELF_NATIVE_MACHINE EM_AARCH64
+#endif
+
+static int elf_range_ok(const elf_image *elf, size_t offset, size_t length) {
+    return offset <= elf->size && length <= elf->size - offset;
+}
+
+static const char *elf_check(elf_image *elf) {
+    const ElfW(Ehdr) *ehdr = (const ElfW(Ehdr) *)elf->data;
+    if (elf->size < sizeof(*ehdr) || memcmp(ehdr->e_ident, ELFMAG, SELFMAG) != 0) {
+        return "not an ELF file";
+    }
+    if (ehdr->e_ident[EI_CLASS] != (__ELF_NATIVE_CLASS == 64 ? ELFCLASS64 : ELFCLASS32) ||
+#ifdef ELF_NATIVE_MACHINE
+        ehdr->e_machine != ELF_NATIVE_MACHINE ||
+#endif
+        ehdr->e_type != ET_DYN) {
+        return "not a shared library for this architecture";
+    }
+    if (ehdr->e_phentsize != sizeof(ElfW(Phdr)) || ehdr->e_shentsize != sizeof(ElfW(Shdr)) ||
+        !elf_range_ok(elf, ehdr->e_phoff, (size_t)ehdr->e_phnum * sizeof(ElfW(Phdr))) ||
+        !elf_range_ok(elf, ehdr->e_shoff, (size_t)ehdr->e_shnum * sizeof(ElfW(Shdr)))) {
+        return "corrupt ELF headers";
+    }
+    elf->ehdr = ehdr;
+    elf->phdr = (const ElfW(Phdr) *)(elf->data + ehdr->e_phoff);
+    elf->shdr = (const ElfW(Shdr) *)(elf->data + ehdr->e_shoff);
+    return NULL;
+}
+
+// данные по адресу в образе библиотеки; NULL, если адрес вне сегментов из файла
+static const unsigned char *elf_at(const elf_image *elf, ElfW(Addr) addr, size_t length) {
+    for (int i = 0; i < elf->ehdr->e_phnum; i++) {
+        const ElfW(Phdr) *ph = &elf->phdr[i];
+        if (ph->p_type == PT_LOAD && addr >= ph->p_vaddr && addr - ph->p_vaddr <= ph->p_filesz &&
+            length <= ph->p_filesz - (addr - ph->p_vaddr)) {
+            size_t offset = ph->p_offset + (addr - ph->p_vaddr);
+            return elf_range_ok(elf, offset, length) ? elf->data + offset : NULL;
+        }
+    }
+    return NULL;
+}
+
+// адрес экспортированного символа размером не меньше size; 0 - нет такого
+static ElfW(Addr) elf_symbol(const elf_image *elf, const char *name, size_t size) {
+    for (int i = 0; i < elf->ehdr->e_shnum; i++) {
+        const ElfW(Shdr) *sh = &elf->shdr[i];
+        if (sh->sh_type != SHT_DYNSYM || sh->sh_link >= elf->ehdr->e_shnum ||
+            !elf_range_ok(elf, sh->sh_offset, sh->sh_size)) {
+            continue;
+        }
+        const ElfW(Shdr) *strtab = &elf->shdr[sh->sh_link];
+        if (!elf_range_ok(elf, strtab->sh_offset, strtab->sh_size)) {
+            continue;
+        }
+        const ElfW(Sym) *syms = (const ElfW(Sym) *)(elf->data + sh->sh_offset);
+        const char *names = (const char *)elf->data + strtab->sh_offset;
+        size_t name_len = strlen(name);
+        for (size_t j = 0; j < sh->sh_size / sizeof(ElfW(Sym)); j++) {
+            if (syms[j].st_shndx != SHN_UNDEF && syms[j].st_size >= size &&
+                syms[j].st_name < strtab->sh_size && strtab->sh_size - syms[j].st_name > name_len &&
+                memcmp(names + syms[j].st_name, name, name_len + 1) == 0) {
+                return syms[j].st_value;
+            }
+        }
+    }
+    return 0;
+}
+
+// значение указателя, который загрузчик записал бы по адресу addr
+static ElfW(Addr) elf_pointer(const elf_image *elf, ElfW(Addr) addr) {
+    for (int i = 0; i < elf->ehdr->e_shnum; i++) {
+        const ElfW(Shdr) *sh = &elf->shdr[i];
+        if (sh->sh_type != SHT_RELA || !elf_range_ok(elf, sh->sh_offset, sh->sh_size)) {
+            continue;
+        }
+        const ElfW(Rela) *rela = (const ElfW(Rela) *)(elf->data + sh->sh_offset);
+        for (size_t j = 0; j < sh->sh_size / sizeof(ElfW(Rela)); j++) {
+            // относительное перемещение - без символа: база загрузки + слагаемое
+            if (rela[j].r_offset == addr && ELF_NATIVE_R_SYM(rela[j].r_info) == 0) {
+                return (ElfW(Addr))rela[j].r_addend;
+            }
+        }
+    }
+    ElfW(Addr) value = 0;
+    const unsigned char *p = elf_at(elf, addr, sizeof(value));
+    if (p != NULL) {
+        memcpy(&value, p, sizeof(value));
+    }
+    return value;
+}
+
+static void elf_string(const elf_image *elf, ElfW(Addr) field, char *dst, size_t size) {
+    ElfW(Addr) addr = elf_pointer(elf, field);
+    const char *s = (addr != 0) ? (const char *)elf_at(elf, addr, 1) : NULL;
+    if (s == NULL) {
+        copy_string(dst, NULL, size);
+        return;
+    }
+    size_t length = strnlen(s, (size_t)(elf->data + elf->size - (const unsigned char *)s));
+    if (length >= size) {
+        length = size - 1;
+    }
+    memcpy(dst, s, length);
+    dst[length] = '\0';
+}
+
+static int parse_descriptor(elf_image *elf, const char *path, plugin_info *info) {
+    const char *error = elf_check(elf);
+    if (error != NULL) {
+        fprintf(stderr, "Warning: Skipping %s: %s\n", path, error);
+        return -1;
+    }
+    ElfW(Addr) addr = elf_symbol(elf, LIB_DESCRIPTOR_SYMBOL, sizeof(lib_descriptor));
+    const unsigned char *data = (addr != 0) ? elf_at(elf, addr, sizeof(lib_descriptor)) : NULL;
+    if (data == NULL) {
+        fprintf(stderr, "Warning: Skipping %s: no %s descriptor\n", path, LIB_DESCRIPTOR_SYMBOL);
+        return -1;
+    }
+
+    // числа берутся как есть, указатели - через перемещения
+    lib_descriptor desc;
+    memcpy(&desc, data, sizeof(desc));
+    if (desc.abi_version != LIB_ABI_VERSION) {
+        fprintf(stderr, "Warning: Skipping %s: ABI version %d, expected %d\n",
+                path, desc.abi_version, LIB_ABI_VERSION);
+        return -1;
+    }
+
+    copy_string(info->path, path, sizeof(info->path));
+    elf_string(elf, addr + offsetof(lib_descriptor, name), info->name, sizeof(info->name));
+    elf_string(elf, addr + offsetof(lib_descriptor, integral_method), info->integral_method, sizeof(info->integral_method));
+    elf_string(elf, addr + offsetof(lib_descriptor, gcf_method), info->gcf_method, sizeof(info->gcf_method));
+    info->cpu_features = desc.cpu_features;
+    info->priority = desc.priority;
+    return 0;
+}
+
+// чтение описания одной библиотеки; -1 - библиотека пропускается (причина - в stderr)
+static int read_descriptor(const char *path, plugin_info *info) {
+    int fd = open(path, O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0) {
+        fprintf(stderr, "Warning: Skipping %s: %s\n", path, strerror(errno));
+        if (fd >= 0) {
+            close(fd);
+        }
+        return -1;
+    }
+
+    elf_image elf = {0};
+    elf.size = (size_t)st.st_size;
+    void *map = (elf.size > 0) ? mmap(NULL, elf.size, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+    close(fd);
+    if (map == MAP_FAILED) {
+        fprintf(stderr, "Warning: Skipping %s: cannot map file\n", path);
+        return -1;
+    }
+    elf.data = map;
+
+    int result = parse_descriptor(&elf, path, info);
+    munmap(map, elf.size);
+    return result;
+}
+
+/*
+Сканирование каталога: каждая *.so с корректным описанием попадает в реестр.
+Возвращает число найденных библиотек или -1, если каталог не открылся
+*/
+int registry_scan(plugin_registry *reg, const char *dir) {
+    memset(reg, 0, sizeof(*reg));
+    reg->host_features = host_cpu_features();
+
+    DIR *d = opendir(dir);
+    if (d == NULL) {
+        perror(dir);
+        return -1;
+    }
+
+    struct dirent *entry;
+    while ((entry = readdir(d)) != NULL) {
+        if (!has_suffix(entry->d_name, SO_SUFFIX)) {
+            continue;
+        }
+
+        if (reg->count == reg->capacity) {
+            size_t capacity = reg->capacity ? reg->capacity * 2 : 8;
+            plugin_info *items = realloc(reg->items, capacity * sizeof(plugin_info));
+            if (items == NULL) {
+                perror("realloc");
+                exit(EXIT_FAILURE);
+            }
+            reg->items = items;
+            reg->capacity = capacity;
+        }
+
+        // dlopen() ищет имя без '/' в системных путях, поэтому путь всегда с каталогом
+        char path[PATH_MAX];
+        snprintf(path, sizeof(path), "%s/%s", dir, entry->d_name);
+
+        plugin_info *info = &reg->items[reg->count];
+        if (read_descriptor(path, info) != 0) {
+            continue;
+        }
+
+        info->compatible = (info->cpu_features & ~reg->host_features) == 0;
+        reg->count++;
+    }
+    closedir(d);
+
+    qsort(reg->items, reg->count, sizeof(plugin_info), compare_by_name);
+    return (int)reg->count;
+}
+
+// совместимая библиотека с наибольшим приоритетом (-1, если таких нет)
+int registry_best(const plugin_registry *reg) {
+    int best = -1;
+    for (size_t i = 0; i < reg->count; i++) {
+        if (reg->items[i].compatible &&
+            (best < 0 || reg->items[i].priority > reg->items[best].priority)) {
+            best = (int)i;
+        }
+    }
+    return best;
+}
+
+int registry_find(const plugin_registry *reg, const char *name) {
+    for (size_t i = 0; i < reg->count; i++) {
+        if (strcmp(reg->items[i].name, name) == 0) {
+            return (int)i;
+        }
+    }
+    return -1;
+}
+
+// следующая по кругу совместимая библиотека (для команды 0 без аргумента)
+int registry_next(const plugin_registry *reg, int current) {
+    for (size_t step = 1; step <= reg->count; step++) {
+        int i = (int)((current + step) % reg->count);
+        if (reg->items[i].compatible) {
+            return i;
+        }
+    }
+    return current;
+}
+
+void registry_print(const plugin_registry *reg, int current) {
+    char features[64];
+    cpu_features_string(reg->host_features, features, sizeof(features));
+    printf("Host CPU: %s\n", features);
+
+    for (size_t i = 0; i < reg->count; i++) {
+        const plugin_info *info = &reg->items[i];
+        cpu_features_string(info->cpu_features, features, sizeof(features));
+        printf(" %c %-12s priority %3d  needs %-16s %s / %s%s\n",
+               ((int)i == current) ? '*' : ' ',
+               info->name, info->priority, features,
+               info->integral_method, info->gcf_method,
+               info->compatible ? "" : "  [unsupported CPU]");
+    }
+}
+
+void registry_free(plugin_registry *reg) {
+    free(reg->items);
+    memset(reg, 0, sizeof(*reg));
+}
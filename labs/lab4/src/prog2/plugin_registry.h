@@ -0,0 +1,47 @@
+#ifndef PLUGIN_REGISTRY_H
+#define PLUGIN_REGISTRY_H
+
+#include <limits.h>
+#include <stddef.h>
+#include "lib_contract.h"
+
+// каталог с библиотеками по умолчанию (переопределяется переменной окружения PLUGIN_DIR)
+#define PLUGIN_DIR_DEFAULT "./build/lib"
+#define PLUGIN_NAME_LEN 64
+
+// типы функций контракта
+typedef float (*sin_integral_func)(float, float, float);
+typedef int (*gcf_func)(int, int);
+
+/*
+Сведения об одной найденной библиотеке. Строки копируются из её lib_descriptor,
+потому что файл библиотеки после чтения описания закрывается
+*/
+typedef struct {
+    char path[PATH_MAX];
+    char name[PLUGIN_NAME_LEN];
+    char integral_method[PLUGIN_NAME_LEN];
+    char gcf_method[PLUGIN_NAME_LEN];
+    unsigned int cpu_features;      // LIB_CPU_*, которые требует библиотека
+    int priority;
+    int compatible;                 // процессор умеет всё, что требуется
+} plugin_info;
+
+typedef struct {
+    plugin_info *items;             // отсортированы по имени
+    size_t count;
+    size_t capacity;
+    unsigned int host_features;     // LIB_CPU_* текущего процессора
+} plugin_registry;
+
+unsigned int host_cpu_features(void);
+void cpu_features_string(unsigned int features, char *buf, size_t size);
+
+int registry_scan(plugin_registry *reg, const char *dir);
+int registry_best(const plugin_registry *reg);
+int registry_find(const plugin_registry *reg, const char *name);
+int registry_next(const plugin_registry *reg, int current);
+void registry_print(const plugin_registry *reg, int current);
+void registry_free(plugin_registry *reg);
+
+#endif
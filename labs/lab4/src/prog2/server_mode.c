@@ -0,0 +1,201 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include "server_mode.h"
+#include "function_table.h"
+
+/*
+Серверный режим: рабочие потоки непрерывно обрабатывают запросы (смесь sinIntegral и GCF),
+вызывая функции через общую таблицу table_domain, а управляющий поток читает команды
+со stdin и подменяет библиотеку прямо под нагрузкой. Рабочие потоки не ждут замену:
+максимальная задержка запроса в статистике показывает, была ли пауза
+*/
+
+typedef struct {
+    table_domain *domain;
+    int id;                         // номер слота читателя
+    int *stop;
+    uint64_t ops;                   // обработано запросов (читается управляющим потоком)
+    uint64_t max_ns;                // самый долгий запрос с прошлой статистики
+    char pad[CACHE_LINE];
+} worker_state;
+
+// смесь запросов: короткие интегралы и НОД небольших чисел (перебор lib2 тоже справляется)
+static const float sin_requests[][3] = {
+    {0.0f, 3.14159f, 0.01f},
+    {-1.0f, 2.0f, 0.005f},
+    {10.0f, 12.0f, 0.01f},
+};
+static const int gcf_requests[][2] = {
+    {48, 18}, {1071, 462}, {6765, 4181}, {9973, 8191},
+};
+
+#define SIN_REQUEST_COUNT (sizeof(sin_requests) / sizeof(sin_requests[0]))
+#define GCF_REQUEST_COUNT (sizeof(gcf_requests) / sizeof(gcf_requests[0]))
+
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static void *worker_main(void *arg) {
+    worker_state *state = (worker_state *)arg;
+    volatile float sin_sink;
+    volatile int gcf_sink;
+    size_t request = (size_t)state->id;
+
+    while (!__atomic_load_n(state->stop, __ATOMIC_RELAXED)) {
+        uint64_t start = now_ns();
+
+        // таблица удерживается только на время одного запроса
+        const function_table *table = table_acquire(state->domain, state->id);
+        if (request % 2 == 0) {
+            const float *r = sin_requests[(request / 2) % SIN_REQUEST_COUNT];
+            sin_sink = table->sinIntegral(r[0], r[1], r[2]);
+        } else {
+            const int *r = gcf_requests[(request / 2) % GCF_REQUEST_COUNT];
+            gcf_sink = table->GCF(r[0], r[1]);
+        }
+        table_release(state->domain, state->id);
+        request++;
+
+        uint64_t elapsed = now_ns() - start;
+        if (elapsed > __atomic_load_n(&state->max_ns, __ATOMIC_RELAXED)) {
+            __atomic_store_n(&state->max_ns, elapsed, __ATOMIC_RELAXED);
+        }
+        __atomic_store_n(&state->ops, state->ops + 1, __ATOMIC_RELAXED);
+    }
+
+    (void)sin_sink;
+    (void)gcf_sink;
+    return NULL;
+}
+
+// статистика с прошлого вызова: запросов в секунду и максимальная задержка по потокам
+static void print_stats(worker_state *workers, int threads, uint64_t *last_ops, uint64_t *last_time) {
+    uint64_t now = now_ns();
+    double seconds = (double)(now - *last_time) / 1e9;
+    uint64_t total = 0;
+
+    for (int i = 0; i < threads; i++) {
+        uint64_t ops = __atomic_load_n(&workers[i].ops, __ATOMIC_RELAXED);
+        uint64_t max_ns = __atomic_exchange_n(&workers[i].max_ns, 0, __ATOMIC_RELAXED);
+        printf("  worker %2d: %10.0f req/s, max latency %8.1f us\n",
+               i, (double)(ops - last_ops[i]) / seconds, (double)max_ns / 1000.0);
+        total += ops - last_ops[i];
+        last_ops[i] = ops;
+    }
+    printf("  total:     %10.0f req/s\n", (double)total / seconds);
+    *last_time = now;
+}
+
+static void switch_library(const plugin_registry *reg, table_domain *domain, int sin_index, int gcf_index) {
+    uint64_t start = now_ns();
+    function_table *next = table_load(reg, sin_index, gcf_index);
+    if (next == NULL) {
+        return;
+    }
+    uint64_t loaded = now_ns();
+    long grace_ns = table_swap(domain, next);
+
+    printf("Switched to %s (load + warm-up %.1f us, grace period %.1f us)\n",
+           reg->items[sin_index].name, (double)(loaded - start) / 1000.0, (double)grace_ns / 1000.0);
+}
+
+int run_server(const plugin_registry *reg, int first_lib, int threads) {
+    if (threads < 1) threads = 1;
+    if (threads > MAX_READERS) threads = MAX_READERS;
+
+    function_table *initial = table_load(reg, first_lib, first_lib);
+    if (initial == NULL) {
+        return 1;
+    }
+
+    table_domain domain;
+    domain_init(&domain, initial);
+
+    int stop = 0;
+    worker_state *workers = calloc((size_t)threads, sizeof(worker_state));
+    pthread_t *tids = calloc((size_t)threads, sizeof(pthread_t));
+    uint64_t *last_ops = calloc((size_t)threads, sizeof(uint64_t));
+    if (workers == NULL || tids == NULL || last_ops == NULL) {
+        perror("calloc");
+        exit(1);
+    }
+
+    for (int i = 0; i < threads; i++) {
+        workers[i].domain = &domain;
+        workers[i].id = i;
+        workers[i].stop = &stop;
+        if (pthread_create(&tids[i], NULL, worker_main, &workers[i]) != 0) {
+            perror("pthread_create");
+            exit(1);
+        }
+    }
+
+    printf("=== Program 2: Server Mode (%d workers) ===\n", threads);
+    printf("Commands:\n");
+    printf("  0        - Switch to the next compatible library under load\n");
+    printf("  0 NAME   - Switch to the library NAME under load\n");
+    printf("  3        - Stop workers and exit\n");
+    printf("  4        - List available libraries\n");
+    printf("  stats    - Requests per second and max latency since last stats\n");
+    printf("========================================\n");
+
+    uint64_t last_time = now_ns();
+    char command[256];
+
+    while (1) {
+        printf("\n[server:%s]> ", reg->items[__atomic_load_n(&domain.current, __ATOMIC_ACQUIRE)->sin_lib].name);
+        fflush(stdout);
+
+        if (!fgets(command, sizeof(command), stdin)) {
+            break;
+        }
+        command[strcspn(command, "\n")] = '\0';
+
+        // текущую таблицу меняет только этот поток, поэтому читать её здесь можно без захвата
+        int current = domain.current->sin_lib;
+
+        if (strcmp(command, "3") == 0) {
+            printf("Exiting...\n");
+            break;
+        } else if (strcmp(command, "0") == 0) {
+            int next = registry_next(reg, current);
+            switch_library(reg, &domain, next, next);
+        } else if (command[0] == '0' && command[1] == ' ') {
+            char name[PLUGIN_NAME_LEN];
+            if (sscanf(command + 1, "%63s", name) == 1) {
+                int index = registry_find(reg, name);
+                if (index >= 0) {
+                    switch_library(reg, &domain, index, index);
+                } else {
+                    printf("Error: Unknown library '%s' (command 4 lists them)\n", name);
+                }
+            }
+        } else if (strcmp(command, "4") == 0) {
+            registry_print(reg, current);
+        } else if (strcmp(command, "stats") == 0) {
+            print_stats(workers, threads, last_ops, &last_time);
+        } else {
+            printf("Unknown command. Available: 0 [NAME], 3, 4, stats\n");
+        }
+    }
+
+    __atomic_store_n(&stop, 1, __ATOMIC_RELAXED);
+    for (int i = 0; i < threads; i++) {
+        pthread_join(tids[i], NULL);
+    }
+    print_stats(workers, threads, last_ops, &last_time);
+
+    domain_destroy(&domain);
+    free(workers);
+    free(tids);
+    free(last_ops);
+    return 0;
+}
@@ -0,0 +1,8 @@
+#ifndef SERVER_MODE_H
+#define SERVER_MODE_H
+
+#include "plugin_registry.h"
+
+int run_server(const plugin_registry *reg, int first_lib, int threads);
+
+#endif
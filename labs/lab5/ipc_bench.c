@@ -0,0 +1,370 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <sys/eventfd.h>
+
+/*
+Бенчмарк механизмов IPC из лабораторных 1 и 3 на одной нагрузке:
+родитель отправляет сообщение из строк "число число число\n", дочерний процесс
+принимает его целиком и отправляет обратно (ping-pong).
+Для каждого механизма и размера сообщения считаются:
+    - пропускная способность (байты в обе стороны / время)
+    - p50/p99 времени полного круга (round-trip)
+    - число системных вызовов на одно сообщение (считаются в обёртках ниже, в обоих процессах)
+*/
+
+#define MIN_MSG_SIZE 8
+#define MAX_MSG_SIZE (1024 * 1024)
+#define SIZE_STEP 4                     // размеры: 8 B, 32 B, 128 B, ... 512 KB (x4) и 1 MB
+#define BYTES_PER_SIZE (64 * 1024 * 1024)   // объём данных на один замер
+#define MAX_ITERS 20000
+#define MIN_ITERS 50
+#define WARMUP_ITERS 10
+
+// кольцо вдвое больше максимального сообщения: в ping-pong в каждом направлении в полёте
+// не больше одного сообщения, поэтому писателю никогда не приходится ждать места
+#define RING_SIZE (2 * MAX_MSG_SIZE)
+#define CACHE_LINE 64
+
+
+typedef enum {
+    IPC_PIPE,
+    IPC_UNIX_SOCKET,
+    IPC_SHM_RING,           // кольцо в разделяемой памяти, ожидание - sched_yield()
+    IPC_SHM_EVENTFD,        // то же кольцо, ожидание - блокирующий read() на eventfd
+    IPC_COUNT
+} ipc_kind;
+
+static const char *ipc_names[IPC_COUNT] = {"pipe", "unix", "shm", "shm+eventfd"};
+
+// однонаправленное SPSC-кольцо: head двигает писатель, tail - читатель
+typedef struct {
+    size_t head;
+    char pad0[CACHE_LINE - sizeof(size_t)];
+    size_t tail;
+    char pad1[CACHE_LINE - sizeof(size_t)];
+    char data[RING_SIZE];
+} shm_ring;
+
+// общий для родителя и потомка счётчик системных вызовов
+typedef struct {
+    size_t syscalls;
+} bench_stats;
+
+// одна сторона канала: чем пишет и чем читает конкретный процесс
+typedef struct {
+    ipc_kind kind;
+    int send_fd;
+    int recv_fd;
+    shm_ring *tx;
+    shm_ring *rx;
+    int tx_event;           // eventfd, который будит читателя tx
+    int rx_event;           // eventfd, на котором ждём данных в rx
+    bench_stats *stats;
+} endpoint;
+
+
+static void count_syscall(endpoint *ep) {
+    __atomic_add_fetch(&ep->stats->syscalls, 1, __ATOMIC_RELAXED);
+}
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static void write_all(endpoint *ep, int fd, const char *buf, size_t len) {
+    while (len > 0) {
+        ssize_t n = write(fd, buf, len);
+        count_syscall(ep);
+        if (n == -1) {
+            perror("write");
+            exit(EXIT_FAILURE);
+        }
+        buf += n;
+        len -= (size_t)n;
+    }
+}
+
+static void read_all(endpoint *ep, int fd, char *buf, size_t len) {
+    while (len > 0) {
+        ssize_t n = read(fd, buf, len);
+        count_syscall(ep);
+        if (n <= 0) {
+            perror("read");
+            exit(EXIT_FAILURE);
+        }
+        buf += n;
+        len -= (size_t)n;
+    }
+}
+
+static void ring_write(endpoint *ep, const char *buf, size_t len) {
+    shm_ring *ring = ep->tx;
+    size_t head = ring->head;       // head меняет только этот процесс
+
+    // сообщение может перейти через конец буфера - копируем двумя кусками
+    size_t pos = head % RING_SIZE;
+    size_t first = (len < RING_SIZE - pos) ? len : RING_SIZE - pos;
+    memcpy(ring->data + pos, buf, first);
+    memcpy(ring->data, buf + first, len - first);
+    __atomic_store_n(&ring->head, head + len, __ATOMIC_RELEASE);
+
+    if (ep->kind == IPC_SHM_EVENTFD) {
+        uint64_t one = 1;
+        if (write(ep->tx_event, &one, sizeof(one)) != sizeof(one)) {
+            perror("write eventfd");
+            exit(EXIT_FAILURE);
+        }
+        count_syscall(ep);
+    }
+}
+
+static void ring_read(endpoint *ep, char *buf, size_t len) {
+    shm_ring *ring = ep->rx;
+    size_t tail = ring->tail;
+
+    while (len > 0) {
+        size_t available = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE) - tail;
+        if (available == 0) {
+            if (ep->kind == IPC_SHM_EVENTFD) {
+                // счётчик eventfd накапливается, поэтому сигнал, пришедший до read(), не теряется
+                uint64_t value;
+                if (read(ep->rx_event, &value, sizeof(value)) != sizeof(value)) {
+                    perror("read eventfd");
+                    exit(EXIT_FAILURE);
+                }
+            } else {
+                sched_yield();
+            }
+            count_syscall(ep);
+            continue;
+        }
+
+        size_t chunk = (available < len) ? available : len;
+        size_t pos = tail % RING_SIZE;
+        size_t first = (chunk < RING_SIZE - pos) ? chunk : RING_SIZE - pos;
+        memcpy(buf, ring->data + pos, first);
+        memcpy(buf + first, ring->data, chunk - first);
+
+        tail += chunk;
+        buf += chunk;
+        len -= chunk;
+        __atomic_store_n(&ring->tail, tail, __ATOMIC_RELEASE);
+    }
+}
+
+static void send_msg(endpoint *ep, const char *buf, size_t len) {
+    if (ep->kind == IPC_PIPE || ep->kind == IPC_UNIX_SOCKET) {
+        write_all(ep, ep->send_fd, buf, len);
+    } else {
+        ring_write(ep, buf, len);
+    }
+}
+
+static void recv_msg(endpoint *ep, char *buf, size_t len) {
+    if (ep->kind == IPC_PIPE || ep->kind == IPC_UNIX_SOCKET) {
+        read_all(ep, ep->recv_fd, buf, len);
+    } else {
+        ring_read(ep, buf, len);
+    }
+}
+
+
+static void *map_shared(size_t size) {
+    void *mem = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (mem == MAP_FAILED) {
+        perror("mmap");
+        exit(EXIT_FAILURE);
+    }
+    return mem;
+}
+
+// заполнение сообщения той же нагрузкой, что в лабораторных 1 и 3: строки с числами
+static void fill_workload(char *buf, size_t len) {
+    static const char line[] = "10 20 30 40\n";
+    for (size_t i = 0; i < len; i++) {
+        buf[i] = line[i % (sizeof(line) - 1)];
+    }
+}
+
+static int compare_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a;
+    uint64_t y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+
+/*
+Один замер: создание канала, fork, iters кругов ping-pong.
+Каналы создаются заново для каждого замера, чтобы состояние буферов не переходило между ними
+*/
+static void run_case(ipc_kind kind, size_t size, int iters, bench_stats *stats) {
+    endpoint parent = { .kind = kind, .stats = stats };
+    endpoint child = { .kind = kind, .stats = stats };
+    shm_ring *rings = NULL;
+
+    if (kind == IPC_PIPE) {
+        int to_child[2], to_parent[2];
+        if (pipe(to_child) == -1 || pipe(to_parent) == -1) {
+            perror("pipe");
+            exit(EXIT_FAILURE);
+        }
+        parent.send_fd = to_child[1];
+        parent.recv_fd = to_parent[0];
+        child.send_fd = to_parent[1];
+        child.recv_fd = to_child[0];
+    } else if (kind == IPC_UNIX_SOCKET) {
+        int sv[2];
+        if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) == -1) {
+            perror("socketpair");
+            exit(EXIT_FAILURE);
+        }
+        parent.send_fd = parent.recv_fd = sv[0];
+        child.send_fd = child.recv_fd = sv[1];
+    } else {
+        rings = map_shared(2 * sizeof(shm_ring));
+        parent.tx = child.rx = &rings[0];
+        parent.rx = child.tx = &rings[1];
+        if (kind == IPC_SHM_EVENTFD) {
+            int to_child = eventfd(0, 0);
+            int to_parent = eventfd(0, 0);
+            if (to_child == -1 || to_parent == -1) {
+                perror("eventfd");
+                exit(EXIT_FAILURE);
+            }
+            parent.tx_event = child.rx_event = to_child;
+            parent.rx_event = child.tx_event = to_parent;
+        }
+    }
+
+    char *buf = malloc(size);
+    uint64_t *rtt = malloc(sizeof(uint64_t) * (size_t)iters);
+    if (!buf || !rtt) {
+        perror("malloc");
+        exit(EXIT_FAILURE);
+    }
+    fill_workload(buf, size);
+
+    pid_t pid = fork();
+    if (pid == -1) {
+        perror("fork");
+        exit(EXIT_FAILURE);
+    }
+
+    if (pid == 0) {
+        // эхо-процесс: принимает сообщение целиком и отправляет его обратно
+        for (int i = 0; i < WARMUP_ITERS + iters; i++) {
+            recv_msg(&child, buf, size);
+            send_msg(&child, buf, size);
+        }
+        _exit(0);
+    }
+
+    for (int i = 0; i < WARMUP_ITERS; i++) {
+        send_msg(&parent, buf, size);
+        recv_msg(&parent, buf, size);
+    }
+
+    __atomic_store_n(&stats->syscalls, 0, __ATOMIC_RELAXED);
+    uint64_t start = now_ns();
+    for (int i = 0; i < iters; i++) {
+        uint64_t t0 = now_ns();
+        send_msg(&parent, buf, size);
+        recv_msg(&parent, buf, size);
+        rtt[i] = now_ns() - t0;
+    }
+    uint64_t elapsed = now_ns() - start;
+    size_t syscalls = __atomic_load_n(&stats->syscalls, __ATOMIC_RELAXED);
+
+    waitpid(pid, NULL, 0);
+
+    qsort(rtt, (size_t)iters, sizeof(uint64_t), compare_u64);
+    double seconds = (double)elapsed / 1e9;
+    double mbytes = 2.0 * (double)size * iters / (1024.0 * 1024.0);     // туда и обратно
+
+    printf("%-12s %9zu %7d %10.1f %10.2f %10.2f %12.2f\n",
+           ipc_names[kind], size, iters,
+           mbytes / seconds,
+           (double)rtt[iters / 2] / 1000.0,
+           (double)rtt[(size_t)iters * 99 / 100] / 1000.0,
+           (double)syscalls / (2.0 * iters));
+    fflush(stdout);
+
+    free(buf);
+    free(rtt);
+    if (kind == IPC_PIPE || kind == IPC_UNIX_SOCKET) {
+        close(parent.send_fd);
+        close(child.send_fd);
+        if (kind == IPC_PIPE) {
+            close(parent.recv_fd);
+            close(child.recv_fd);
+        }
+    } else {
+        if (kind == IPC_SHM_EVENTFD) {
+            close(parent.tx_event);
+            close(parent.rx_event);
+        }
+        munmap(rings, 2 * sizeof(shm_ring));
+    }
+}
+
+// следующий размер сетки; последним всегда идёт ровно MAX_MSG_SIZE
+static size_t next_size(size_t size) {
+    if (size == MAX_MSG_SIZE) {
+        return MAX_MSG_SIZE + 1;
+    }
+    size *= SIZE_STEP;
+    return (size > MAX_MSG_SIZE) ? MAX_MSG_SIZE : size;
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr, "Usage: %s [pipe] [unix] [shm] [shm+eventfd]\n", prog);
+    fprintf(stderr, "Без аргументов запускаются все механизмы\n");
+}
+
+int main(int argc, char *argv[]) {
+    int selected[IPC_COUNT] = {0};
+    int any = 0;
+
+    for (int i = 1; i < argc; i++) {
+        int found = 0;
+        for (int k = 0; k < IPC_COUNT; k++) {
+            if (strcmp(argv[i], ipc_names[k]) == 0) {
+                selected[k] = found = any = 1;
+            }
+        }
+        if (!found) {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    bench_stats *stats = map_shared(sizeof(bench_stats));
+
+    printf("%-12s %9s %7s %10s %10s %10s %12s\n",
+           "transport", "size(B)", "iters", "MB/s", "p50(us)", "p99(us)", "syscalls/msg");
+
+    for (int k = 0; k < IPC_COUNT; k++) {
+        if (any && !selected[k]) {
+            continue;
+        }
+        for (size_t size = MIN_MSG_SIZE; size <= MAX_MSG_SIZE; size = next_size(size)) {
+            size_t iters = BYTES_PER_SIZE / size;
+            if (iters > MAX_ITERS) iters = MAX_ITERS;
+            if (iters < MIN_ITERS) iters = MIN_ITERS;
+            run_case((ipc_kind)k, size, (int)iters, stats);
+        }
+    }
+
+    munmap(stats, sizeof(bench_stats));
+    return 0;
+}